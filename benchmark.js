@@ -0,0 +1,127 @@
+//times a compiled program by calling its main, or another static method without parameters,
+//over and over in one instance of the module.  Only methods of modules compiled with
+//enableBenchmarking(true) can be chosen, and only their allocations are counted.  Nothing here
+//needs a page, so it runs in node as well as in the browser
+import {instantiate} from "./runtime.js";
+import {getLayout, carryOver} from "./tiering.js";
+
+//the imports that print.  They do nothing while the method is being timed
+const PRINT_IMPORTS = ["puts", "put", "putbool", "puti32", "puti64", "putu32", "putf32", "putf64", "putString"];
+
+function getPercentile(sortedTimes, fraction) {
+    const index = Math.min(sortedTimes.length - 1, Math.ceil(fraction * sortedTimes.length) - 1);
+    return sortedTimes[Math.max(0, index)];
+}
+
+//module is the program's bytes or its compiled WebAssembly.Module.  Options are the method's
+//export name, e.g. Main.fib, and how many times to call it before and while timing it.
+//onInstantiate is given the module's exports before the method is first called.  Objects are
+//never freed, so every call's allocations stay in memory.  In tiered mode, nextTier is given
+//the module's exports after each call, and can return another tier of the program to switch
+//to before the next one.  The switch only happens if the new tier can take over the state of
+//the old one
+export async function runBenchmark(module, imports, options = {}) {
+    const method = options.method || "main";
+    const warmupCount = options.warmup === undefined ? 10 : options.warmup;
+    const iterationCount = options.iterations || 100;
+
+    let isOutputSuppressed = false;
+    const env = Object.assign({}, imports.env);
+    for (const name of PRINT_IMPORTS) {
+        const print = env[name];
+        if (print) {
+            env[name] = (...args) => isOutputSuppressed ? undefined : print(...args);
+        }
+    }
+
+    const moduleImports = Object.assign({}, imports, {env});
+    let moduleExports = (await instantiate(module, moduleImports)).exports;
+    let layout = getLayout(moduleExports);
+    let run = moduleExports[method];
+    if (typeof run !== "function") {
+        throw new Error(`${method} isn't exported.  Only main and static methods without parameters can be benchmarked`);
+    }
+
+    if (options.onInstantiate) {
+        options.onInstantiate(moduleExports);
+    }
+
+    //main runs the static initializers itself.  Any other method needs them run once first
+    if (method !== "main" && moduleExports.initialize) {
+        moduleExports.initialize();
+    }
+
+    let callCount = 0;
+    let tierSwitchCall;
+
+    //between calls, nothing of the program is on the stack
+    async function switchTier() {
+        const tierBytes = options.nextTier(moduleExports);
+        if (!tierBytes) {
+            return;
+        }
+
+        const tierExports = (await instantiate(tierBytes, moduleImports)).exports;
+        if (typeof tierExports[method] !== "function" || !carryOver(moduleExports, layout, tierExports)) {
+            return;
+        }
+
+        moduleExports = tierExports;
+        run = tierExports[method];
+        tierSwitchCall = callCount;
+        if (options.onInstantiate) {
+            options.onInstantiate(moduleExports);
+        }
+    }
+
+    isOutputSuppressed = true;
+    try {
+        for (let i = 0; i < warmupCount; ++i) {
+            run();
+            ++callCount;
+            if (options.nextTier) {
+                await switchTier();
+            }
+        }
+
+        const allocationsBefore = moduleExports.allocations ? moduleExports.allocations.value : 0;
+        const heapTopBefore = moduleExports.heapTop ? moduleExports.heapTop.value : 0;
+        const times = [];
+
+        for (let i = 0; i < iterationCount; ++i) {
+            const start = performance.now();
+            run();
+            times.push(performance.now() - start);
+            ++callCount;
+            if (options.nextTier) {
+                await switchTier();
+            }
+        }
+
+        const allocations = moduleExports.allocations ? moduleExports.allocations.value - allocationsBefore : 0;
+        const allocatedBytes = moduleExports.heapTop ? moduleExports.heapTop.value - heapTopBefore : 0;
+        times.sort((a, b) => a - b);
+
+        return {
+            method,
+            iterations: iterationCount,
+            warmup: warmupCount,
+            minMilliseconds: times[0],
+            medianMilliseconds: getPercentile(times, 0.5),
+            p99Milliseconds: getPercentile(times, 0.99),
+            allocationsPerIteration: allocations / iterationCount,
+            allocatedBytesPerIteration: allocatedBytes / iterationCount,
+            tierSwitchCall,
+        };
+    } finally {
+        isOutputSuppressed = false;
+    }
+}
+
+export function formatBenchmark(result) {
+    const ms = value => value.toFixed(4) + " ms";
+    return `\nBenchmark of ${result.method}, ${result.iterations} iterations after ${result.warmup} warmup\n` +
+        `min ${ms(result.minMilliseconds)}  median ${ms(result.medianMilliseconds)}  p99 ${ms(result.p99Milliseconds)}\n` +
+        `${result.allocationsPerIteration} allocations (${result.allocatedBytesPerIteration} bytes) per iteration\n` +
+        (result.tierSwitchCall === undefined ? "" : `switched to the optimized tier after ${result.tierSwitchCall} calls\n`);
+}
@@ -0,0 +1,154 @@
+//a content-addressed cache of compiled programs.  Programs are keyed by the compiler's hash of
+//their tokens, so edits to whitespace and comments still hit, along with the version of the
+//compiler and the options that change what it emits.  The worker keeps the compiled
+//WebAssembly.Module of each program it has seen, so running one again only instantiates it.
+//The bytes are also kept in IndexedDB in the browser, or in a directory under node, so they
+//outlive the worker
+
+//programs whose Modules are kept in memory, most recently used last
+const MAX_MEMORY_ENTRIES = 64;
+
+function toHex(bytes) {
+    return Array.from(bytes, byte => byte.toString(16).padStart(2, "0")).join("");
+}
+
+//programs in an object store of IndexedDB
+class IndexedDBStore {
+    static open() {
+        return new Promise((resolve, reject) => {
+            const request = indexedDB.open("java-wasm", 1);
+            request.onupgradeneeded = () => request.result.createObjectStore("programs");
+            request.onsuccess = () => resolve(new IndexedDBStore(request.result));
+            request.onerror = () => reject(request.error);
+        });
+    }
+
+    constructor(database) {
+        this.database = database;
+    }
+
+    request(mode, makeRequest) {
+        return new Promise((resolve, reject) => {
+            const store = this.database.transaction("programs", mode).objectStore("programs");
+            const request = makeRequest(store);
+            request.onsuccess = () => resolve(request.result);
+            request.onerror = () => reject(request.error);
+        });
+    }
+
+    get(key) {
+        return this.request("readonly", store => store.get(key));
+    }
+
+    put(key, entry) {
+        return this.request("readwrite", store => store.put(entry, key));
+    }
+}
+
+//programs in a directory, as the module and a JSON file of its stats and report.  Each file is
+//written under a temporary name and renamed, so processes sharing the directory never read
+//half a file
+class DirectoryStore {
+    static async open(directory) {
+        const fs = await import("node:fs/promises");
+        await fs.mkdir(directory, {recursive: true});
+        return new DirectoryStore(directory, fs);
+    }
+
+    constructor(directory, fs) {
+        this.directory = directory;
+        this.fs = fs;
+    }
+
+    async get(key) {
+        try {
+            const path = `${this.directory}/${key}`;
+            const [bytes, info] = await Promise.all([this.fs.readFile(path + ".wasm"), this.fs.readFile(path + ".json", "utf8")]);
+            return Object.assign(JSON.parse(info), {bytes: new Uint8Array(bytes)});
+        } catch (error) {
+            return undefined;
+        }
+    }
+
+    async put(key, entry) {
+        const path = `${this.directory}/${key}`;
+        const suffix = `.${Date.now()}-${Math.random().toString(36).slice(2)}.tmp`;
+        await this.writeFile(path + ".json", JSON.stringify({stats: entry.stats, report: entry.report}), suffix);
+        await this.writeFile(path + ".wasm", entry.bytes, suffix);
+    }
+
+    async writeFile(path, data, suffix) {
+        await this.fs.writeFile(path + suffix, data);
+        await this.fs.rename(path + suffix, path);
+    }
+}
+
+export class CompileCache {
+    //directory is where node keeps programs.  In a browser they're kept in IndexedDB.  Without
+    //either, they're only kept in memory
+    static async open(compilerBytes, directory) {
+        const digest = await crypto.subtle.digest("SHA-256", compilerBytes);
+        const compilerVersion = toHex(new Uint8Array(digest, 0, 8));
+
+        let store;
+        try {
+            if (directory) {
+                store = await DirectoryStore.open(directory);
+            } else if (typeof indexedDB !== "undefined") {
+                store = await IndexedDBStore.open();
+            }
+        } catch (error) {
+            store = undefined;
+        }
+
+        return new CompileCache(compilerVersion, store);
+    }
+
+    constructor(compilerVersion, store) {
+        this.compilerVersion = compilerVersion;
+        this.store = store;
+        this.entries = new Map();
+    }
+
+    //sourceHash is the two words hashSource returns, and options a string of the options the
+    //program is compiled with
+    getKey(sourceHash, options) {
+        const hash = sourceHash[1].toString(16).padStart(8, "0") + sourceHash[0].toString(16).padStart(8, "0");
+        return `${hash}-${this.compilerVersion}-${options}`;
+    }
+
+    //the bytes, stats and report a program was compiled to, or undefined
+    async get(key) {
+        let entry = this.entries.get(key);
+        if (!entry && this.store) {
+            entry = await this.store.get(key);
+        }
+        if (entry) {
+            this.remember(key, entry);
+        }
+        return entry;
+    }
+
+    async put(key, entry) {
+        this.remember(key, entry);
+        if (this.store) {
+            await this.store.put(key, {bytes: entry.bytes, stats: entry.stats, report: entry.report}).catch(() => {});
+        }
+    }
+
+    remember(key, entry) {
+        this.entries.delete(key);
+        this.entries.set(key, entry);
+        if (this.entries.size > MAX_MEMORY_ENTRIES) {
+            this.entries.delete(this.entries.keys().next().value);
+        }
+    }
+
+    //the program's compiled module, which is compiled once
+    getModule(entry) {
+        if (!entry.module) {
+            entry.module = WebAssembly.compile(entry.bytes);
+        }
+        return entry.module;
+    }
+}
@@ -1,4 +1,5 @@
 import getDisassembly from "https://nathanross.me/small-wasm-disassembler/disassembler.min.mjs"; //TODO load this dynamically
+import {OutputRing, InputChannel} from "./runtime.js";
 
 const consoleOutput = document.getElementById("console");
 const playBttn = document.getElementById("play-bttn");
@@ -8,6 +9,26 @@ const disassembleBttn = document.getElementById("disassemble-bttn");
 const programInputField = document.getElementById("input-panel").lastChild;
 const UTF8Decoder = new TextDecoder("utf-8");
 
+//?profile, ?names and ?lines compile programs with profiling or debug info.  ?benchmark times
+//main, or the method it names, e.g. ?benchmark=Main.fib&iterations=1000&warmup=100.  ?fuel
+//makes programs check whether they're paused every so many method calls and loop iterations,
+//e.g. ?fuel=100000
+const options = new URLSearchParams(location.search);
+
+//the compiler and the programs it compiles run in a worker, so a busy program doesn't stall the
+//editor.  When the page is cross-origin isolated, what they print goes through a ring in shared
+//memory that's drained once a frame, and programs can wait for input.  Otherwise output is
+//posted to the page, and programs only get the input in the panel
+const canShareMemory = typeof SharedArrayBuffer === "function" && self.crossOriginIsolated === true;
+let worker;
+let outputRing;
+let inputChannel;
+let compilerBytes;
+let onCompiled;
+let isLoaded = false;
+let isRunning = false;
+let drainRequestId;
+
 let programInput = [];
 
 let secondsElapsedBeforePause = 0;
@@ -35,11 +56,20 @@ pauseBttn.onclick = function() {
     }
 
     pauseBttn.classList.toggle("active", secondsElapsedBeforePause !== 0);
+
+    if (inputChannel) {
+        inputChannel.setPaused(secondsElapsedBeforePause !== 0);
+    }
 }
 
 backBttn.onclick = function() {
     activeWasmModule = undefined;
 
+    //a program that's still running is stopped with the worker running it
+    if (isRunning) {
+        startWorker();
+    }
+
     // if (frameRequestId !== undefined) {
     //     cancelAnimationFrame(frameRequestId);
     //     frameRequestId = undefined;
@@ -59,93 +89,96 @@ function printToConsole(value) {
     }
 }
 
-function createRuntime() {
-    this.memoryUbytes;
-    const self = this;
-
-    this.env = {
-        puts(address, size) {
-            const data = self.memoryUbytes.subarray(address, address + size);
-            const message = UTF8Decoder.decode(data);
-            printToConsole(message);
-        },
-
-        logs(address, size) {
-            const data = self.memoryUbytes.subarray(address, address + size);
-            const message = UTF8Decoder.decode(data);
-            console.log(message);
-        },
-
-        put(char) {
-            if (char < 0) {
-                //clang is producing negative characters.
-                //temporary fix
-                char += 128;
-            }
-            const message = String.fromCharCode(char);
-            printToConsole(message);
-        },
-
-        putbool(value) {
-            const message = String(!!value);
-            printToConsole(message);
-        },
-
-        puti32(num) {
-            const message = String(num);
-            printToConsole(message);
-        },
-
-
-        logi32(num) {
-            console.log(num);
-        },
-
-        putf32(num) {
-            const message = String(num);
-            printToConsole(message);
-        },
-
-        nextF32() {
-            var input
-            if (programInput.length > 0) {
-                input = programInput.splice(0, 1);
-            } else {
-                input = prompt("Enter a float");
-            }
-            printToConsole(input + "\n")
-            return +input;
-        },
+function getWorkerOptions() {
+    return {
+        profile: options.has("profile"),
+        names: options.has("names"),
+        lines: options.has("lines"),
+        benchmark: options.has("benchmark") ? options.get("benchmark") : undefined,
+        iterations: +options.get("iterations") || undefined,
+        warmup: options.has("warmup") ? +options.get("warmup") : undefined,
+        fuel: options.has("fuel") ? +options.get("fuel") || 100000 : undefined,
+        tiered: options.has("tiered") ? options.get("tiered") : undefined,
+        report: options.has("report"),
+        cache: !options.has("nocache"),
+    };
+}
 
-        putu32(u32Num) {
-            if (u32Num < 0) {
-                u32Num += 1 ** 32;
-            }
-            const message = String(u32Num);
-            printToConsole(message);
+//start a worker with the compiler, replacing the one there was
+function startWorker() {
+    if (worker) {
+        worker.terminate();
+    }
+
+    outputRing = canShareMemory ? OutputRing.create() : undefined;
+    inputChannel = canShareMemory ? InputChannel.create() : undefined;
+    isRunning = false;
+
+    worker = new Worker("worker.js", {type: "module"});
+    worker.onmessage = receive;
+    worker.postMessage({
+        type: "init",
+        compilerBytes,
+        outputBuffer: outputRing && outputRing.buffer,
+        inputBuffer: inputChannel && inputChannel.buffer,
+        options: getWorkerOptions(),
+    });
+}
+
+function receive(event) {
+    const message = event.data;
+
+    if (message.type === "ready") {
+        if (!isLoaded) {
+            isLoaded = true;
+            printToConsole("Loaded. An internet connection is no longer required.\n\n");
+        }
+    } else if (message.type === "output") {
+        printToConsole(UTF8Decoder.decode(message.bytes, {stream: true}));
+    } else if (message.type === "compiled") {
+        drainOutput();
+        console.debug(message.tier || "", message.stats);
+        if (message.report) {
+            console.debug(message.report);
         }
-    };
 
-    this.Math = Math;
+        const handleModule = onCompiled;
+        onCompiled = undefined;
+        handleModule(message.bytes, message.report);
+    } else if (message.type === "exited") {
+        isRunning = false;
+        drainOutput();
+        document.body.className = "program-input-mode";
+    }
 }
 
-const compilerImports = new createRuntime();
-const runtimeImports = new createRuntime();
+//show what the program printed, and answer it if it's waiting for input
+function drainOutput() {
+    if (!outputRing) {
+        return;
+    }
 
+    const bytes = outputRing.read();
+    if (bytes.length > 0) {
+        printToConsole(UTF8Decoder.decode(bytes, {stream: true}));
+    }
 
-// WebAssembly.instantiateStreaming(fetch('compiler.wasm'), wasmImports)
-//     .then(results => {
-//         // Do something with the results!
-//         console.log(results);
-//     });
+    inputChannel.serveInput(() => {
+        const input = prompt("Enter a float");
+        return input === null ? "" : input;
+    });
+}
+
+function drainEachFrame() {
+    drainOutput();
+    drainRequestId = isRunning ? requestAnimationFrame(drainEachFrame) : undefined;
+}
 
 fetch('compiler.wasm').then(response =>
     response.arrayBuffer()
-).then(bytes =>
-    WebAssembly.instantiate(bytes, compilerImports)
-).then(results => {
-    const compilerExports = results.instance.exports;
-    compilerImports.memoryUbytes = new Uint8Array(compilerExports.memory.buffer);
+).then(bytes => {
+    compilerBytes = bytes;
+    startWorker();
 
     function compileClick(event) {
         if (!editor) {
@@ -153,66 +186,58 @@ fetch('compiler.wasm').then(response =>
             return;
         }
 
-        const encoder = new TextEncoder()
-        const strAsUTF8 = encoder.encode(editor.getValue())
-
-        compilerImports.memoryUbytes.set(strAsUTF8, compilerExports.__heap_base);
-
-        const addrAndSize = compilerExports.getWasmFromJava(compilerExports.__heap_base, strAsUTF8.length);
-        const addr = addrAndSize >>> 16;
-        const size = addrAndSize & 0xFFFF;
-
-        const newBytes = compilerImports.memoryUbytes.subarray(addr, addr + size);
+        if (isRunning) {
+            startWorker();
+        }
 
-        if (event.type == "contextmenu") {
-            saveFile("user.wasm", newBytes);
-        } else if (event.currentTarget === disassembleBttn) {
-            printToConsole("\n" + getDisassembly(newBytes, 9) + "\n");
-            document.body.className = "console-mode";
-            
-            if (!activeWasmModule) {
-                document.body.className += " no-active-module";
+        const isRun = event.type != "contextmenu" && event.currentTarget !== disassembleBttn;
+        const currentTarget = event.currentTarget;
+
+        onCompiled = (newBytes, report) => {
+            if (event.type == "contextmenu") {
+                saveFile("user.wasm", newBytes);
+                if (report) {
+                    saveFile("user.size-report.json", JSON.stringify(report, null, 2));
+                }
+            } else if (currentTarget === disassembleBttn) {
+                printToConsole("\n" + getDisassembly(newBytes, 9) + "\n");
+                document.body.className = "console-mode";
+
+                if (!activeWasmModule) {
+                    document.body.className += " no-active-module";
+                }
             }
-        } else {
+        };
+
+        if (isRun) {
             programInput = programInputField.value && programInputField.value.split(/\s/) || [];
             console.log(programInput);
-            compileAndRun(newBytes);
+            startProgram();
         }
+
+        worker.postMessage({type: "compile", source: editor.getValue(), input: programInput, run: isRun});
     }
 
     playBttn.onclick = compileClick;
     disassembleBttn.onclick = compileClick;
     disassembleBttn.oncontextmenu = compileClick;
-    printToConsole("Loaded. An internet connection is no longer required.\n\n");
 });
 
-function compileAndRun(userGeneratedWasmBytes) {
+function startProgram() {
     //clear the console
     consoleOutput.innerHTML = "";
 
-    WebAssembly.instantiate(userGeneratedWasmBytes, runtimeImports)
-    .then((results) => {
-        const runtimeExports = results.instance.exports;
-        if (runtimeExports.memory) {
-            runtimeImports.memoryUbytes = new Uint8Array(runtimeExports.memory.buffer);
-        }
-
-        if (runtimeExports.main) {
-            runtimeExports.main();
-        }
-
-        activeWasmModule = runtimeExports;
-        compileTimestamp = performance.now() / 1000;
-        prevTimeStamp = compileTimestamp;
-        secondsElapsedBeforePause = 0;
-        pauseBttn.classList.remove("active");
+    isRunning = true;
+    activeWasmModule = worker;
+    compileTimestamp = performance.now() / 1000;
+    prevTimeStamp = compileTimestamp;
+    secondsElapsedBeforePause = 0;
+    pauseBttn.classList.remove("active");
+    document.body.className = "console-mode";
 
-        // if (frameRequestId === undefined) {
-        //     frameRequestId = requestAnimationFrame(draw);
-        // }
-        
-        document.body.className = "program-input-mode";
-    });
+    if (drainRequestId === undefined) {
+        drainRequestId = requestAnimationFrame(drainEachFrame);
+    }
 }
 
 function saveFile(filename, content) {
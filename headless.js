@@ -0,0 +1,112 @@
+//compiles and runs a Java program without a page, in a worker thread like the page does.
+//usage: node headless.js Main.java [--profile] [--names] [--lines] [--fuel[=budget]]
+//           [--benchmark[=Main.method]] [--iterations=n] [--warmup=n] [--tiered[=guided]]
+//           [--report[=file]] [--cache[=directory]] [input...]
+//Input the arguments don't give is read from stdin, a line at a time.  --report writes the
+//module's size report as JSON, to size-report.json unless a file is given.  --cache keeps
+//compiled programs in a directory, .java-wasm-cache unless one is given, so compiling the same
+//program again only hashes it
+import {Worker} from "node:worker_threads";
+import {existsSync, readFileSync, writeFileSync} from "node:fs";
+import {createInterface} from "node:readline";
+import {OutputRing, InputChannel} from "./runtime.js";
+
+const DRAIN_MILLISECONDS = 4;
+
+const options = {};
+const input = [];
+let sourcePath;
+
+for (const arg of process.argv.slice(2)) {
+    const option = /^--(\w+)(?:=(.*))?$/.exec(arg);
+    if (option) {
+        const value = option[2];
+        options[option[1]] = value === undefined ? "" : isNaN(value) ? value : +value;
+    } else if (sourcePath === undefined) {
+        sourcePath = arg;
+    } else {
+        input.push(arg);
+    }
+}
+
+if (sourcePath === undefined) {
+    process.stderr.write("usage: node headless.js Main.java [options] [input...]\n");
+    process.exit(1);
+}
+
+const compilerUrl = new URL("./compiler.wasm", import.meta.url);
+if (!existsSync(compilerUrl)) {
+    process.stderr.write("compiler.wasm isn't built; run npm run build first\n");
+    process.exit(1);
+}
+
+options.profile = options.profile !== undefined;
+options.names = options.names !== undefined;
+options.lines = options.lines !== undefined;
+if (options.fuel === "") {
+    options.fuel = 100000;
+}
+const reportPath = options.report === "" ? "size-report.json" : options.report;
+options.cacheDirectory = options.cache === "" ? ".java-wasm-cache" : options.cache;
+options.cache = options.cache !== undefined;
+
+const outputRing = OutputRing.create();
+const inputChannel = InputChannel.create();
+const worker = new Worker(new URL("./worker.js", import.meta.url));
+
+let stdinLines;
+let isStdinDone = false;
+
+//stdin is only read once the program asks for more than the arguments gave it
+function getLine() {
+    if (!stdinLines) {
+        stdinLines = [];
+        const reader = createInterface({input: process.stdin});
+        reader.on("line", line => stdinLines.push(...line.split(/\s+/).filter(word => word)));
+        reader.on("close", () => isStdinDone = true);
+    }
+
+    if (stdinLines.length > 0) {
+        return stdinLines.shift();
+    }
+    return isStdinDone ? "" : undefined;
+}
+
+function drain() {
+    const bytes = outputRing.read();
+    if (bytes.length > 0) {
+        process.stdout.write(bytes);
+    }
+    inputChannel.serveInput(getLine);
+}
+
+const drainTimer = setInterval(drain, DRAIN_MILLISECONDS);
+
+worker.on("message", message => {
+    if (message.type === "ready") {
+        worker.postMessage({type: "compile", source: readFileSync(sourcePath, "utf8"), input, run: true});
+    } else if (message.type === "output") {
+        process.stdout.write(message.bytes);
+    } else if (message.type === "compiled" && message.report) {
+        writeFileSync(reportPath, JSON.stringify(message.report, null, 2) + "\n");
+    } else if (message.type === "exited") {
+        drain();
+        clearInterval(drainTimer);
+        worker.terminate();
+        process.stdin.destroy();
+    }
+});
+
+worker.on("error", error => {
+    process.stderr.write(error.stack + "\n");
+    process.exitCode = 1;
+    clearInterval(drainTimer);
+});
+
+worker.postMessage({
+    type: "init",
+    compilerBytes: readFileSync(compilerUrl),
+    outputBuffer: outputRing.buffer,
+    inputBuffer: inputChannel.buffer,
+    options,
+});
@@ -0,0 +1,412 @@
+//the host side of compiled programs and of the compiler, shared by the page and the worker that
+//runs them.  Nothing here needs a page, so it runs under node's worker_threads as well.  A
+//program's output goes through an OutputRing to whoever shows it, and its input comes through
+//an InputChannel, when the worker and its host can share memory
+
+const encoder = new TextEncoder();
+
+//a lock-free ring of bytes with one writer, the worker, and one reader, its host.  The first two
+//words of the buffer count the bytes written and read so far, which wrap around at 2^32, and the
+//bytes follow them.  A writer that fills the ring waits until the reader makes room
+export class OutputRing {
+    static create(capacity = 1 << 16) {
+        return new OutputRing(new SharedArrayBuffer(8 + capacity));
+    }
+
+    constructor(buffer) {
+        this.buffer = buffer;
+        this.counts = new Int32Array(buffer, 0, 2);
+        this.bytes = new Uint8Array(buffer, 8);
+        this.mask = this.bytes.length - 1;
+    }
+
+    write(bytes) {
+        const capacity = this.bytes.length;
+        let offset = 0;
+
+        while (offset < bytes.length) {
+            const written = Atomics.load(this.counts, 0);
+            const read = Atomics.load(this.counts, 1);
+            const room = capacity - ((written - read) >>> 0);
+            if (room === 0) {
+                Atomics.wait(this.counts, 1, read);
+                continue;
+            }
+
+            const start = written & this.mask;
+            const size = Math.min(room, bytes.length - offset, capacity - start);
+            this.bytes.set(bytes.subarray(offset, offset + size), start);
+            Atomics.store(this.counts, 0, (written + size) | 0);
+            offset += size;
+        }
+    }
+
+    //a copy of the bytes written since the last read.  TextDecoder can't read shared memory
+    read() {
+        const written = Atomics.load(this.counts, 0);
+        const read = Atomics.load(this.counts, 1);
+        const size = (written - read) >>> 0;
+        const start = read & this.mask;
+        const end = Math.min(start + size, this.bytes.length);
+
+        const bytes = new Uint8Array(size);
+        bytes.set(this.bytes.subarray(start, end));
+        bytes.set(this.bytes.subarray(0, size - (end - start)), end - start);
+
+        Atomics.store(this.counts, 1, written);
+        Atomics.notify(this.counts, 1);
+        return bytes;
+    }
+}
+
+//the words of an InputChannel
+const PAUSED = 0;
+const INPUT_STATE = 1;
+const INPUT_SIZE = 2;
+
+const NO_INPUT = 0;
+const INPUT_REQUESTED = 1;
+const INPUT_READY = 2;
+
+//lets the worker wait for its host.  A program that needs input asks for it, and sleeps until the
+//host writes it into the channel.  A fueled program sleeps while the host has it paused
+export class InputChannel {
+    static create(capacity = 1024) {
+        return new InputChannel(new SharedArrayBuffer(12 + capacity));
+    }
+
+    constructor(buffer) {
+        this.buffer = buffer;
+        this.words = new Int32Array(buffer, 0, 3);
+        this.bytes = new Uint8Array(buffer, 12);
+    }
+
+    //on the worker's side
+    readLine() {
+        Atomics.store(this.words, INPUT_STATE, INPUT_REQUESTED);
+        while (Atomics.load(this.words, INPUT_STATE) !== INPUT_READY) {
+            Atomics.wait(this.words, INPUT_STATE, INPUT_REQUESTED);
+        }
+
+        const bytes = this.bytes.slice(0, Atomics.load(this.words, INPUT_SIZE));
+        Atomics.store(this.words, INPUT_STATE, NO_INPUT);
+        return new TextDecoder().decode(bytes);
+    }
+
+    waitWhilePaused() {
+        while (Atomics.load(this.words, PAUSED)) {
+            Atomics.wait(this.words, PAUSED, 1);
+        }
+    }
+
+    //on the host's side.  getLine is only called once the program asks for input, and can return
+    //undefined to answer later
+    serveInput(getLine) {
+        if (Atomics.load(this.words, INPUT_STATE) !== INPUT_REQUESTED) {
+            return;
+        }
+
+        const line = getLine();
+        if (line === undefined) {
+            return;
+        }
+
+        const {written} = encoder.encodeInto(String(line), this.bytes);
+        Atomics.store(this.words, INPUT_SIZE, written);
+        Atomics.store(this.words, INPUT_STATE, INPUT_READY);
+        Atomics.notify(this.words, INPUT_STATE);
+    }
+
+    setPaused(isPaused) {
+        Atomics.store(this.words, PAUSED, isPaused ? 1 : 0);
+        Atomics.notify(this.words, PAUSED);
+    }
+}
+
+//the digits of a number as Java's Double.toString, or Float.toString when isFloat, gives them:
+//the fewest that read back as the same double or float, but at least two, closest to the
+//number.  Returns the digits, without trailing zeros, and the exponent of the first
+function getShortestDigits(num, isFloat) {
+    const magnitude = Math.abs(num);
+    let text = magnitude.toExponential();
+    for (let precision = 2; isFloat && precision <= 9; ++precision) {
+        text = magnitude.toExponential(precision - 1);
+        if (Math.fround(+text) === magnitude) {
+            break;
+        }
+    }
+    if (!text.includes(".")) {
+        text = magnitude.toExponential(1);
+    }
+
+    const [mantissa, exponent] = text.split("e");
+    return {digits: mantissa.replace(".", "").replace(/0+$/, "") || "0", exponent: +exponent};
+}
+
+//format a number as Java does: plain from 10^-3 up to 10^7 and in computerized scientific
+//notation outside of that, such as 1.0E7, with at least one digit after the point
+export function formatNumber(num, isFloat) {
+    if (!isFinite(num)) {
+        return isNaN(num) ? "NaN" : num > 0 ? "Infinity" : "-Infinity";
+    }
+    if (num === 0) {
+        return 1 / num < 0 ? "-0.0" : "0.0";
+    }
+
+    const sign = num < 0 ? "-" : "";
+    const {digits, exponent} = getShortestDigits(num, isFloat);
+
+    if (exponent < -3 || exponent >= 7) {
+        return `${sign}${digits[0]}.${digits.slice(1) || "0"}E${exponent}`;
+    }
+    if (exponent < 0) {
+        return `${sign}0.${"0".repeat(-exponent - 1)}${digits}`;
+    }
+
+    const integerDigits = digits.slice(0, exponent + 1).padEnd(exponent + 1, "0");
+    return `${sign}${integerDigits}.${digits.slice(exponent + 1) || "0"}`;
+}
+
+//the imports of the compiler or of a program.  Their output is handed to write as UTF-8, and
+//readLine gives nextF32 its input
+export function createRuntime(write, readLine) {
+    const self = this;
+
+    //growing memory replaces its buffer, which leaves views of the old buffer empty
+    function getMemoryUbytes() {
+        if (self.memory && self.memoryUbytes.buffer !== self.memory.buffer) {
+            self.memoryUbytes = new Uint8Array(self.memory.buffer);
+        }
+        return self.memoryUbytes;
+    }
+
+    function print(text) {
+        write(encoder.encode(text));
+    }
+
+    //Strings are a header of length, hash, capacity and coder, followed by their characters,
+    //which are Latin-1 when the coder is 0 and UTF-16 otherwise
+    function readString(address) {
+        if (address === 0) {
+            return "null";
+        }
+
+        const view = new DataView(getMemoryUbytes().buffer);
+        const length = view.getInt32(address, true);
+        const isUTF16 = view.getUint8(address + 12) !== 0;
+
+        let text = "";
+        for (let i = 0; i < length; ++i) {
+            text += String.fromCharCode(isUTF16 ? view.getUint16(address + 16 + 2 * i, true) : view.getUint8(address + 16 + i));
+        }
+        return text;
+    }
+
+    //append ASCII text to a String that has room for it
+    function appendText(address, text) {
+        const view = new DataView(getMemoryUbytes().buffer);
+        const isUTF16 = view.getUint8(address + 12) !== 0;
+        let length = view.getInt32(address, true);
+
+        for (const c of text) {
+            if (isUTF16) {
+                view.setUint16(address + 16 + 2 * length, c.charCodeAt(0), true);
+            } else {
+                view.setUint8(address + 16 + length, c.charCodeAt(0));
+            }
+            ++length;
+        }
+
+        view.setInt32(address, length, true);
+    }
+
+    this.env = {
+        puts(address, size) {
+            write(getMemoryUbytes().subarray(address, address + size));
+        },
+
+        //the compiler's debug output goes where its other output does, a line at a time
+        logs(address, size) {
+            write(getMemoryUbytes().slice(address, address + size));
+            print("\n");
+        },
+
+        put(char) {
+            print(String.fromCharCode(char));
+        },
+
+        putbool(value) {
+            print(String(!!value));
+        },
+
+        puti32(num) {
+            print(String(num));
+        },
+
+        puti64(num) {
+            print(String(num));
+        },
+
+        logi32(num) {
+            print(num + "\n");
+        },
+
+        now() {
+            return performance.now();
+        },
+
+        nanoTime() {
+            return performance.now() * 1e6;
+        },
+
+        currentTimeMillis() {
+            return Date.now();
+        },
+
+        //JavaScript's % on numbers is C's fmod, which is Java's floating point remainder
+        fmod(x, y) {
+            return x % y;
+        },
+
+        putf32(num) {
+            print(formatNumber(num, true));
+        },
+
+        putf64(num) {
+            print(formatNumber(num, false));
+        },
+
+        putString(address) {
+            print(readString(address));
+        },
+
+        //append a double to a String that has room for it
+        appendNumber(address, num) {
+            appendText(address, formatNumber(num, false));
+        },
+
+        appendFloat(address, num) {
+            appendText(address, formatNumber(num, true));
+        },
+
+        nextF32() {
+            const input = readLine();
+            print(input + "\n");
+            return +input;
+        },
+
+        //wasm has no unsigned type, so the u32 arrives as the i32 with the same bits
+        putu32(num) {
+            print(String(num >>> 0));
+        }
+    };
+
+    this.Math = Math;
+
+    this.useModule = function(moduleExports) {
+        if (moduleExports.memory) {
+            self.memoryUbytes = new Uint8Array(moduleExports.memory.buffer);
+            self.memory = moduleExports.memory;
+        }
+    }
+
+    //print how often each site of a module compiled for profiling ran, most often first
+    this.printProfile = function(moduleExports) {
+        const rows = readProfile(moduleExports);
+        if (!rows) {
+            return;
+        }
+
+        rows.sort((a, b) => b.count - a.count);
+
+        let report = "\nProfile\n";
+        for (const row of rows) {
+            report += `line ${row.line} ${row.kind}: ${row.count}\n`;
+        }
+        print(report);
+    }
+}
+
+//how often each site of a module compiled for profiling ran so far, or undefined for a module
+//that wasn't.  The module exports the address of its counters as the global profile
+export function readProfile(moduleExports) {
+    if (!moduleExports.profile) {
+        return undefined;
+    }
+
+    const kinds = ["method entry", "loop back edge", "branch"];
+    const view = new DataView(moduleExports.memory.buffer);
+    const address = moduleExports.profile.value;
+    const siteCount = view.getUint32(address, true);
+    const rows = [];
+
+    for (let i = 0; i < siteCount; ++i) {
+        const site = view.getUint32(address + 4 + 8 * i, true);
+        const count = view.getUint32(address + 8 + 8 * i, true);
+        rows.push({line: site >>> 2, kind: kinds[site & 3], count});
+    }
+    return rows;
+}
+
+//instantiate a module's bytes or a compiled WebAssembly.Module.  Returns the instance
+export async function instantiate(module, imports) {
+    const result = await WebAssembly.instantiate(module, imports);
+    return result.instance || result;
+}
+
+//the stats block the compiler fills in during each call to getWasmFromJava
+export function readCompileStats(compilerExports) {
+    const phases = ["prescan", "declarations", "headers", "code", "data"];
+    const counters = ["tokensLexed", "symbolLookups", "symbolProbes", "methodsCompiled", "moduleBytes"];
+    const sections = ["custom", "type", "import", "function", "table", "memory", "global", "export", "start", "element", "code", "data"];
+
+    const view = new DataView(compilerExports.memory.buffer);
+    let address = compilerExports.getCompileStats();
+    const stats = {phaseMilliseconds: {}, sectionBytes: {}};
+
+    for (const name of phases) {
+        stats.phaseMilliseconds[name] = view.getFloat64(address, true);
+        address += 8;
+    }
+
+    for (const name of counters) {
+        stats[name] = view.getUint32(address, true);
+        address += 4;
+    }
+
+    for (const name of sections) {
+        stats.sectionBytes[name] = view.getUint32(address, true);
+        address += 4;
+    }
+
+    return stats;
+}
+
+//the error that stopped the last call to getWasmFromJava, which returned an empty module
+export function readCompileError(compilerExports) {
+    const view = new DataView(compilerExports.memory.buffer);
+    const address = compilerExports.getCompileError();
+    const message = view.getUint32(address, true);
+    if (message === 0) {
+        return new RangeError("out of memory to compile the program in");
+    }
+
+    const length = view.getUint32(address + 4, true);
+    const line = view.getUint32(address + 8, true);
+    const text = new TextDecoder().decode(new Uint8Array(compilerExports.memory.buffer, message, length));
+    return new SyntaxError(`error on line ${line}: ${text}`);
+}
+
+//the size report of the last module compiled with enableSizeReport(true), or undefined
+export function readSizeReport(compilerExports) {
+    const view = new DataView(compilerExports.memory.buffer);
+    const address = compilerExports.getSizeReport();
+    const start = view.getUint32(address, true);
+    const length = view.getUint32(address + 4, true);
+    if (length === 0) {
+        return undefined;
+    }
+
+    const text = new TextDecoder().decode(new Uint8Array(compilerExports.memory.buffer, start, length));
+    return JSON.parse(text);
+}
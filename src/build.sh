@@ -1,17 +1,41 @@
+ #the runtime library is compiled to an object file first, and the code in it is embedded in
+ #the compiler as library.h.  It's optimized for size, since it's copied into every program
+ #that calls it, and built without builtins, so that clang doesn't turn its loops into calls
+ #to a memcpy the programs don't have.  The library and the compiler are built with bulk memory,
+ #so the copies they do ask for are memory.copy instructions.  The compiler's stack is 64KB,
+ #since the parser and the escape analysis recurse, and the analysis keeps each method's
+ #parameter names on it.  compiler.wasm is checked in, so commit it along with changes to
+ #src/.  With no arguments this builds it from main.cpp, next to the pages that load it
+ #usage: src/build.sh [main.cpp] [compiler.wasm]
+ LIBRARY_DIR="$(dirname "$0")"
+ SOURCE="${1:-$LIBRARY_DIR/main.cpp}"
+ OUTPUT="${2:-$LIBRARY_DIR/../compiler.wasm}"
+ clang \
+   --target=wasm32 \
+   -std=c++14 \
+   -Oz \
+   -nostdlib \
+   -fno-builtin \
+   -mbulk-memory \
+   -c \
+   -o "$LIBRARY_DIR/library.o" \
+   "$LIBRARY_DIR/library.cpp" &&
+ node "$LIBRARY_DIR/embed-library.js" "$LIBRARY_DIR/library.o" > "$LIBRARY_DIR/library.h" &&
  clang \
    --target=wasm32 \
    -std=c++14 \
    -O3 \
    -flto \
    -Ofast \
+   -mbulk-memory \
    -nostdlib \
    -Wl,--no-entry \
    -Wl,--allow-undefined \
    -Wl,--strip-all \
    -Wl,--export-dynamic \
-   -Wl,-z,stack-size=$[1024] \
+   -Wl,-z,stack-size=$[64 * 1024] \
    -Wl,--stack-first \
    -Wl,--no-merge-data-segments \
    -Wl,--lto-O3 \
-   -o "$2" \
-   "$1"
+   -o "$OUTPUT" \
+   "$SOURCE"
@@ -0,0 +1,268 @@
+//turns the object file clang compiles library.cpp into, into library.h.  The compiler copies
+//the code of each function into the programs that call it, so every call the code makes is
+//cut out of it and listed separately, for the compiler to emit with the function ids it uses.
+//usage: node embed-library.js library.o > library.h
+const fs = require("fs");
+
+const bytes = fs.readFileSync(process.argv[2]);
+let pos = 8;
+
+function fail(message) {
+    process.stderr.write("embed-library: " + message + "\n");
+    process.exit(1);
+}
+
+function readVaruint() {
+    let value = 0;
+    let shift = 0;
+    let byte;
+    do {
+        byte = bytes[pos++];
+        value += (byte & 0x7F) * 2 ** shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+function readName() {
+    const length = readVaruint();
+    const name = bytes.toString("utf8", pos, pos + length);
+    pos += length;
+    return name;
+}
+
+const signatures = [];
+const functionTypes = [];
+let functionImportCount = 0;
+let codeStart;
+let codeEnd;
+let symbols = [];
+let relocations = [];
+
+const SECTION_TYPE = 1;
+const SECTION_IMPORT = 2;
+const SECTION_FUNCTION = 3;
+const SECTION_CODE = 10;
+const SECTION_DATA = 11;
+
+const SYMBOL_FUNCTION = 0;
+const SYMBOL_DATA = 1;
+const SYMBOL_SECTION = 3;
+const SYMBOL_UNDEFINED = 0x10;
+const SYMBOL_EXPLICIT_NAME = 0x40;
+
+const R_WASM_FUNCTION_INDEX_LEB = 0;
+
+function readImports() {
+    const count = readVaruint();
+    for (let i = 0; i < count; ++i) {
+        const module = readName();
+        const name = readName();
+        const kind = bytes[pos++];
+        if (kind === 0) {
+            readVaruint();
+            ++functionImportCount;
+        } else if (kind === 1) { //table
+            ++pos;
+            if (bytes[pos++] & 1) readVaruint();
+            readVaruint();
+        } else if (kind === 2) { //memory
+            if (bytes[pos++] & 1) readVaruint();
+            readVaruint();
+        } else {
+            fail(`library routines can't use globals, but they use ${module}.${name}`);
+        }
+    }
+}
+
+function readSymbolTable() {
+    const count = readVaruint();
+    for (let i = 0; i < count; ++i) {
+        const kind = bytes[pos++];
+        const flags = readVaruint();
+        const symbol = {kind, flags};
+
+        if (kind === SYMBOL_DATA) {
+            symbol.name = readName();
+            if (!(flags & SYMBOL_UNDEFINED)) {
+                readVaruint();
+                readVaruint();
+                readVaruint();
+            }
+        } else if (kind === SYMBOL_SECTION) {
+            symbol.index = readVaruint();
+        } else {
+            symbol.index = readVaruint();
+            if (!(flags & SYMBOL_UNDEFINED) || (flags & SYMBOL_EXPLICIT_NAME)) {
+                symbol.name = readName();
+            }
+        }
+        symbols.push(symbol);
+    }
+}
+
+function readLinking(end) {
+    readVaruint(); //version
+    while (pos < end) {
+        const type = bytes[pos++];
+        const size = readVaruint();
+        const subsectionEnd = pos + size;
+        if (type === 8) {
+            readSymbolTable();
+        }
+        pos = subsectionEnd;
+    }
+}
+
+function readCodeRelocations() {
+    readVaruint(); //the section they apply to
+    const count = readVaruint();
+    for (let i = 0; i < count; ++i) {
+        const type = bytes[pos++];
+        const offset = readVaruint();
+        const symbol = readVaruint();
+        relocations.push({type, offset, symbol});
+    }
+}
+
+while (pos < bytes.length) {
+    const id = bytes[pos++];
+    const size = readVaruint();
+    const end = pos + size;
+
+    if (id === SECTION_TYPE) {
+        const count = readVaruint();
+        for (let i = 0; i < count; ++i) {
+            const start = pos++;
+            const paramCount = readVaruint();
+            pos += paramCount;
+            const resultCount = readVaruint();
+            pos += resultCount;
+            signatures.push([...bytes.subarray(start, pos)]);
+        }
+    } else if (id === SECTION_IMPORT) {
+        readImports();
+    } else if (id === SECTION_FUNCTION) {
+        const count = readVaruint();
+        for (let i = 0; i < count; ++i) {
+            functionTypes.push(readVaruint());
+        }
+    } else if (id === SECTION_CODE) {
+        codeStart = pos;
+        codeEnd = end;
+    } else if (id === SECTION_DATA) {
+        fail("library routines can't have static data");
+    } else if (id === 0) {
+        const name = readName();
+        if (name === "linking") {
+            readLinking(end);
+        } else if (name === "reloc.CODE") {
+            readCodeRelocations();
+        }
+    }
+
+    pos = end;
+}
+
+if (codeStart === undefined) {
+    fail("there's no code section");
+}
+
+//the defined functions, named after their symbols
+const functions = functionTypes.map(type => ({signature: signatures[type], calls: []}));
+for (const symbol of symbols) {
+    if (symbol.kind === SYMBOL_FUNCTION && !(symbol.flags & SYMBOL_UNDEFINED)) {
+        functions[symbol.index - functionImportCount].name = symbol.name;
+    }
+}
+
+//relocation offsets are from the start of the code section's contents
+pos = codeStart;
+readVaruint(); //# of functions
+for (const f of functions) {
+    const size = readVaruint();
+    f.start = pos - codeStart;
+    f.end = f.start + size;
+    pos += size;
+}
+
+for (const r of relocations) {
+    const symbol = symbols[r.symbol];
+    if (r.type !== R_WASM_FUNCTION_INDEX_LEB) {
+        fail(`relocation type ${r.type} against ${symbol.name} isn't supported. Library routines can only call each other`);
+    } else if (symbol.flags & SYMBOL_UNDEFINED) {
+        fail(`${symbol.name} isn't defined in the library`);
+    } else if (bytes[codeStart + r.offset - 1] !== 0x10) {
+        fail(`${symbol.name} is referred to other than by a call`);
+    }
+
+    const caller = functions.find(f => f.start <= r.offset && r.offset < f.end);
+    caller.calls.push({offset: r.offset - 1, callee: symbol.index - functionImportCount});
+}
+
+//the code of every function, with the call instructions removed.  A call is a call opcode
+//followed by a function index padded to 5 bytes
+const code = [];
+const codeStarts = [];
+const callOffsets = [];
+const callees = [];
+const callStarts = [];
+for (const f of functions) {
+    f.calls.sort((a, b) => a.offset - b.offset);
+    codeStarts.push(code.length);
+    callStarts.push(callOffsets.length);
+
+    let src = codeStart + f.start;
+    for (const call of f.calls) {
+        code.push(...bytes.subarray(src, codeStart + call.offset));
+        callOffsets.push(code.length);
+        callees.push(call.callee);
+        src = codeStart + call.offset + 6;
+    }
+    code.push(...bytes.subarray(src, codeStart + f.end));
+}
+codeStarts.push(code.length);
+callStarts.push(callOffsets.length);
+
+function hexList(values, perLine) {
+    const lines = [];
+    for (let i = 0; i < values.length; i += perLine) {
+        lines.push("    " + values.slice(i, i + perLine).map(v => "0x" + v.toString(16).padStart(2, "0")).join(", ") + ",");
+    }
+    return lines.join("\n");
+}
+
+const out = [];
+out.push(`//generated from library.cpp by embed-library.js.  Don't edit it
+
+//functions of the library, in the order they're appended to the code section after the String
+//runtime
+struct library {
+    enum {
+${functions.map(f => `        ${f.name},`).join("\n")}
+        count,
+    };
+};
+
+const char* LIBRARY_NAMES[library::count] = {
+${functions.map(f => `    "${f.name}",`).join("\n")}
+};
+
+//the type of each function, one after another
+const u8 LIBRARY_SIGNATURES[] = {
+${functions.map(f => "    " + f.signature.map(v => "0x" + v.toString(16).padStart(2, "0")).join(", ") + ",").join("\n")}
+};
+
+//the code of each function, from its locals to its end, without the calls it makes.  Each call
+//is emitted where it was cut out, calling the function after it in LIBRARY_CALLEES
+const u8 LIBRARY_CODE[] = {
+${hexList(code, 16)}
+};
+
+const u16 LIBRARY_CODE_STARTS[library::count + 1] = {${codeStarts.join(", ")}};
+const u16 LIBRARY_CALL_STARTS[library::count + 1] = {${callStarts.join(", ")}};
+const u16 LIBRARY_CALL_OFFSETS[] = {${callOffsets.join(", ") || 0}};
+const u8 LIBRARY_CALLEES[] = {${callees.join(", ") || 0}};
+`);
+
+process.stdout.write(out.join("\n"));
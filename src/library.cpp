@@ -0,0 +1,131 @@
+//routines of the Java runtime that are compiled to wasm ahead of time.  build.sh compiles this
+//into an object file, and embed-library.js turns the function bodies in it into library.h,
+//which the compiler links into the programs that call them.  The routines may call each
+//other, but there are no globals, static data or shadow stack in the programs they're linked
+//into, so they can't use any
+#include "wasm_definitions.h"
+
+#define LIBRARY extern "C" __attribute__((visibility("default")))
+
+//a String in linear memory.  See string in main.cpp
+struct String {
+    u32 length;
+    i32 hash;
+    u32 capacity;
+    u32 coder;
+    u8 chars[4];
+};
+
+//copy n bytes.  Built with bulk memory, this is a memory.copy
+LIBRARY void* copyMemory(void* dest, const void* src, u32 n) {
+    return __builtin_memcpy(dest, src, n);
+}
+
+inline u16* getWideChars(const String* str) {
+    return (u16*) str->chars;
+}
+
+inline void setChar(String* str, u32 index, u32 c) {
+    if (str->coder) {
+        getWideChars(str)[index] = c;
+    } else {
+        str->chars[index] = c;
+    }
+}
+
+inline u32 getChar(const String* str, u32 index) {
+    return str->coder ? getWideChars(str)[index] : str->chars[index];
+}
+
+//appendChars(str, other).  str must have room for the characters of other, and be UTF-16 if
+//any of them need it.  Strings with the same coder are copied as they are
+LIBRARY void appendChars(String* str, const String* other) {
+    u32 length = other->length;
+
+    if (str->coder == other->coder) {
+        copyMemory(str->chars + (str->length << str->coder), other->chars, length << other->coder);
+    } else {
+        for (u32 i = 0; i < length; ++i) {
+            setChar(str, str->length + i, getChar(other, i));
+        }
+    }
+
+    str->length += length;
+}
+
+//appendLong(str, value).  The digits are written from the least significant up, once how many
+//there are is known.  Most values fit in 32 bits, which are cheaper to divide
+LIBRARY void appendLong(String* str, i64 value) {
+    u64 magnitude = value < 0 ? 0 - (u64) value : (u64) value;
+
+    u32 digitCount = 1;
+    for (u64 rest = magnitude; rest >= 10; rest /= 10) {
+        ++digitCount;
+    }
+
+    u32 end = str->length + (value < 0) + digitCount;
+    u32 i = end;
+    for (; magnitude > 0xFFFFFFFF; magnitude /= 10) {
+        setChar(str, --i, '0' + magnitude % 10);
+    }
+
+    u32 low = (u32) magnitude;
+    do {
+        setChar(str, --i, '0' + low % 10);
+        low /= 10;
+    } while (low != 0);
+
+    if (value < 0) {
+        setChar(str, --i, '-');
+    }
+
+    str->length = end;
+}
+
+//hashCode(str).  Computed as Java does, and cached in the String
+LIBRARY i32 hashCode(String* str) {
+    u32 hash = str->hash;
+
+    if (hash == 0) {
+        for (u32 i = 0; i < str->length; ++i) {
+            hash = 31 * hash + getChar(str, i);
+        }
+        str->hash = hash;
+    }
+
+    return hash;
+}
+
+//equals(str, other).  Strings with the same characters are equal whatever their coders.
+//Equal hashes are only worth comparing once both have been computed
+LIBRARY bool equals(const String* str, const String* other) {
+    if (str == other) {
+        return true;
+    }
+
+    if (other == 0 || str->length != other->length) {
+        return false;
+    }
+
+    if (str->hash != 0 && other->hash != 0 && str->hash != other->hash) {
+        return false;
+    }
+
+    if (str->coder == other->coder) {
+        u32 size = str->length << str->coder;
+        for (u32 i = 0; i < size; ++i) {
+            if (str->chars[i] != other->chars[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    for (u32 i = 0; i < str->length; ++i) {
+        if (getChar(str, i) != getChar(other, i)) {
+            return false;
+        }
+    }
+
+    return true;
+}
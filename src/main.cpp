@@ -4,10 +4,12 @@
 #define LOG_LIT(lit) logs((char *)lit, sizeof(lit) - 1)
 #define memcpy __builtin_memcpy
 #define memset __builtin_memset
-#define HASH(lit) getIdentifierHash((char *)lit, sizeof(lit) - 1)
+#define memmove __builtin_memmove
+#define HASH(lit) getIdentifierHash(lit, sizeof(lit) - 1)
 #define INSERT_LIT(lit, writePos) *writePos++ = sizeof(lit) - 1; memcpy(writePos, lit, sizeof(lit) - 1); writePos += sizeof(lit) - 1;
 
 #include "wasm_definitions.h"
+#include "library.h"
 
 extern u8 __data_end;
 extern u8 __heap_base;
@@ -15,843 +17,7806 @@ extern u8 __heap_base;
 char *readPos, *endReadPos;
 u8 *writePos;
 
-//limitation of max 32 global and local vars combined.  TODO allow unlimited
+//limitation of max 256 global and local vars combined.  Sources with more fail to compile.
 //local var metadata is located immediately after the last global variable metadata
-u32 varHashes[32] = {0};
-u8 varTypes[32] = {0};
+const u32 MAX_VARS = 256;
+u32 varHashes[MAX_VARS] = {0};
+u8 varTypes[MAX_VARS] = {0};
+bool varIsBusy[MAX_VARS] = {0}; //only meaningful for scratch locals, which have a hash of 0
+u32 varFirstScalar[MAX_VARS]; //first of the locals holding the fields of a scalar replaced object, or -1
+char* varNames[MAX_VARS];     //the identifier a local was declared with, or 0.  Only kept for the name section
+
+//locals the compiler keeps for longer than one statement, such as the fields of scalar
+//replaced objects.  No identifier hashes to 1, so they're never found by name
+const u32 HIDDEN_HASH = 1;
 u32 globalVarCount = 0;
+u32 totalVarCount = 0;
 u32 initialDataSize = 0;
 
+//every string literal in the source is copied into the data section up front.  These
+//record where each one was found and where it was placed
+const u32 MAX_STRING_LITERALS = 1024;
+char* stringLiteralSourcePos[MAX_STRING_LITERALS];
+char* stringLiteralEndPos[MAX_STRING_LITERALS]; //past the last literal concatenated onto it
+u32 stringLiteralDataOffset[MAX_STRING_LITERALS];
+u32 stringLiteralCount = 0;
+
+//the data section is built in the output buffer, in front of where the module will go
+u8* dataStart;
+
+//Strings appended in place of null and of booleans
+u32 nullStringAddress = 0;
+u32 trueStringAddress = 0;
+u32 falseStringAddress = 0;
+
+//static final fields with constant initializers never become globals.  Their values are
+//substituted wherever they're used instead
+const u32 MAX_CONSTANTS = 256;
+u32 constantHashes[MAX_CONSTANTS];
+u32 constantCount = 0;
+
+//classes, fields and methods are all collected by scanProgram() before any code is generated
+struct Class {
+    u32 hash;
+    char* name;         //its identifier in the source
+    u32 size;           //bytes used by the fields of an instance, including those it inherits
+    u32 superclass;     //the class it extends, or -1
+    u16 firstField;
+    u16 fieldCount;
+    u16 vtableStart;    //index of its vtable in the table.  Objects with a header store it there
+    u8 slotCount;       //entries in its vtable, one for each instance method it has
+    bool hasHeader;     //whether its objects start with their class, for calls to dispatch on
+    bool isInstantiated;
+    bool isComplete;    //whether its layout and vtable are known
+};
+
+struct Field {
+    u32 hash;
+    u32 offset;         //from the start of the object
+    char* initializer;  //first token of the initializer expression, or 0
+    u8 type;
+};
+
+struct Method {
+    char* parameterList; //the '(' following the name.  0 for an implicit constructor and <clinit>
+    u32 hash;            //constructors are named <init>, and the static initializer <clinit>
+    u16 firstParam;      //index of the first parameter's type in paramTypes
+    u8 paramCount;       //not including this
+    u8 returnType;
+    u8 classIndex;
+    u8 slot;             //of an instance method in the vtables.  Overriding methods share it
+    bool isStatic;
+};
+
+const u32 MAX_CLASSES = 64;
+Class classes[MAX_CLASSES];
+u32 classCount = 0;
+
+const u32 MAX_FIELDS = 256;
+Field fields[MAX_FIELDS];
+u32 fieldCount = 0;
+
+const u32 MAX_METHODS = 128;
+Method methods[MAX_METHODS];
+u32 methodCount = 0;
+u32 mainMethod = -1;
+u32 staticInitializerMethod = -1; //-1 when there are no static initializers
+
+const u32 MAX_PARAMS = 512;
+u8 paramTypes[MAX_PARAMS];
+u32 paramTypeCount = 0;
+
+//the names that follow new anywhere in the source.  Only the classes named there have
+//instances, so only their methods can be the targets of virtual calls.  When there are too
+//many names to keep, every class is taken to have instances
+const u32 MAX_INSTANTIATED_NAMES = 2 * MAX_CLASSES;
+u32 instantiatedHashes[MAX_INSTANTIATED_NAMES];
+u32 instantiatedHashCount = 0;
+
+//the vtables of the classes with instances and a header, one after another.  Each entry is the
+//method one of a class's slots runs.  The table is only emitted when a call that main reaches
+//is dispatched through it
+u8 tableEntries[MAX_CLASSES * MAX_METHODS];
+u32 tableEntryCount = 0;
+bool usesTable = false;
+
+//what the code being compiled can refer to
+u32 currentClass = 0;
+bool inStaticContext = true;
+u8 currentReturnType = 0;
+
+//objects are allocated by a function appended after the methods, which bumps a global
+//placed after the user's globals
+bool usesAllocator = false;
+
+//Strings that are more than printed need the String runtime, which follows the allocator
+bool usesStrings = false;
+
+//in profiling mode, method entries, loop back edges and branch arms each count how often they
+//run.  The counters are in a region of memory between the data and the stack, which starts
+//with the number of sites and is followed by a (site, count) pair for each of them.  A site
+//is its source line shifted left by 2, or'ed with its kind.  The region's address is exported
+//as the global profile
+struct profile {
+    enum {
+        MethodEntry,
+        BackEdge,
+        BranchArm,
+    };
+};
+
+const u32 MAX_PROFILE_SITES = 1024;
+char* profileSitePos[MAX_PROFILE_SITES]; //the code a site counts.  Inlined copies share its counter
+u8 profileSiteKind[MAX_PROFILE_SITES];
+u32 profileSiteCount = 0;
+u32 maxProfileSites = 0; //the room reserved for sites, found while scanning
+u32 profileStart = 0;
+bool isProfiling = false;
+char* sourceStart;
+
+EXPORT void enableProfiling(bool isEnabled) {
+    isProfiling = isEnabled;
+}
+
+//optional debug info.  The name section gives profilers and stack traces the Java names of
+//functions and locals.  The line table, a custom section named "lines", maps the offset in the
+//module of each statement's code to its source line.  It's a varuint count followed by a
+//(varuint offset, varint line) pair per entry, each relative to the entry before it
+bool emitsNameSection = false;
+bool emitsLineTable = false;
+
+EXPORT void enableNameSection(bool isEnabled) {
+    emitsNameSection = isEnabled;
+}
+
+EXPORT void enableLineTable(bool isEnabled) {
+    emitsLineTable = isEnabled;
+}
+
+//in benchmark mode, a host can time any static method without parameters, not only main, and
+//count what each call allocates.  The methods are exported by their qualified names, e.g.
+//Main.fib.  Programs that allocate also export the top of the heap as heapTop, and the number
+//of objects allocated so far as allocations
+bool isBenchmarking = false;
+
+EXPORT void enableBenchmarking(bool isEnabled) {
+    isBenchmarking = isEnabled;
+}
+
+//in fuel mode, every method entry and loop back edge burns a unit of fuel, a global the module
+//exports as fuel.  When it's out, the program calls the host's yield, which can pause or stop
+//it, and returns the fuel to go on with.  It starts out at 0, so the host sets the budget when
+//the program first yields.  A check is a global load and a branch while there's fuel left
+bool isFueled = false;
+
+EXPORT void enableFuel(bool isEnabled) {
+    isFueled = isEnabled;
+}
+
+//tiers.  The baseline tier skips the optimizations that cost compile time: escape analysis,
+//and the scalar replacement, stack allocation and constructor inlining it allows.  The
+//optimized tier can be guided by the profile of a baseline run.  Once the host adds the lines of
+//its hot sites, only the methods with one of them are optimized
+bool isOptimizing = true;
+bool isMethodOptimized = true; //whether the method being compiled is
+
+const u32 MAX_HOT_LINES = 0x10000;
+u32 hotLines[MAX_HOT_LINES / 32];
+bool hasHotLines = false;
+
+EXPORT void enableOptimization(bool isEnabled) {
+    isOptimizing = isEnabled;
+}
+
+EXPORT void addHotLine(u32 line) {
+    if (line < MAX_HOT_LINES) {
+        hotLines[line / 32] |= 1 << line % 32;
+        hasHotLines = true;
+    }
+}
+
+EXPORT void clearHotLines() {
+    for (u32 i = 0; i < MAX_HOT_LINES / 32; ++i) {
+        hotLines[i] = 0;
+    }
+    hasHotLines = false;
+}
+
+//in tiered mode, a host can switch a running program to another tier of it between calls, and
+//hand the new instance the program's state.  Every tier of a program lays out memory the same
+//way, with room for a profile whether it's profiled or not, and exports its static fields as
+//static0, static1, etc. and the top of its heap as heapTop
+bool isTiered = false;
+
+EXPORT void enableTiering(bool isEnabled) {
+    isTiered = isEnabled;
+}
+
+//the size report is JSON written after the module, of where its bytes went: the bytes of each
+//section and each function, with the bytes each function spends declaring its locals, the
+//bytes of code of each class of instruction, in all and on each source line, and the bytes of
+//data of each string literal.  Functions and literals are given with their lines too
+bool emitsSizeReport = false;
+
+struct SizeReport {
+    u8* start;
+    u32 length; //0 when the report is off
+};
+
+SizeReport sizeReport;
+
+EXPORT void enableSizeReport(bool isEnabled) {
+    emitsSizeReport = isEnabled;
+}
+
+EXPORT SizeReport* getSizeReport() {
+    return &sizeReport;
+}
+
+//the names of every method's locals, one method after another
+const u32 MAX_LOCAL_NAMES = 4096;
+char* localNames[MAX_LOCAL_NAMES];
+u16 firstLocalName[MAX_METHODS + 1];
+
+const u32 MAX_LINE_ENTRIES = 4096;
+u32 lineEntryOffsets[MAX_LINE_ENTRIES];
+u32 lineEntryLines[MAX_LINE_ENTRIES];
+u32 lineEntryCount = 0;
+u8* moduleStart;
+u8* codeStart; //line entries are offsets from here until the code is linked into the module
+
+//objects that don't outlive the method that creates them are allocated from a region between
+//the data and the heap.  Each block frees the objects it allocated when it ends
+const u32 STACK_SIZE = 0x4000;
+const u32 MAX_STACK_OBJECT_SIZE = 64;
+const u32 MAX_ZEROING_STORES = 4;
+u32 stackLimit = 0;
+u32 blockStackSave = -1;    //local holding the stack top from before the current block allocated
+
+//the stack saves of the blocks enclosing the current one, outermost first.  Jumping out of
+//blocks restores the save of the outermost of them that allocated
+const u32 MAX_BLOCK_DEPTH = 256;
+u32 blockStackSaves[MAX_BLOCK_DEPTH];
+u32 blockDepth = 0;
+
+//the statements break and continue can jump out of.  Their levels are how many wasm blocks
+//enclose the block that ends where they jump to
+struct JumpTarget {
+    u32 breakLevel;
+    u32 continueLevel;  //-1 for a switch, which continue passes through
+    u32 blockDepth;     //of the blocks enclosing the statement
+};
+
+const u32 MAX_JUMP_TARGETS = 64;
+JumpTarget jumpTargets[MAX_JUMP_TARGETS];
+u32 jumpTargetCount = 0;
+u32 controlDepth = 0; //wasm blocks enclosing the statement being compiled
+
+//the values of the cases of the switches being compiled, with the group of statements each
+//one jumps to.  Nested switches take the entries after those of the switches enclosing them
+const u32 MAX_SWITCH_CASES = 1024;
+i32 switchCaseValues[MAX_SWITCH_CASES];
+u32 switchCaseGroups[MAX_SWITCH_CASES];
+u32 switchCaseCount = 0;
+
 
 u8 WASM_HEADER[] = {
     0x00, 0x61, 0x73, 0x6d, //magic numbers
     0x01, 0x00, 0x00, 0x00, //wasm version
 };
 
+//Java types without a wasm equivalent.  All of them are represented by an i32 at runtime
+struct java {
+    struct type {
+        enum {
+            boolean = 0x01,
+            _char,
+            String,
+            null,
+            StringBuilder,
+
+            //an instance of classes[type - firstClass]
+            firstClass = 0x80,
+        };
+    };
+};
+
+//function signatures available to the generated module, named after their (params)_(result)
+struct signature {
+    enum {
+        v_v,
+        f32_v,
+        i32_v,
+        i32i32_v,
+        v_f32,
+        f64_v,
+        i64_v,
+        f64_f64,
+        f64f64_f64,
+        i32_i32,
+        i32i32_i32,
+        i32i32i32_i32,
+        i32f32_v,
+        i32f64_v,
+        v_f64,
+        v_i32,
+        count,
+    };
+};
+
+u8 SIGNATURES[] = {
+    wasm::type::func, 0, 0,                                     //() => (void)
+    wasm::type::func, 1, wasm::type::f32, 0,                    //(f32) => (void)
+    wasm::type::func, 1, wasm::type::i32, 0,                    //(i32) => (void)
+    wasm::type::func, 2, wasm::type::i32, wasm::type::i32, 0,   //(i32, i32) => (void)
+    wasm::type::func, 0, 1, wasm::type::f32,                    //() => (f32)
+    wasm::type::func, 1, wasm::type::f64, 0,                    //(f64) => (void)
+    wasm::type::func, 1, wasm::type::i64, 0,                    //(i64) => (void)
+    wasm::type::func, 1, wasm::type::f64, 1, wasm::type::f64,   //(f64) => (f64)
+    wasm::type::func, 2, wasm::type::f64, wasm::type::f64, 1, wasm::type::f64, //(f64, f64) => (f64)
+    wasm::type::func, 1, wasm::type::i32, 1, wasm::type::i32,   //(i32) => (i32)
+    wasm::type::func, 2, wasm::type::i32, wasm::type::i32, 1, wasm::type::i32, //(i32, i32) => (i32)
+    wasm::type::func, 3, wasm::type::i32, wasm::type::i32, wasm::type::i32, 1, wasm::type::i32, //(i32, i32, i32) => (i32)
+    wasm::type::func, 2, wasm::type::i32, wasm::type::f32, 0,   //(i32, f32) => (void)
+    wasm::type::func, 2, wasm::type::i32, wasm::type::f64, 0,   //(i32, f64) => (void)
+    wasm::type::func, 0, 1, wasm::type::f64,                    //() => (f64)
+    wasm::type::func, 0, 1, wasm::type::i32,                    //() => (i32)
+};
+
+struct Import {
+    const char* module;
+    const char* name;
+    u8 signature;
+};
+
+//functions the host provides.  Their function id is their position in this list
+struct host {
+    enum {
+        putf32,
+        put,
+        puts,
+        nextF32,
+        puti32,
+        putbool,
+        putf64,
+        putString,
+        appendNumber,
+        nanoTime,
+        currentTimeMillis,
+        yield,
+        fmod,
+        puti64,
+        appendFloat,
+        count,
+    };
+};
+
+Import HOST_IMPORTS[] = {
+    {"env", "putf32", signature::f32_v},
+    {"env", "put", signature::i32_v},
+    {"env", "puts", signature::i32i32_v},
+    {"env", "nextF32", signature::v_f32},
+    {"env", "puti32", signature::i32_v},
+    {"env", "putbool", signature::i32_v},
+    {"env", "putf64", signature::f64_v},
+    {"env", "putString", signature::i32_v},
+    {"env", "appendNumber", signature::i32f64_v}, //formats a double onto a String
+    {"env", "nanoTime", signature::v_f64}, //a monotonic clock, in nanoseconds
+    {"env", "currentTimeMillis", signature::v_f64}, //the time since the epoch, in milliseconds
+    {"env", "yield", signature::v_i32}, //called when the fuel runs out.  Returns the next budget
+    {"env", "fmod", signature::f64f64_f64}, //the remainder of floats and doubles, which wasm has no instruction for
+    {"env", "puti64", signature::i64_v}, //a long, which JavaScript receives as a BigInt
+    {"env", "appendFloat", signature::i32f32_v}, //formats a float onto a String, at float precision
+};
+
+//Strings are objects in linear memory.  Their characters follow a header, one byte each when
+//all of them fit in Latin-1, and two bytes each (UTF-16) when they don't
+struct string {
+    enum {
+        length = 0,     //in characters
+        hash = 4,       //cached by hashCode().  0 until it's first computed
+        capacity = 8,   //characters there is room for.  Only a StringBuilder's String has spare room
+        coder = 12,     //0 for Latin-1, 1 for UTF-16
+        chars = 16,
+    };
+};
+
+//functions of the String runtime, which are appended to the code section after the allocator.
+//The rest of it is precompiled, in the library that follows them
+struct runtime {
+    enum {
+        stringAlloc,    //(capacity, coder) => String
+        charAt,         //(String, index) => char
+        appendChar,     //(String, char) => void
+        appendString,   //(String, String) => void
+        reserve,        //(StringBuilder, chars, coder) => String with room for them
+        count,
+    };
+};
+
+u8 RUNTIME_SIGNATURES[runtime::count] = {
+    signature::i32i32_i32,
+    signature::i32i32_i32,
+    signature::i32i32_v,
+    signature::i32i32_v,
+    signature::i32i32i32_i32,
+};
+
+const char* RUNTIME_NAMES[runtime::count] = {
+    "String.alloc",
+    "String.charAt",
+    "String.appendChar",
+    "String.appendString",
+    "StringBuilder.reserve",
+};
+
+//java.lang.Math methods that have no wasm instruction.  They're imported from the host's
+//Math object, which has the same name and semantics for each of them.  Only the ones a
+//program mentions are imported, after the host functions
+const u32 MATH_IMPORT_COUNT = 18;
+constexpr Import MATH_IMPORTS[MATH_IMPORT_COUNT] = {
+    {"Math", "sin", signature::f64_f64},
+    {"Math", "cos", signature::f64_f64},
+    {"Math", "tan", signature::f64_f64},
+    {"Math", "asin", signature::f64_f64},
+    {"Math", "acos", signature::f64_f64},
+    {"Math", "atan", signature::f64_f64},
+    {"Math", "sinh", signature::f64_f64},
+    {"Math", "cosh", signature::f64_f64},
+    {"Math", "tanh", signature::f64_f64},
+    {"Math", "exp", signature::f64_f64},
+    {"Math", "expm1", signature::f64_f64},
+    {"Math", "log", signature::f64_f64},
+    {"Math", "log10", signature::f64_f64},
+    {"Math", "log1p", signature::f64_f64},
+    {"Math", "cbrt", signature::f64_f64},
+    {"Math", "atan2", signature::f64f64_f64},
+    {"Math", "pow", signature::f64f64_f64},
+    {"Math", "hypot", signature::f64f64_f64},
+};
+
+//while code is generated, functions are referred to by ids, since which imports a program
+//uses isn't known until then.  The host imports come first, then the Math imports, the
+//methods, the allocator, the String runtime and the library.  Linking gives the functions main
+//reaches their indices and drops the rest, along with the types only they used
+const u32 FIRST_DEFINED_FUNCTION = host::count + MATH_IMPORT_COUNT;
+const u32 MAX_DEFINED_FUNCTIONS = MAX_METHODS + 1 + runtime::count + library::count;
+const u32 MAX_FUNCTIONS = FIRST_DEFINED_FUNCTION + MAX_DEFINED_FUNCTIONS;
+u32 functionIndices[MAX_FUNCTIONS]; //-1 for functions that were dropped
+u32 functionTypes[MAX_FUNCTIONS];
+u32 importCount = 0;
+u32 functionCount = 0;
+
+//where the code of each defined function was compiled, and the first of its call sites
+u8* functionBodies[MAX_DEFINED_FUNCTIONS + 1];
+u32 functionCallSites[MAX_DEFINED_FUNCTIONS + 1];
+
+//a call site is the offset from codeStart of the function id following a call.  A program
+//with more calls than this fails to compile
+const u32 MAX_CALL_SITES = 0x4000;
+u32 callSiteOffsets[MAX_CALL_SITES];
+u32 callSiteCount = 0;
+
+//the types are deduplicated as they're added to the type section
+u8* typeStarts[MAX_FUNCTIONS];
+u32 typeCount = 0;
+
 IMPORT void puts(char *address, u32 size);
 IMPORT void logs(char *address, u32 size);
-IMPORT void put(char address);
+IMPORT void put(u8 c); //unsigned, so bytes past ASCII reach the host as they are
 IMPORT void putbool(bool value);
 IMPORT void putu32(u32 num);
 IMPORT void puti32(i32 num);
 IMPORT void logi32(i32 num);
+IMPORT f64 now(); //milliseconds
+
+//the phases of a compilation, in the order they run
+struct phase {
+    enum {
+        Prescan,        //lexing the whole source for literals and imports
+        Declarations,   //scanning classes, fields and methods
+        Headers,        //every section before the code section
+        Code,
+        Data,
+        count,
+    };
+};
 
-//a better hashing algorithm would reduce collisions between identifiers
-//TODO
-constexpr u32 getIdentifierHash(char* str, int length) {
-    u32 hash = 0;
+//what the compiler did during the last call to getWasmFromJava.  The host reads it from
+//the address getCompileStats() returns.  Counting costs an add here and there, but timing
+//calls the host, so phases are only timed after enableCompileTimer(true)
+struct CompileStats {
+    f64 phaseMilliseconds[phase::count];
+    u32 tokensLexed;
+    u32 symbolLookups;      //of variables, constants, classes, fields, methods and literals
+    u32 symbolProbes;       //table entries those lookups compared against
+    u32 methodsCompiled;
+    u32 moduleBytes;
+    u32 sectionBytes[wasm::section::Data + 1]; //including each section's id and size
+};
+
+CompileStats stats;
+bool isTimerEnabled = false;
+f64 phaseStartTime = 0.0;
+
+EXPORT CompileStats* getCompileStats() {
+    return &stats;
+}
+
+EXPORT void enableCompileTimer(bool isEnabled) {
+    isTimerEnabled = isEnabled;
+}
+
+void resetCompileStats() {
+    for (u32 i = 0; i < phase::count; ++i) {
+        stats.phaseMilliseconds[i] = 0.0;
+    }
+
+    for (u32 i = 0; i <= wasm::section::Data; ++i) {
+        stats.sectionBytes[i] = 0;
+    }
+
+    stats.tokensLexed = 0;
+    stats.symbolLookups = 0;
+    stats.symbolProbes = 0;
+    stats.methodsCompiled = 0;
+    stats.moduleBytes = 0;
+
+    if (isTimerEnabled) {
+        phaseStartTime = now();
+    }
+}
+
+//the next phase starts where this one ends
+void endPhase(u32 p) {
+    if (isTimerEnabled) {
+        f64 time = now();
+        stats.phaseMilliseconds[p] += time - phaseStartTime;
+        phaseStartTime = time;
+    }
+}
+
+//sectionStart is the section's id byte
+void countSection(u8* sectionStart) {
+    stats.sectionBytes[*sectionStart] += writePos - sectionStart;
+}
+
+//FNV-1a.  Hashing a name from the hash of its qualifier gives the hash of the qualified name
+constexpr u32 getIdentifierHash(const char* str, int length, u32 hash = 0x811C9DC5) {
     for (int i = 0; i < length; ++i) {
-        hash += (hash << 2) + str[i];
+        hash = (hash ^ (u8)str[i]) * 0x01000193;
     }
 
     return hash;
 }
 
+constexpr u32 getNameLength(const char* name) {
+    u32 length = 0;
+    while (name[length]) {
+        ++length;
+    }
+    return length;
+}
+
+//identifiers with a meaning of their own: Java's keywords and literals, the types it has
+//without a declaration, and the library members the compiler supports.  Identifiers are looked
+//up in a perfect hash table built from this list at compile time
+struct keyword {
+    enum kind {
+        None,
+        Reserved,
+        Modifier,
+        TypeDeclaration,
+        Type,
+        Literal,
+        Library,
+        MathImport,
+    };
+};
+
+struct Keyword {
+    const char* name;
+    u8 kind;
+    u8 value; //the type a Type names, or the index of a MathImport in MATH_IMPORTS
+};
+
+constexpr Keyword KEYWORDS[] = {
+    {"abstract", keyword::Modifier},
+    {"assert", keyword::Reserved},
+    {"boolean", keyword::Type, java::type::boolean},
+    {"break", keyword::Reserved},
+    {"byte", keyword::Reserved},
+    {"case", keyword::Reserved},
+    {"catch", keyword::Reserved},
+    {"char", keyword::Type, java::type::_char},
+    {"class", keyword::TypeDeclaration},
+    {"const", keyword::Reserved},
+    {"continue", keyword::Reserved},
+    {"default", keyword::Reserved},
+    {"do", keyword::Reserved},
+    {"double", keyword::Type, wasm::type::f64},
+    {"else", keyword::Reserved},
+    {"enum", keyword::TypeDeclaration},
+    {"extends", keyword::Reserved},
+    {"final", keyword::Modifier},
+    {"finally", keyword::Reserved},
+    {"float", keyword::Type, wasm::type::f32},
+    {"for", keyword::Reserved},
+    {"goto", keyword::Reserved},
+    {"if", keyword::Reserved},
+    {"implements", keyword::Reserved},
+    {"import", keyword::Reserved},
+    {"instanceof", keyword::Reserved},
+    {"int", keyword::Type, wasm::type::i32},
+    {"interface", keyword::TypeDeclaration},
+    {"long", keyword::Type, wasm::type::i64},
+    {"native", keyword::Modifier},
+    {"new", keyword::Reserved},
+    {"package", keyword::Reserved},
+    {"private", keyword::Modifier},
+    {"protected", keyword::Modifier},
+    {"public", keyword::Modifier},
+    {"return", keyword::Reserved},
+    {"short", keyword::Reserved},
+    {"static", keyword::Modifier},
+    {"strictfp", keyword::Modifier},
+    {"super", keyword::Reserved},
+    {"switch", keyword::Reserved},
+    {"synchronized", keyword::Modifier},
+    {"this", keyword::Reserved},
+    {"throw", keyword::Reserved},
+    {"throws", keyword::Reserved},
+    {"transient", keyword::Modifier},
+    {"try", keyword::Reserved},
+    {"void", keyword::Reserved},
+    {"volatile", keyword::Modifier},
+    {"while", keyword::Reserved},
+
+    {"true", keyword::Literal},
+    {"false", keyword::Literal},
+    {"null", keyword::Literal},
+
+    {"String", keyword::Type, java::type::String},
+    {"StringBuilder", keyword::Type, java::type::StringBuilder},
+    {"Scanner", keyword::Library},
+    {"keyboard.nextFloat", keyword::Library},
+    {"System.out.print", keyword::Library},
+    {"System.out.println", keyword::Library},
+    {"System.nanoTime", keyword::Library},
+    {"System.currentTimeMillis", keyword::Library},
+    {"String.valueOf", keyword::Library},
+    {"String.length", keyword::Library},
+    {"String.charAt", keyword::Library},
+    {"String.equals", keyword::Library},
+    {"String.hashCode", keyword::Library},
+    {"String.isEmpty", keyword::Library},
+    {"StringBuilder.append", keyword::Library},
+    {"StringBuilder.toString", keyword::Library},
+    {"StringBuilder.length", keyword::Library},
+    {"StringBuilder.charAt", keyword::Library},
+    {"Math.PI", keyword::Library},
+    {"Math.E", keyword::Library},
+    {"Math.abs", keyword::Library},
+    {"Math.min", keyword::Library},
+    {"Math.max", keyword::Library},
+    {"Math.sqrt", keyword::Library},
+    {"Math.floor", keyword::Library},
+    {"Math.ceil", keyword::Library},
+    {"Math.rint", keyword::Library},
+    {"Math.signum", keyword::Library},
+    {"Math.copySign", keyword::Library},
+    {"Math.sin", keyword::MathImport, 0},
+    {"Math.cos", keyword::MathImport, 1},
+    {"Math.tan", keyword::MathImport, 2},
+    {"Math.asin", keyword::MathImport, 3},
+    {"Math.acos", keyword::MathImport, 4},
+    {"Math.atan", keyword::MathImport, 5},
+    {"Math.sinh", keyword::MathImport, 6},
+    {"Math.cosh", keyword::MathImport, 7},
+    {"Math.tanh", keyword::MathImport, 8},
+    {"Math.exp", keyword::MathImport, 9},
+    {"Math.expm1", keyword::MathImport, 10},
+    {"Math.log", keyword::MathImport, 11},
+    {"Math.log10", keyword::MathImport, 12},
+    {"Math.log1p", keyword::MathImport, 13},
+    {"Math.cbrt", keyword::MathImport, 14},
+    {"Math.atan2", keyword::MathImport, 15},
+    {"Math.pow", keyword::MathImport, 16},
+    {"Math.hypot", keyword::MathImport, 17},
+};
+
+const u32 KEYWORD_COUNT = sizeof(KEYWORDS) / sizeof(KEYWORDS[0]);
+const u32 KEYWORD_SLOT_BITS = 11;
+const u32 KEYWORD_SLOT_COUNT = 1 << KEYWORD_SLOT_BITS;
+static_assert(KEYWORD_COUNT < 256, "keyword slots hold a u8");
+
+struct KeywordTable {
+    u32 hashes[KEYWORD_COUNT];
+    u32 multiplier;
+    u8 slots[KEYWORD_SLOT_COUNT]; //1 + the index of the keyword in each slot, or 0
+};
+
+constexpr u32 getKeywordSlot(u32 hash, u32 multiplier) {
+    return (hash * multiplier) >> (32 - KEYWORD_SLOT_BITS);
+}
+
+//multipliers are tried from the golden ratio up, until one gives every keyword a slot of its
+//own.  Keywords with the same hash would never get one, so the build would fail
+constexpr KeywordTable buildKeywordTable() {
+    KeywordTable table = {};
+    for (u32 i = 0; i < KEYWORD_COUNT; ++i) {
+        table.hashes[i] = getIdentifierHash(KEYWORDS[i].name, getNameLength(KEYWORDS[i].name));
+    }
+
+    for (table.multiplier = 0x9E3779B1; ; table.multiplier += 2) {
+        for (u32 slot = 0; slot < KEYWORD_SLOT_COUNT; ++slot) {
+            table.slots[slot] = 0;
+        }
+
+        u32 i = 0;
+        while (i < KEYWORD_COUNT && !table.slots[getKeywordSlot(table.hashes[i], table.multiplier)]) {
+            table.slots[getKeywordSlot(table.hashes[i], table.multiplier)] = i + 1;
+            ++i;
+        }
+
+        if (i == KEYWORD_COUNT) {
+            return table;
+        }
+    }
+}
+
+constexpr KeywordTable KEYWORD_TABLE = buildKeywordTable();
+
+//the keyword with the given hash, or -1
+u32 findKeyword(u32 hash) {
+    u32 index = KEYWORD_TABLE.slots[getKeywordSlot(hash, KEYWORD_TABLE.multiplier)] - 1;
+    return index != -1 && KEYWORD_TABLE.hashes[index] == hash ? index : -1;
+}
+
+constexpr bool isSameName(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        ++a;
+        ++b;
+    }
+    return *a == *b;
+}
+
+//the Math imports must be the MathImport keywords, so that a keyword's value is its import
+constexpr bool areMathImportsKeywords() {
+    u32 mathImportCount = 0;
+    for (const Keyword& k : KEYWORDS) {
+        if (k.kind == keyword::MathImport) {
+            if (k.value >= MATH_IMPORT_COUNT || !isSameName(k.name + 5, MATH_IMPORTS[k.value].name)) {
+                return false;
+            }
+            ++mathImportCount;
+        }
+    }
+    return mathImportCount == MATH_IMPORT_COUNT;
+}
+
+static_assert(areMathImportsKeywords(), "each Math import needs a MathImport keyword");
+
+//the index in MATH_IMPORTS of the Math method called, or -1
+u32 findMathImport(u32 hash) {
+    u32 index = findKeyword(hash);
+    return index != -1 && KEYWORDS[index].kind == keyword::MathImport ? KEYWORDS[index].value : -1;
+}
+
 u8* insertF32(u8* writePos, f32 val) {
     memcpy(writePos, &val, 4);
     return writePos + 4;
 }
 
-constexpr bool isalpha(char c) {
-    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+u8* insertF64(u8* writePos, f64 val) {
+    memcpy(writePos, &val, 8);
+    return writePos + 8;
+}
+
+u8* insertVaruint(u8* writePos, u32 val) {
+    do {
+        u8 byte = val & 0x7F;
+        val >>= 7;
+
+        if (val != 0) {
+            byte |= 0x80; //more bytes to come
+        }
+
+        *writePos++ = byte;
+    } while (val != 0);
+
+    return writePos;
+}
+
+u32 getVaruintLength(u32 val) {
+    u32 length = 1;
+    while (val >>= 7) {
+        ++length;
+    }
+    return length;
+}
+
+u8* insertVarint(u8* writePos, i64 val) {
+    while (true) {
+        u8 byte = val & 0x7F;
+        val >>= 7;
+
+        //sign bit of byte is second high order bit (0x40)
+        if ((val == 0 && (byte & 0x40) == 0) || (val == -1 && (byte & 0x40) != 0)) {
+            *writePos++ = byte;
+            return writePos;
+        }
+
+        *writePos++ = byte | 0x80;
+    }
+}
+
+u8* insertName(u8* writePos, const char* name) {
+    u32 length = 0;
+    while (name[length]) {
+        ++length;
+    }
+
+    *writePos++ = length;
+    for (u32 i = 0; i < length; ++i) {
+        *writePos++ = name[i];
+    }
+
+    return writePos;
+}
+
+//insert a name made of a prefix followed by a number, e.g. static12
+u8* insertNumberedName(u8* writePos, const char* prefix, u32 number) {
+    char digits[10];
+    u32 digitCount = 0;
+    do {
+        digits[digitCount++] = '0' + number % 10;
+        number /= 10;
+    } while (number > 0);
+
+    u8* lengthPos = writePos++;
+    for (u32 i = 0; prefix[i]; ++i) {
+        *writePos++ = prefix[i];
+    }
+    while (digitCount > 0) {
+        *writePos++ = digits[--digitCount];
+    }
+
+    *lengthPos = writePos - lengthPos - 1;
+    return writePos;
+}
+
+//function ids and counts are reserved as two byte varuints and patched once they're known
+void patchVaruint(u8* pos, u32 value) {
+    pos[0] = (value & 0x7F) | 0x80;
+    pos[1] = value >> 7;
+}
+
+constexpr bool isalpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+constexpr bool isdigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+constexpr bool isValidLeadingIDChar(char c) {
+    return isalpha(c) || c == '_' || c == '$';
+}
+
+constexpr bool isValidNonLeadingIDChar(char c) {
+    return isValidLeadingIDChar(c) || isdigit(c);
+}
+
+u32 getIdentifierLength(const char* c) {
+    u32 length = 0;
+    while (isValidNonLeadingIDChar(c[length]) || c[length] == '<' || c[length] == '>') {
+        ++length;
+    }
+    return length;
+}
+
+//insert a name made of a qualifier and an identifier joined by '.'.  Either may be 0
+u8* insertQualifiedName(u8* writePos, const char* qualifier, const char* name) {
+    u32 qualifierLength = qualifier ? getIdentifierLength(qualifier) : 0;
+    u32 nameLength = name ? getIdentifierLength(name) : 0;
+    bool hasDot = qualifierLength && nameLength;
+
+    writePos = insertVaruint(writePos, qualifierLength + hasDot + nameLength);
+    for (u32 i = 0; i < qualifierLength; ++i) {
+        *writePos++ = qualifier[i];
+    }
+    if (hasDot) {
+        *writePos++ = '.';
+    }
+    for (u32 i = 0; i < nameLength; ++i) {
+        *writePos++ = name[i];
+    }
+
+    return writePos;
+}
+
+//the line of the source that pos is on, counting from 1.  Moving forward through the source
+//only counts the newlines since the last lookup
+char* lineCachePos = 0;
+u32 lineCacheLine = 1;
+
+u32 findLine(char* pos) {
+    if (!lineCachePos || pos < lineCachePos) {
+        lineCachePos = sourceStart;
+        lineCacheLine = 1;
+    }
+
+    for (; lineCachePos < pos; ++lineCachePos) {
+        lineCacheLine += *lineCachePos == '\n';
+    }
+
+    return lineCacheLine;
+}
+
+//map the code about to be written to the line of sourcePos in the line table
+void addLineEntry(char* sourcePos) {
+    if (!emitsLineTable && !emitsSizeReport) {
+        return;
+    }
+
+    //entries for code that was overwritten since are dropped
+    u32 offset = writePos - codeStart;
+    while (lineEntryCount > 0 && lineEntryOffsets[lineEntryCount - 1] >= offset) {
+        --lineEntryCount;
+    }
+
+    u32 line = findLine(sourcePos);
+    if ((lineEntryCount > 0 && lineEntryLines[lineEntryCount - 1] == line) || lineEntryCount == MAX_LINE_ENTRIES) {
+        return;
+    }
+
+    lineEntryOffsets[lineEntryCount] = offset;
+    lineEntryLines[lineEntryCount] = line;
+    ++lineEntryCount;
+}
+
+u64 parseInteger(char* c, char* end);
+struct FloatFormat;
+extern const FloatFormat DOUBLE_FORMAT;
+extern const FloatFormat FLOAT_FORMAT;
+u64 parseDecimalFloat(char* c, char* end, const FloatFormat& f);
+u64 parseHexFloat(char* c, char* end, const FloatFormat& f);
+
+
+struct token {
+    enum kind {
+        End,
+        Identifier,
+        NumericLiteral,
+        StringLiteral,
+        CharLiteral,
+        Symbol,
+    };
+};
+
+struct Token {
+    char* start;
+    u32 length;
+    u32 hash;
+    u8 kind;
+    u8 keyword; //the kind of keyword an identifier is, or keyword::None
+};
+
+//the token most recently read by nextToken().  readPos is left one past its end
+Token tok;
+
+//operators made of more than one character, longest first so the first match is the longest
+const char* MULTI_CHAR_SYMBOLS[] = {
+    ">>>=", ">>>", "<<=", ">>=",
+    "<<", ">>", "<=", ">=", "==", "!=", "&&", "||", "++", "--",
+    "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", "->", "::",
+};
+
+//one probe of the keyword table, and one compare with the keyword found.  An identifier with a
+//keyword's hash that isn't the keyword gets another hash, so that comparing hashes with HASH()
+//can't mistake it for the keyword
+void classifyIdentifier() {
+    u32 index = findKeyword(tok.hash);
+    if (index == -1) {
+        return;
+    }
+
+    const char* name = KEYWORDS[index].name;
+    u32 i = 0;
+    while (i < tok.length && name[i] == tok.start[i]) {
+        ++i;
+    }
+
+    if (i == tok.length && name[i] == '\0') {
+        tok.keyword = KEYWORDS[index].kind;
+    } else {
+        tok.hash = ~tok.hash;
+    }
+}
+
+bool isSymbol(char c) {
+    return tok.kind == token::Symbol && tok.length == 1 && *tok.start == c;
+}
+
+void nextToken() {
+    //skip white space and comments
+    while (readPos < endReadPos) {
+        if (*readPos == ' ' || *readPos == '\n' || *readPos == '\t' || *readPos == '\r') {
+            ++readPos;
+        } else if (readPos[0] == '/' && readPos[1] == '/') {
+            while (readPos < endReadPos && *readPos != '\n') {
+                ++readPos;
+            }
+        } else if (readPos[0] == '/' && readPos[1] == '*') {
+            readPos += 2;
+            while (readPos < endReadPos && (readPos[0] != '*' || readPos[1] != '/')) {
+                ++readPos;
+            }
+            readPos += 2;
+        } else {
+            break;
+        }
+    }
+
+    tok.start = readPos;
+
+    if (readPos >= endReadPos) {
+        readPos = endReadPos;
+        tok.start = readPos;
+        tok.kind = token::End;
+    } else if (isValidLeadingIDChar(*readPos)) {
+        //qualified names like System.out.println are kept together as one identifier
+        do {
+            ++readPos;
+        } while (readPos < endReadPos && (isValidNonLeadingIDChar(*readPos) || (*readPos == '.' && isValidLeadingIDChar(readPos[1]))));
+
+        tok.kind = token::Identifier;
+    } else if (isdigit(*readPos) || (*readPos == '.' && isdigit(readPos[1]))) {
+        bool isHex = readPos[0] == '0' && (readPos[1] == 'x' || readPos[1] == 'X');
+        char exponent = isHex ? 'p' : 'e';
+
+        do {
+            //the exponent of a literal like 1e-5 may be signed
+            if ((*readPos == '+' || *readPos == '-') && (readPos[-1] | 0x20) != exponent) {
+                break;
+            }
+            ++readPos;
+        } while (readPos < endReadPos && (isValidNonLeadingIDChar(*readPos) || *readPos == '.' || *readPos == '+' || *readPos == '-'));
+
+        tok.kind = token::NumericLiteral;
+    } else if (*readPos == '"' || *readPos == '\'') {
+        char quote = *readPos++;
+        while (readPos < endReadPos && *readPos != quote) {
+            if (*readPos == '\\') {
+                ++readPos;
+            }
+            ++readPos;
+        }
+        ++readPos;
+
+        tok.kind = quote == '"' ? token::StringLiteral : token::CharLiteral;
+    } else {
+        tok.kind = token::Symbol;
+        ++readPos;
+
+        for (const char* symbol : MULTI_CHAR_SYMBOLS) {
+            u32 i = 0;
+            while (symbol[i] && tok.start + i < endReadPos && tok.start[i] == symbol[i]) {
+                ++i;
+            }
+
+            if (symbol[i] == '\0') {
+                readPos = tok.start + i;
+                break;
+            }
+        }
+    }
+
+    if (readPos > endReadPos) {
+        readPos = endReadPos;
+    }
+
+    tok.length = readPos - tok.start;
+    tok.hash = getIdentifierHash(tok.start, tok.length);
+    tok.keyword = keyword::None;
+    if (tok.kind == token::Identifier) {
+        classifyIdentifier();
+    }
+    ++stats.tokensLexed;
+}
+
+//rewind the lexer so that tok is the token starting at p
+void rewindTo(char* p) {
+    readPos = p;
+    nextToken();
+}
+
+//skip past the next occurrence of the given symbol
+void skipPast(char c) {
+    while (tok.kind != token::End && !isSymbol(c)) {
+        nextToken();
+    }
+    nextToken();
+}
+
+char getEscapedChar(char c) {
+    switch (c) {
+        case 'n':
+            return '\n';
+        case 't':
+            return '\t';
+        case 'r':
+            return '\r';
+        case '0':
+            return '\0';
+        default:
+            return c; //covers \\ \' and \"
+    }
+}
+
+//decode a string or char literal (excluding quotes) into UTF-16 code units at dest, two
+//little endian bytes each.  Returns the number of code units.  A null dest only counts them
+u32 decodeStringLiteral(char* str, u32 length, u8* dest) {
+    u32 decodedLength = 0;
+
+    for (u32 i = 0; i < length; ) {
+        u32 c = (u8)str[i++];
+
+        if (c == '\\' && i < length) {
+            c = str[i++];
+
+            if (c == 'u') {
+                while (i < length && str[i] == 'u') {
+                    ++i;
+                }
+
+                c = 0;
+                for (u32 digits = 0; digits < 4 && i < length; ++digits) {
+                    char h = str[i++];
+                    c = c * 16 + (isdigit(h) ? h - '0' : (h | 0x20) - 'a' + 10);
+                }
+            } else {
+                c = getEscapedChar(c);
+            }
+        } else if (c >= 0x80) {
+            //the source is UTF-8
+            u32 extraBytes = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : 1;
+            c &= 0x3F >> extraBytes;
+            for (u32 j = 0; j < extraBytes && i < length; ++j) {
+                c = (c << 6) | (str[i++] & 0x3F);
+            }
+        }
+
+        //characters beyond the basic multilingual plane take a surrogate pair
+        if (c >= 0x10000) {
+            c -= 0x10000;
+            if (dest) {
+                dest[2 * decodedLength] = (0xD800 + (c >> 10)) & 0xFF;
+                dest[2 * decodedLength + 1] = (0xD800 + (c >> 10)) >> 8;
+            }
+            ++decodedLength;
+            c = 0xDC00 + (c & 0x3FF);
+        }
+
+        if (dest) {
+            dest[2 * decodedLength] = c & 0xFF;
+            dest[2 * decodedLength + 1] = c >> 8;
+        }
+        ++decodedLength;
+    }
+
+    return decodedLength;
+}
+
+u8 getWasmTypeFromCppName(u32 hash) {
+    //for the purposes of this hackathon, assume no unsigned types and well formed programs
+    u32 index = findKeyword(hash);
+    return index != -1 && KEYWORDS[index].kind == keyword::Type ? KEYWORDS[index].value : wasm::type::_void;
+}
+
+u32 findClass(u32 hash) {
+    ++stats.symbolLookups;
+    for (u32 i = 0; i < classCount; ++i) {
+        if (classes[i].hash == hash) {
+            stats.symbolProbes += i + 1;
+            return i;
+        }
+    }
+
+    stats.symbolProbes += classCount;
+    return -1;
+}
+
+//the type named by a primitive type or a class name
+u8 getTypeFromName(u32 hash) {
+    u32 classIndex = findClass(hash);
+    if (classIndex != -1) {
+        return java::type::firstClass + classIndex;
+    }
+
+    return getWasmTypeFromCppName(hash);
+}
+
+//the wasm representation of a wasm or Java type
+u8 getWasmType(u8 type) {
+    switch (type) {
+        case java::type::boolean:
+        case java::type::_char:
+        case java::type::String:
+        case java::type::null:
+        case java::type::StringBuilder:
+            return wasm::type::i32;
+        default:
+            //objects are referred to by their address
+            return type >= java::type::firstClass ? (u8)wasm::type::i32 : type;
+    }
+}
+
+//bytes a field of the given type occupies in an object
+u32 getTypeSize(u8 type) {
+    switch (getWasmType(type)) {
+        case wasm::type::i64:
+        case wasm::type::f64:
+            return 8;
+        default:
+            return type == java::type::boolean ? 1 : type == java::type::_char ? 2 : 4;
+    }
+}
+
+bool isNumericType(u8 type) {
+    return type == java::type::_char || (type >= wasm::type::f64 && type <= wasm::type::i32);
+}
+
+//binary numeric promotion.  The wasm type codes decrease from i32 to f64, so the wider
+//of two numeric types is the one with the lower code
+u8 promote(u8 a, u8 b) {
+    a = getWasmType(a);
+    b = getWasmType(b);
+    return a < b ? a : b;
+}
+
+
+//the first error in the source.  The compile stops there: the source is cut off at the error,
+//so the parser runs out of tokens, and getWasmFromJava returns an empty module.  The host reads
+//the error with getCompileError
+struct CompileError {
+    const char* message; //0 when the source compiled
+    u32 length;
+    u32 line;
+};
+
+CompileError compileError;
+
+EXPORT CompileError* getCompileError() {
+    return &compileError;
+}
+
+//record the first error, and stop compiling at the token it's found at.  It's kept out of
+//line, since it's called from everywhere a size or a limit is checked
+__attribute__((noinline)) void reportError(const char* message, u32 length) {
+    if (compileError.message) {
+        return;
+    }
+
+    compileError.message = message;
+    compileError.length = length;
+    compileError.line = findLine(tok.start);
+    endReadPos = readPos = tok.start;
+    tok.kind = token::End;
+}
+
+#define REPORT_ERROR(lit) reportError(lit, sizeof(lit) - 1)
+
+//the message of an error about a name, such as cannot find symbol y.  Long names are cut off
+char nameErrorText[96];
+
+//off while static field initializers are parsed for their constant values, since the methods
+//and fields declared after them haven't been scanned yet
+bool reportsUnknownNames = true;
+
+void reportNameError(const char* message, u32 length, const char* name, u32 nameLength) {
+    if (!reportsUnknownNames) {
+        return;
+    }
+
+    u32 nameRoom = sizeof(nameErrorText) - length - 1;
+    nameLength = nameLength < nameRoom ? nameLength : nameRoom;
+    memcpy(nameErrorText, message, length);
+    nameErrorText[length] = ' ';
+    memcpy(nameErrorText + length + 1, name, nameLength);
+    reportError(nameErrorText, length + 1 + nameLength);
+}
+
+#define REPORT_NAME_ERROR(lit, name, nameLength) reportNameError(lit, sizeof(lit) - 1, name, nameLength)
+
+//section and function sizes are reserved as three byte varuints and patched once they're
+//known.  A compiled function's size is padded to all three, since call sites and line entries
+//in it are kept by their offsets.  A method that doesn't fit fails to compile
+const u32 SIZE_LENGTH = 3;
+const u32 MAX_SIZE = 1 << 21;
+
+void patchSize(u8* sizePos) {
+    u32 size = writePos - sizePos - SIZE_LENGTH;
+    if (size >= MAX_SIZE) {
+        REPORT_ERROR("method too large");
+    }
+
+    sizePos[0] = (size & 0x7F) | 0x80;
+    sizePos[1] = (size >> 7 & 0x7F) | 0x80;
+    sizePos[2] = size >> 14 & 0x7F;
+}
+
+u32 readSize(u8* sizePos) {
+    return (sizePos[0] & 0x7F) | (sizePos[1] & 0x7F) << 7 | sizePos[2] << 14;
+}
+
+//nothing refers to the bytes of a section by their position, so it's moved down over the
+//bytes its size doesn't need
+void patchSectionSize(u8* sizePos) {
+    u32 size = writePos - sizePos - SIZE_LENGTH;
+    u32 sizeLength = getVaruintLength(size);
+    if (sizeLength > SIZE_LENGTH) {
+        REPORT_ERROR("module too large");
+        return;
+    }
+
+    memmove(sizePos + sizeLength, sizePos + SIZE_LENGTH, size);
+    insertVaruint(sizePos, size);
+    writePos -= SIZE_LENGTH - sizeLength;
+}
+
+//a new local after every variable so far.  A method with more than MAX_VARS fails to compile,
+//and its last local is reused so that nothing is written past the end
+u32 addLocal(u32 hash, u8 type) {
+    u32 varIndex = totalVarCount;
+    if (varIndex == MAX_VARS) {
+        REPORT_ERROR("too many variables");
+        varIndex = MAX_VARS - 1;
+    } else {
+        ++totalVarCount;
+    }
+
+    varHashes[varIndex] = hash;
+    varTypes[varIndex] = type;
+    return varIndex;
+}
+
+//locals the compiler uses to hold intermediate values.  They are placed after the user's
+//locals and have a hash of 0, so they never shadow a variable
+u32 acquireScratchLocal(u8 type) {
+    type = getWasmType(type);
+
+    for (u32 i = globalVarCount; i < totalVarCount; ++i) {
+        if (varHashes[i] == 0 && varTypes[i] == type && !varIsBusy[i]) {
+            varIsBusy[i] = true;
+            return i - globalVarCount;
+        }
+    }
+
+    u32 varIndex = addLocal(0, type);
+    varIsBusy[varIndex] = true;
+    return varIndex - globalVarCount;
+}
+
+void releaseScratchLocals() {
+    for (u32 i = globalVarCount; i < totalVarCount; ++i) {
+        varIsBusy[i] = false;
+    }
+}
+
+
+struct expr {
+    enum kind {
+        Error,
+        Literal,
+        StringLiteral,
+        Variable,
+        Unary,
+        Binary,
+        Cast,
+        Call,
+        FieldAccess,
+        MethodCall,
+        New,
+    };
+};
+
+//expressions are parsed into a tree one statement at a time, so that the type of every
+//operand is known before any code is generated for it
+struct Expr {
+    u32 op;         //hash of the operator token, or of the name of the called method.  "super"
+                    //for calls of a superclass's method, which aren't virtual.  The
+                    //constructor's method index for new, or -1 if the class has none
+    u16 lhs;        //first operand, first argument of a call, or the object of a field access
+    u16 rhs;        //second operand
+    u16 next;       //next argument of a call
+    u8 kind;
+    u8 type;
+    u8 operandType; //type both operands are converted to before a binary operator is applied
+    u32 length;     //characters in a string literal
+    union {
+        i64 intValue;
+        f32 f32Value;
+        f64 f64Value;
+        u32 varIndex;
+        u32 dataOffset;
+        u32 fieldIndex;
+        u32 methodIndex;
+    };
+};
+
+//expression 0 is an error expression, which doubles as "no expression"
+const u32 MAX_EXPRS = 512;
+Expr exprs[MAX_EXPRS];
+u32 exprCount = 1;
+
+u16 newExpr(u8 kind, u8 type) {
+    if (exprCount == MAX_EXPRS) {
+        REPORT_ERROR("expression too large");
+        return 0;
+    }
+
+    Expr& e = exprs[exprCount];
+    e.kind = kind;
+    e.type = type;
+    e.op = 0;
+    e.lhs = e.rhs = e.next = 0;
+    e.intValue = 0;
+    return exprCount++;
+}
+
+//values of the static final constants.  Their hashes are in constantHashes
+Expr constantValues[MAX_CONSTANTS];
+
+u16 parseExpression();
+
+bool isNaN(f64 value) {
+    //test the bits, since -Ofast lets the compiler assume value != value is always false
+    u64 bits;
+    memcpy(&bits, &value, 8);
+    return (bits & 0x7FFFFFFFFFFFFFFF) > 0x7FF0000000000000;
+}
+
+//convert a literal to another type at compile time, exactly as Java would at runtime
+void foldConversion(Expr& e, u8 type) {
+    u8 from = getWasmType(e.type);
+    u8 to = getWasmType(type);
+
+    if (from == wasm::type::f32 || from == wasm::type::f64) {
+        f64 value = from == wasm::type::f32 ? e.f32Value : e.f64Value;
+
+        if (to == wasm::type::i32 || to == wasm::type::i64) {
+            i64 min = to == wasm::type::i32 ? -0x80000000LL : (i64)0x8000000000000000;
+            i64 max = to == wasm::type::i32 ? 0x7FFFFFFFLL : 0x7FFFFFFFFFFFFFFF;
+
+            if (isNaN(value)) {
+                e.intValue = 0;
+            } else if (value <= (f64)min) {
+                e.intValue = min;
+            } else if (value >= (f64)max) {
+                e.intValue = max;
+            } else {
+                e.intValue = (i64)value;
+            }
+        } else if (to == wasm::type::f32) {
+            e.f32Value = value;
+        } else {
+            e.f64Value = value;
+        }
+    } else {
+        i64 value = from == wasm::type::i32 ? (i32)e.intValue : e.intValue;
+
+        if (to == wasm::type::f32) {
+            e.f32Value = value;
+        } else if (to == wasm::type::f64) {
+            e.f64Value = value;
+        } else if (to == wasm::type::i32) {
+            e.intValue = (i32)value;
+        } else {
+            e.intValue = value;
+        }
+    }
+
+    if (type == java::type::_char && e.type != java::type::_char) {
+        e.intValue &= 0xFFFF;
+    }
+
+    e.type = type;
+}
+
+//evaluate a binary operator on two literals of the same type at compile time.
+//Returns false when the result is only known at runtime, e.g. division by zero
+bool foldBinary(u32 op, Expr& a, Expr& b, Expr& result) {
+    u8 type = getWasmType(a.type);
+    result.kind = expr::Literal;
+
+    if (type == wasm::type::i32 || type == wasm::type::i64) {
+        //calculate in unsigned arithmetic so that overflow wraps like it does in Java
+        bool is32 = type == wasm::type::i32;
+        u64 x = a.intValue;
+        u64 y = b.intValue;
+        i64 sx = is32 ? (i64)(i32)x : (i64)x;
+        i64 sy = is32 ? (i64)(i32)y : (i64)y;
+        u32 shift = y & (is32 ? 31 : 63);
+        u64 value;
+
+        switch (op) {
+            case HASH("+"): value = x + y; break;
+            case HASH("-"): value = x - y; break;
+            case HASH("*"): value = x * y; break;
+            case HASH("&"): value = x & y; break;
+            case HASH("|"): value = x | y; break;
+            case HASH("^"): value = x ^ y; break;
+            case HASH("<<"): value = x << shift; break;
+            case HASH(">>"): value = sx >> shift; break;
+            case HASH(">>>"): value = (is32 ? (u32)x : x) >> shift; break;
+            case HASH("/"):
+            case HASH("%"):
+                if (sy == 0) {
+                    return false;
+                }
+
+                //MIN_VALUE / -1 overflows back to MIN_VALUE
+                if (sy == -1) {
+                    value = op == HASH("/") ? 0 - x : 0;
+                } else {
+                    value = op == HASH("/") ? sx / sy : sx % sy;
+                }
+                break;
+            default:
+                switch (op) {
+                    case HASH("=="): value = sx == sy; break;
+                    case HASH("!="): value = sx != sy; break;
+                    case HASH("<"): value = sx < sy; break;
+                    case HASH(">"): value = sx > sy; break;
+                    case HASH("<="): value = sx <= sy; break;
+                    case HASH(">="): value = sx >= sy; break;
+                    case HASH("&&"): value = x && y; break;
+                    case HASH("||"): value = x || y; break;
+                    default: return false;
+                }
+
+                result.intValue = value;
+                return true;
+        }
+
+        result.intValue = is32 ? (i64)(i32)value : (i64)value;
+        return true;
+    }
+
+    if (type == wasm::type::f32 || type == wasm::type::f64) {
+        bool is32 = type == wasm::type::f32;
+        f64 x = is32 ? a.f32Value : a.f64Value;
+        f64 y = is32 ? b.f32Value : b.f64Value;
+
+        //each operation is rounded to the precision Java would round it to
+        if (is32) {
+            f32 fx = a.f32Value;
+            f32 fy = b.f32Value;
+
+            switch (op) {
+                case HASH("+"): result.f32Value = fx + fy; return true;
+                case HASH("-"): result.f32Value = fx - fy; return true;
+                case HASH("*"): result.f32Value = fx * fy; return true;
+                case HASH("/"): result.f32Value = fx / fy; return true;
+            }
+        } else {
+            switch (op) {
+                case HASH("+"): result.f64Value = x + y; return true;
+                case HASH("-"): result.f64Value = x - y; return true;
+                case HASH("*"): result.f64Value = x * y; return true;
+                case HASH("/"): result.f64Value = x / y; return true;
+            }
+        }
+
+        //comparisons with NaN are left to the runtime
+        if (isNaN(x) || isNaN(y)) {
+            return false;
+        }
+
+        switch (op) {
+            case HASH("=="): result.intValue = x == y; return true;
+            case HASH("!="): result.intValue = x != y; return true;
+            case HASH("<"): result.intValue = x < y; return true;
+            case HASH(">"): result.intValue = x > y; return true;
+            case HASH("<="): result.intValue = x <= y; return true;
+            case HASH(">="): result.intValue = x >= y; return true;
+        }
+    }
+
+    return false;
+}
+
+//static members are named by their class, e.g. Main.count, no matter how the code names them
+u32 getMemberHash(u32 classIndex, char* name, u32 length) {
+    return getIdentifierHash(name, length, getIdentifierHash((char*)".", 1, classes[classIndex].hash));
+}
+
+//fields the class doesn't declare are looked for in its superclasses
+u32 findField(u32 classIndex, u32 hash) {
+    ++stats.symbolLookups;
+    for (; classIndex != -1; classIndex = classes[classIndex].superclass) {
+        Class& c = classes[classIndex];
+        for (u32 i = c.firstField; i < c.firstField + c.fieldCount; ++i) {
+            if (fields[i].hash == hash) {
+                stats.symbolProbes += i - c.firstField + 1;
+                return i;
+            }
+        }
+
+        stats.symbolProbes += c.fieldCount;
+    }
+
+    return -1;
+}
+
+//methods are only overloaded by their number of parameters.  Those the class doesn't declare
+//are inherited from its superclasses, except for constructors
+u32 findMethod(u32 classIndex, u32 hash, u32 argCount) {
+    ++stats.symbolLookups;
+    while (classIndex != -1) {
+        for (u32 i = 0; i < methodCount; ++i) {
+            Method& m = methods[i];
+            if (m.classIndex == classIndex && m.hash == hash && m.paramCount == argCount) {
+                stats.symbolProbes += i + 1;
+                return i;
+            }
+        }
+
+        stats.symbolProbes += methodCount;
+        classIndex = hash == HASH("<init>") ? -1 : classes[classIndex].superclass;
+    }
+
+    return -1;
+}
+
+bool isSubclass(u32 classIndex, u32 superclass) {
+    while (classIndex != -1 && classIndex != superclass) {
+        classIndex = classes[classIndex].superclass;
+    }
+
+    return classIndex == superclass;
+}
+
+//the methods a call of an instance method may run on an object of classIndex, or of any of its
+//subclasses that have instances.  Only the first MAX_CALL_TARGETS of them are found
+const u32 MAX_CALL_TARGETS = 3;
+
+u32 findCallTargets(u32 classIndex, u32 methodIndex, u32* targets) {
+    Method& m = methods[methodIndex];
+    u32 count = 0;
+
+    for (u32 i = 0; i < classCount && count < MAX_CALL_TARGETS; ++i) {
+        if (!classes[i].isInstantiated || !isSubclass(i, classIndex)) {
+            continue;
+        }
+
+        u32 target = findMethod(i, m.hash, m.paramCount);
+        u32 t = 0;
+        while (t < count && targets[t] != target) {
+            ++t;
+        }
+
+        if (t == count) {
+            targets[count++] = target;
+        }
+    }
+
+    return count;
+}
+
+//the method a call of an instance method on an object of classIndex runs, if only one can be
+//run.  Otherwise -1
+u32 findDirectTarget(u32 classIndex, u32 methodIndex) {
+    u32 targets[MAX_CALL_TARGETS];
+    u32 count = findCallTargets(classIndex, methodIndex, targets);
+    return count == 0 ? methodIndex : count == 1 ? targets[0] : -1;
+}
+
+u32 findConstant(u32 hash) {
+    ++stats.symbolLookups;
+    for (u32 i = 0; i < constantCount; ++i) {
+        if (constantHashes[i] == hash) {
+            stats.symbolProbes += i + 1;
+            return i;
+        }
+    }
+
+    stats.symbolProbes += constantCount;
+    return -1;
+}
+
+u32 findStringLiteral(char* sourcePos) {
+    ++stats.symbolLookups;
+    for (u32 i = 0; i < stringLiteralCount; ++i) {
+        if (stringLiteralSourcePos[i] == sourcePos) {
+            stats.symbolProbes += i + 1;
+            return i;
+        }
+    }
+
+    stats.symbolProbes += stringLiteralCount;
+    return -1;
+}
+
+u32 loadU32(u8* address) {
+    u32 value;
+    memcpy(&value, address, 4);
+    return value;
+}
+
+void storeU32(u8* address, u32 value) {
+    memcpy(address, &value, 4);
+}
+
+u32 findVar(u32 hash) {
+    //the innermost declaration of a name is the one declared last
+    u32 found = -1;
+    for (u32 i = 0; i < totalVarCount; ++i) {
+        if (hash == varHashes[i]) {
+            found = i;
+        }
+    }
+
+    ++stats.symbolLookups;
+    stats.symbolProbes += totalVarCount;
+    return found;
+}
+
+u16 parseNumericLiteral() {
+    char* c = tok.start;
+    char* end = tok.start + tok.length;
+    char suffix = end[-1] | 0x20; //lower case
+
+    //f and d are digits of hex literals, unless they follow a binary exponent
+    bool isHex = tok.length > 1 && c[0] == '0' && (c[1] | 0x20) == 'x';
+    char exponent = isHex ? 'p' : 'e';
+    bool isFloatingPoint = false;
+    for (char* i = c; i < end; ++i) {
+        isFloatingPoint |= *i == '.' || (*i | 0x20) == exponent;
+    }
+    isFloatingPoint |= !isHex && (suffix == 'f' || suffix == 'd');
+
+    u16 e;
+    if (isFloatingPoint) {
+        if (suffix == 'f' || suffix == 'd') {
+            --end;
+        }
+
+        const FloatFormat& format = suffix == 'f' ? FLOAT_FORMAT : DOUBLE_FORMAT;
+        u64 bits = isHex ? parseHexFloat(c + 2, end, format) : parseDecimalFloat(c, end, format);
+
+        if (suffix == 'f') {
+            e = newExpr(expr::Literal, wasm::type::f32);
+            memcpy(&exprs[e].f32Value, &bits, 4);
+        } else {
+            e = newExpr(expr::Literal, wasm::type::f64);
+            memcpy(&exprs[e].f64Value, &bits, 8);
+        }
+    } else {
+        if (suffix == 'l') {
+            --end;
+        }
+
+        //ints wrap to 32 bits, so that 0xFFFFFFFF is -1, and -2147483648 can be negated
+        u64 value = parseInteger(c, end);
+        e = newExpr(expr::Literal, suffix == 'l' ? wasm::type::i64 : wasm::type::i32);
+        exprs[e].intValue = suffix == 'l' ? (i64)value : (i32)value;
+    }
+
+    nextToken();
+    return e;
+}
+
+u8 getCallType(Expr& call) {
+    Expr& arg = exprs[call.lhs];
+    Expr& arg2 = exprs[arg.next];
+
+    switch (call.op) {
+        case HASH("keyboard.nextFloat"):
+            return wasm::type::f32;
+
+        case HASH("System.nanoTime"):
+        case HASH("System.currentTimeMillis"):
+            return wasm::type::i64;
+
+        //Math methods without an int overload take and return doubles
+        case HASH("Math.sqrt"):
+        case HASH("Math.floor"):
+        case HASH("Math.ceil"):
+        case HASH("Math.rint"):
+            return wasm::type::f64;
+
+        case HASH("Math.abs"):
+            return promote(arg.type, wasm::type::i32);
+
+        case HASH("Math.min"):
+        case HASH("Math.max"):
+            return promote(arg.type, arg2.type);
+
+        //float and double are the only overloads, so every other numeric type converts to float
+        case HASH("Math.signum"):
+            return promote(arg.type, wasm::type::f32);
+
+        case HASH("Math.copySign"):
+            return promote(promote(arg.type, arg2.type), wasm::type::f32);
+
+        case HASH("String.valueOf"):
+        case HASH("StringBuilder.toString"):
+            return java::type::String;
+
+        case HASH("String.length"):
+        case HASH("String.hashCode"):
+        case HASH("StringBuilder.length"):
+            return wasm::type::i32;
+
+        case HASH("String.charAt"):
+        case HASH("StringBuilder.charAt"):
+            return java::type::_char;
+
+        case HASH("String.equals"):
+        case HASH("String.isEmpty"):
+            return java::type::boolean;
+
+        case HASH("StringBuilder.append"):
+            return java::type::StringBuilder;
+    }
+
+    return findMathImport(call.op) != -1 ? wasm::type::f64 : wasm::type::_void;
+}
+
+//the fields of scalar replaced objects are locals
+u16 newFieldAccess(u16 object, u32 fieldIndex) {
+    Expr& o = exprs[object];
+    if (o.kind == expr::Variable && varFirstScalar[o.varIndex] != -1) {
+        u16 e = newExpr(expr::Variable, fields[fieldIndex].type);
+        exprs[e].varIndex = varFirstScalar[o.varIndex] + fieldIndex - classes[o.type - java::type::firstClass].firstField;
+        return e;
+    }
+
+    u16 e = newExpr(expr::FieldAccess, fields[fieldIndex].type);
+    exprs[e].lhs = object;
+    exprs[e].fieldIndex = fieldIndex;
+    return e;
+}
+
+//a static field is either a global or a constant.  hash must be qualified by its class
+u16 parseStaticField(u32 hash) {
+    u32 varIndex = findVar(hash);
+    u32 constant = findConstant(hash);
+    u16 e = 0;
+
+    if (varIndex != -1 && varIndex < globalVarCount) {
+        e = newExpr(expr::Variable, varTypes[varIndex]);
+        exprs[e].varIndex = varIndex;
+    } else if (constant != -1) {
+        e = newExpr(expr::Literal, wasm::type::_void);
+        if (e) {
+            exprs[e] = constantValues[constant];
+        }
+    }
+
+    return e;
+}
+
+//static fields the class doesn't declare are inherited from its superclasses
+u16 parseInheritedStaticField(u32 classIndex, char* name, u32 length) {
+    u16 e = 0;
+    for (; !e && classIndex != -1; classIndex = classes[classIndex].superclass) {
+        e = parseStaticField(getMemberHash(classIndex, name, length));
+    }
+
+    return e;
+}
+
+//resolve a name such as x, this.x, p.origin.x, count, Main.count or Other.CONSTANT.
+//Returns 0 if it doesn't name a value
+u16 parseName(char* name, u32 length) {
+    u32 segmentLength = 0;
+    while (segmentLength < length && name[segmentLength] != '.') {
+        ++segmentLength;
+    }
+
+    u32 hash = getIdentifierHash(name, segmentLength);
+    u32 varIndex = findVar(hash);
+    u32 fieldIndex = inStaticContext ? -1 : findField(currentClass, hash);
+    u16 e = 0;
+
+    if (varIndex != -1 && varIndex >= globalVarCount) {
+        e = newExpr(expr::Variable, varTypes[varIndex]);
+        exprs[e].varIndex = varIndex;
+    } else if (fieldIndex != -1) {
+        u16 object = newExpr(expr::Variable, java::type::firstClass + currentClass);
+        exprs[object].varIndex = findVar(HASH("this"));
+        e = newFieldAccess(object, fieldIndex);
+    } else if (findClass(hash) != -1 && segmentLength < length) {
+        //a static field named by its class
+        u32 fieldStart = segmentLength + 1;
+        do {
+            ++segmentLength;
+        } while (segmentLength < length && name[segmentLength] != '.');
+
+        e = parseInheritedStaticField(findClass(hash), name + fieldStart, segmentLength - fieldStart);
+    } else {
+        e = parseInheritedStaticField(currentClass, name, segmentLength);
+    }
+
+    //every remaining segment is a field of the object before it
+    while (e && segmentLength < length) {
+        name += segmentLength + 1;
+        length -= segmentLength + 1;
+
+        segmentLength = 0;
+        while (segmentLength < length && name[segmentLength] != '.') {
+            ++segmentLength;
+        }
+
+        u8 type = exprs[e].type;
+        fieldIndex = type >= java::type::firstClass ? findField(type - java::type::firstClass, getIdentifierHash(name, segmentLength)) : -1;
+        e = fieldIndex != -1 ? newFieldAccess(e, fieldIndex) : 0;
+    }
+
+    return e;
+}
+
+//tok must be the '(' of an argument list.  The arguments are chained together through
+//their next index.  tok is left after the ')'
+u16 parseArguments(u32& argCount) {
+    u16 first = 0;
+    u16 prevArg = 0;
+    argCount = 0;
+    nextToken();
+
+    while (tok.kind != token::End && !isSymbol(')')) {
+        u16 arg = parseExpression();
+        if (prevArg) {
+            exprs[prevArg].next = arg;
+        } else {
+            first = arg;
+        }
+        prevArg = arg;
+        ++argCount;
+
+        if (isSymbol(',')) {
+            nextToken();
+        } else if (!isSymbol(')')) {
+            break;
+        }
+    }
+
+    nextToken();
+    return first;
+}
+
+//tok must be the '(' of a call of a method of the object receiver
+u16 parseMethodCall(u16 receiver, char* name, u32 length) {
+    u32 argCount;
+    u16 args = parseArguments(argCount);
+    u8 type = exprs[receiver].type;
+
+    u16 e = newExpr(expr::Call, wasm::type::_void);
+    Expr& call = exprs[e];
+    exprs[receiver].next = args;
+    call.lhs = receiver;
+
+    //String and StringBuilder methods are named by their class, e.g. String.length
+    if (type == java::type::String || type == java::type::StringBuilder) {
+        call.op = getIdentifierHash(name, length, type == java::type::String ? HASH("String.") : HASH("StringBuilder."));
+        call.type = getCallType(call);
+        if (call.type == wasm::type::_void) {
+            REPORT_NAME_ERROR("cannot find symbol", name, length);
+        }
+        return e;
+    }
+
+    u32 methodIndex = type >= java::type::firstClass ? findMethod(type - java::type::firstClass, getIdentifierHash(name, length), argCount) : -1;
+    if (methodIndex != -1) {
+        call.kind = expr::MethodCall;
+        call.type = methods[methodIndex].returnType;
+        call.methodIndex = methodIndex;
+
+        //static methods may be called through an object, which isn't passed to them
+        if (methods[methodIndex].isStatic) {
+            call.lhs = args;
+        }
+    } else {
+        REPORT_NAME_ERROR("cannot find symbol", name, length);
+    }
+
+    return e;
+}
+
+//tok must be the '(' following the name of the called method
+u16 parseCall(char* name, u32 length) {
+    //the method name is the last segment.  Anything before it names a class or an object
+    u32 nameStart = length;
+    while (nameStart > 0 && name[nameStart - 1] != '.') {
+        --nameStart;
+    }
+
+    u32 qualifierHash = nameStart > 0 ? getIdentifierHash(name, nameStart - 1) : 0;
+    bool isSuper = qualifierHash == HASH("super");
+    if (nameStart > 0 && !isSuper && findClass(qualifierHash) == -1) {
+        u16 receiver = parseName(name, nameStart - 1);
+        if (receiver) {
+            return parseMethodCall(receiver, name + nameStart, length - nameStart);
+        }
+    }
+
+    u32 argCount;
+    u16 args = parseArguments(argCount);
+
+    u16 e = newExpr(expr::Call, wasm::type::_void);
+    Expr& call = exprs[e];
+    call.op = getIdentifierHash(name, length);
+    call.lhs = args;
+    call.type = getCallType(call);
+
+    //library methods
+    if (call.type != wasm::type::_void || call.op == HASH("keyboard.nextFloat")) {
+        return e;
+    }
+
+    //super.method(...) calls the method the superclass has, whatever the class of this is
+    u32 classIndex = isSuper ? classes[currentClass].superclass : nameStart > 0 ? findClass(qualifierHash) : currentClass;
+    u32 methodIndex = classIndex != -1 ? findMethod(classIndex, getIdentifierHash(name + nameStart, length - nameStart), argCount) : -1;
+    if (methodIndex == -1) {
+        REPORT_NAME_ERROR("cannot find symbol", name, length);
+        return e;
+    }
+
+    Method& m = methods[methodIndex];
+
+    //unqualified calls to instance methods are made on this
+    if (!m.isStatic) {
+        if (inStaticContext || (nameStart > 0 && !isSuper)) {
+            REPORT_NAME_ERROR("non-static method cannot be called from a static context:", name, length);
+            return e;
+        }
+
+        u16 receiver = newExpr(expr::Variable, java::type::firstClass + currentClass);
+        exprs[receiver].varIndex = findVar(HASH("this"));
+        exprs[receiver].next = args;
+        call.lhs = receiver;
+    }
+
+    call.kind = expr::MethodCall;
+    call.op = isSuper ? HASH("super") : call.op;
+    call.type = m.returnType;
+    call.methodIndex = methodIndex;
+    return e;
+}
+
+//tok must be the class name following new
+u16 parseNew() {
+    char* name = tok.start;
+    u32 length = tok.length;
+    u32 classIndex = findClass(tok.hash);
+    bool isStringBuilder = tok.hash == HASH("StringBuilder");
+    nextToken();
+
+    //a StringBuilder is created with an optional capacity or initial String
+    if (isStringBuilder && isSymbol('(')) {
+        u32 argCount;
+        u16 e = newExpr(expr::New, java::type::StringBuilder);
+        exprs[e].lhs = parseArguments(argCount);
+        exprs[e].op = -1;
+        return e;
+    }
+
+    if (classIndex == -1) {
+        REPORT_NAME_ERROR("cannot find symbol", name, length);
+        return 0;
+    }
+
+    if (!isSymbol('(')) {
+        return 0;
+    }
+
+    u32 argCount;
+    u16 args = parseArguments(argCount);
+
+    u16 e = newExpr(expr::New, java::type::firstClass + classIndex);
+    exprs[e].lhs = args;
+    exprs[e].op = findMethod(classIndex, HASH("<init>"), argCount);
+    return e;
+}
+
+u16 parseOperand() {
+    u16 e = 0;
+
+    if (tok.kind == token::NumericLiteral) {
+        return parseNumericLiteral();
+    }
+
+    if (tok.kind == token::StringLiteral) {
+        //the literals concatenated onto this one were folded into it
+        u32 literal = findStringLiteral(tok.start);
+        if (literal != -1) {
+            e = newExpr(expr::StringLiteral, java::type::String);
+            exprs[e].dataOffset = stringLiteralDataOffset[literal];
+            exprs[e].length = loadU32(dataStart + stringLiteralDataOffset[literal] + string::length);
+            readPos = stringLiteralEndPos[literal];
+        }
+    } else if (tok.kind == token::CharLiteral) {
+        u8 units[4] = {0};
+        decodeStringLiteral(tok.start + 1, tok.length - 2, units);
+        e = newExpr(expr::Literal, java::type::_char);
+        exprs[e].intValue = units[0] | units[1] << 8;
+    } else if (tok.kind == token::Identifier) {
+        char* name = tok.start;
+        u32 length = tok.length;
+        u32 hash = tok.hash;
+        nextToken();
+
+        if (hash == HASH("new")) {
+            return parseNew();
+        } else if (isSymbol('(')) {
+            return parseCall(name, length);
+        } else if (hash == HASH("null")) {
+            return newExpr(expr::Literal, java::type::null);
+        } else if (hash == HASH("true") || hash == HASH("false")) {
+            e = newExpr(expr::Literal, java::type::boolean);
+            exprs[e].intValue = hash == HASH("true");
+            return e;
+        } else if (hash == HASH("Math.PI")) {
+            e = newExpr(expr::Literal, wasm::type::f64);
+            exprs[e].f64Value = 3.141592653589793;
+            return e;
+        } else if (hash == HASH("Math.E")) {
+            e = newExpr(expr::Literal, wasm::type::f64);
+            exprs[e].f64Value = 2.718281828459045;
+            return e;
+        }
+
+        e = parseName(name, length);
+        if (!e) {
+            REPORT_NAME_ERROR("cannot find symbol", name, length);
+        }
+        return e;
+    } else if (isSymbol('(')) {
+        nextToken();
+        e = parseExpression();
+    } else {
+        //leave terminators for the caller to consume
+        return 0;
+    }
+
+    nextToken();
+    return e;
+}
+
+//members of the value of an expression, such as new Point(1, 2).x or sb.append(a).append(b)
+u16 parseMemberAccesses(u16 e) {
+    while (e && isSymbol('.')) {
+        nextToken();
+        if (tok.kind != token::Identifier) {
+            return 0;
+        }
+
+        char* name = tok.start;
+        u32 length = tok.length;
+        nextToken();
+
+        //the lexer keeps x.y together.  Every segment but the name of a called method is a field
+        u32 segmentStart = 0;
+        for (u32 i = 0; i <= length && e; ++i) {
+            if (i < length && name[i] != '.') {
+                continue;
+            }
+
+            if (i == length && isSymbol('(')) {
+                e = parseMethodCall(e, name + segmentStart, i - segmentStart);
+            } else {
+                u8 type = exprs[e].type;
+                u32 fieldIndex = type >= java::type::firstClass ? findField(type - java::type::firstClass, getIdentifierHash(name + segmentStart, i - segmentStart)) : -1;
+                if (fieldIndex == -1) {
+                    REPORT_NAME_ERROR("cannot find symbol", name + segmentStart, i - segmentStart);
+                    return 0;
+                }
+                e = newFieldAccess(e, fieldIndex);
+            }
+
+            segmentStart = i + 1;
+        }
+    }
+
+    return e;
+}
+
+u16 parsePrimary() {
+    return parseMemberAccesses(parseOperand());
+}
+
+u16 parseUnary() {
+    if (tok.kind == token::Symbol) {
+        u32 op = tok.hash;
+
+        if (op == HASH("-") || op == HASH("!") || op == HASH("~") || op == HASH("+")) {
+            nextToken();
+            u16 operand = parseUnary();
+            Expr& o = exprs[operand];
+
+            if (op == HASH("+")) {
+                return operand;
+            }
+
+            //fold negative literals so that values like -2147483648 are representable
+            if (op == HASH("-") && o.kind == expr::Literal && isNumericType(o.type)) {
+                if (o.type == wasm::type::f32) {
+                    o.f32Value = -o.f32Value;
+                } else if (o.type == wasm::type::f64) {
+                    o.f64Value = -o.f64Value;
+                } else {
+                    o.type = getWasmType(o.type);
+                    u64 negated = 0 - (u64)o.intValue;
+                    o.intValue = o.type == wasm::type::i32 ? (i64)(i32)negated : (i64)negated;
+                }
+                return operand;
+            }
+
+            if (o.kind == expr::Literal && (op == HASH("!") || op == HASH("~"))) {
+                o.intValue = op == HASH("!") ? !o.intValue : ~o.intValue;
+                o.type = op == HASH("!") ? (u8)java::type::boolean : promote(o.type, wasm::type::i32);
+                return operand;
+            }
+
+            u16 e = newExpr(expr::Unary, op == HASH("!") ? (u8)java::type::boolean : promote(o.type, wasm::type::i32));
+            exprs[e].op = op;
+            exprs[e].lhs = operand;
+            return e;
+        }
+
+        //a primitive type name surrounded by parenthesis is a cast
+        if (op == HASH("(")) {
+            char* openParenthesis = tok.start;
+            nextToken();
+            u8 castType = tok.kind == token::Identifier ? getWasmTypeFromCppName(tok.hash) : wasm::type::_void;
+
+            if (castType != wasm::type::_void) {
+                nextToken();
+                if (isSymbol(')')) {
+                    nextToken();
+                    u16 operand = parseUnary();
+
+                    if (exprs[operand].kind == expr::Literal) {
+                        foldConversion(exprs[operand], castType);
+                        return operand;
+                    }
+
+                    u16 e = newExpr(expr::Cast, castType);
+                    exprs[e].lhs = operand;
+                    return e;
+                }
+            }
+
+            rewindTo(openParenthesis);
+        }
+    }
+
+    return parsePrimary();
+}
+
+u32 getBinaryPrecedence(u32 op) {
+    switch (op) {
+        case HASH("*"):
+        case HASH("/"):
+        case HASH("%"):
+            return 10;
+        case HASH("+"):
+        case HASH("-"):
+            return 9;
+        case HASH("<<"):
+        case HASH(">>"):
+        case HASH(">>>"):
+            return 8;
+        case HASH("<"):
+        case HASH(">"):
+        case HASH("<="):
+        case HASH(">="):
+            return 7;
+        case HASH("=="):
+        case HASH("!="):
+            return 6;
+        case HASH("&"):
+            return 5;
+        case HASH("^"):
+            return 4;
+        case HASH("|"):
+            return 3;
+        case HASH("&&"):
+            return 2;
+        case HASH("||"):
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+u16 makeBinary(u32 op, u16 lhs, u16 rhs) {
+    u8 lhsType = exprs[lhs].type;
+    u8 rhsType = exprs[rhs].type;
+    u16 e = newExpr(expr::Binary, wasm::type::_void);
+    Expr& b = exprs[e];
+    b.op = op;
+    b.lhs = lhs;
+    b.rhs = rhs;
+
+    u32 precedence = getBinaryPrecedence(op);
+
+    if (op == HASH("+") && (lhsType == java::type::String || rhsType == java::type::String)) {
+        b.type = b.operandType = java::type::String;
+    } else if (precedence == 8) {
+        //the type of a shift is the promoted type of its left operand alone
+        b.type = b.operandType = promote(lhsType, wasm::type::i32);
+    } else if (lhsType == java::type::boolean && rhsType == java::type::boolean) {
+        b.type = java::type::boolean;
+        b.operandType = wasm::type::i32;
+    } else {
+        b.operandType = promote(lhsType, rhsType);
+        b.type = (precedence == 6 || precedence == 7) ? (u8)java::type::boolean : b.operandType;
+    }
+
+    //constant folding
+    Expr a = exprs[lhs];
+    Expr c = exprs[rhs];
+    if (a.kind == expr::Literal && c.kind == expr::Literal && b.type != java::type::String) {
+        foldConversion(a, b.operandType);
+        foldConversion(c, b.operandType);
+
+        if (foldBinary(op, a, c, b)) {
+            b.lhs = b.rhs = 0;
+        } else {
+            b.kind = expr::Binary;
+        }
+    }
+
+    return e;
+}
+
+u16 parseBinary(u32 minPrecedence) {
+    u16 lhs = parseUnary();
+
+    while (tok.kind == token::Symbol) {
+        u32 op = tok.hash;
+        u32 precedence = getBinaryPrecedence(op);
+        if (precedence == 0 || precedence < minPrecedence) {
+            break;
+        }
+
+        nextToken();
+        u16 rhs = parseBinary(precedence + 1);
+        lhs = makeBinary(op, lhs, rhs);
+    }
+
+    return lhs;
+}
+
+//tok must be the first token of the expression.  tok is left on the token that ended it
+u16 parseExpression() {
+    return parseBinary(1);
+}
+
+
+void emitExpression(u16 index);
+void emitConditionValue(u16 index, bool isInverted);
+
+void emitConst(u8 type, i64 intValue, f64 floatValue) {
+    switch (getWasmType(type)) {
+        case wasm::type::i32:
+            *writePos++ = wasm::i32_const;
+            writePos = insertVarint(writePos, (i32)intValue);
+            break;
+        case wasm::type::i64:
+            *writePos++ = wasm::i64_const;
+            writePos = insertVarint(writePos, intValue);
+            break;
+        case wasm::type::f32:
+            *writePos++ = wasm::f32_const;
+            writePos = insertF32(writePos, floatValue);
+            break;
+        case wasm::type::f64:
+            *writePos++ = wasm::f64_const;
+            writePos = insertF64(writePos, floatValue);
+            break;
+    }
+}
+
+void emitConversion(u8 from, u8 to) {
+    u8 wasmFrom = getWasmType(from);
+    u8 wasmTo = getWasmType(to);
+
+    //Java converts floating point values to integers by truncating them toward zero, saturating
+    //on overflow, and producing 0 for NaN.  That is exactly what the trunc_sat instructions do
+    u8 satOp = 0xFF;
+
+    switch (wasmTo) {
+        case wasm::type::i32:
+            if (wasmFrom == wasm::type::i64) {
+                *writePos++ = wasm::i32_wrap_from_i64;
+            } else if (wasmFrom == wasm::type::f32) {
+                satOp = wasm::misc::i32_trunc_sat_f32_s;
+            } else if (wasmFrom == wasm::type::f64) {
+                satOp = wasm::misc::i32_trunc_sat_f64_s;
+            }
+            break;
+
+        case wasm::type::i64:
+            if (wasmFrom == wasm::type::i32) {
+                *writePos++ = wasm::i64_extend_s_from_i32;
+            } else if (wasmFrom == wasm::type::f32) {
+                satOp = wasm::misc::i64_trunc_sat_f32_s;
+            } else if (wasmFrom == wasm::type::f64) {
+                satOp = wasm::misc::i64_trunc_sat_f64_s;
+            }
+            break;
+
+        case wasm::type::f32:
+            if (wasmFrom == wasm::type::i32) {
+                *writePos++ = wasm::f32_convert_s_from_i32;
+            } else if (wasmFrom == wasm::type::i64) {
+                *writePos++ = wasm::f32_convert_s_from_i64;
+            } else if (wasmFrom == wasm::type::f64) {
+                *writePos++ = wasm::f32_demote_from_f64;
+            }
+            break;
+
+        case wasm::type::f64:
+            if (wasmFrom == wasm::type::i32) {
+                *writePos++ = wasm::f64_convert_s_from_i32;
+            } else if (wasmFrom == wasm::type::i64) {
+                *writePos++ = wasm::f64_convert_s_from_i64;
+            } else if (wasmFrom == wasm::type::f32) {
+                *writePos++ = wasm::f64_promote_from_f32;
+            }
+            break;
+    }
+
+    if (satOp != 0xFF) {
+        *writePos++ = wasm::misc_prefix;
+        *writePos++ = satOp;
+    }
+
+    //char is the only integer type narrower than an i32
+    if (to == java::type::_char && from != java::type::_char) {
+        *writePos++ = wasm::i32_const;
+        writePos = insertVarint(writePos, 0xFFFF);
+        *writePos++ = wasm::i32_and;
+    }
+}
+
+void emitExpressionAs(u16 index, u8 type) {
+    Expr& e = exprs[index];
+
+    //convert literals at compile time
+    if (e.kind == expr::Literal && e.type != type) {
+        Expr converted = e;
+        foldConversion(converted, type);
+        emitConst(type, converted.intValue, type == wasm::type::f32 ? converted.f32Value : converted.f64Value);
+        return;
+    }
+
+    emitExpression(index);
+    emitConversion(e.type, type);
+}
+
+//opcodes of each binary operator, indexed by 0x7F - the wasm type (i32, i64, f32, f64)
+u8 getBinaryOpcode(u32 op, u8 type) {
+    u32 t = wasm::type::i32 - getWasmType(type);
+
+    switch (op) {
+        case HASH("+"): {
+            const u8 ops[] = {wasm::i32_add, wasm::i64_add, wasm::f32_add, wasm::f64_add};
+            return ops[t];
+        }
+        case HASH("-"): {
+            const u8 ops[] = {wasm::i32_sub, wasm::i64_sub, wasm::f32_sub, wasm::f64_sub};
+            return ops[t];
+        }
+        case HASH("*"): {
+            const u8 ops[] = {wasm::i32_mul, wasm::i64_mul, wasm::f32_mul, wasm::f64_mul};
+            return ops[t];
+        }
+        case HASH("/"): {
+            const u8 ops[] = {wasm::i32_div_s, wasm::i64_div_s, wasm::f32_div, wasm::f64_div};
+            return ops[t];
+        }
+        case HASH("%"): {
+            //the floating point remainder is a call of the host's fmod.  See emitRemainder
+            const u8 ops[] = {wasm::i32_rem_s, wasm::i64_rem_s, wasm::unreachable, wasm::unreachable};
+            return ops[t];
+        }
+        case HASH("&"): {
+            const u8 ops[] = {wasm::i32_and, wasm::i64_and, wasm::unreachable, wasm::unreachable};
+            return ops[t];
+        }
+        case HASH("|"): {
+            const u8 ops[] = {wasm::i32_or, wasm::i64_or, wasm::unreachable, wasm::unreachable};
+            return ops[t];
+        }
+        case HASH("^"): {
+            const u8 ops[] = {wasm::i32_xor, wasm::i64_xor, wasm::unreachable, wasm::unreachable};
+            return ops[t];
+        }
+        case HASH("<<"): {
+            const u8 ops[] = {wasm::i32_shl, wasm::i64_shl, wasm::unreachable, wasm::unreachable};
+            return ops[t];
+        }
+        case HASH(">>"): {
+            const u8 ops[] = {wasm::i32_shr_s, wasm::i64_shr_s, wasm::unreachable, wasm::unreachable};
+            return ops[t];
+        }
+        case HASH(">>>"): {
+            const u8 ops[] = {wasm::i32_shr_u, wasm::i64_shr_u, wasm::unreachable, wasm::unreachable};
+            return ops[t];
+        }
+        case HASH("=="): {
+            const u8 ops[] = {wasm::i32_eq, wasm::i64_eq, wasm::f32_eq, wasm::f64_eq};
+            return ops[t];
+        }
+        case HASH("!="): {
+            const u8 ops[] = {wasm::i32_ne, wasm::i64_ne, wasm::f32_ne, wasm::f64_ne};
+            return ops[t];
+        }
+        case HASH("<"): {
+            const u8 ops[] = {wasm::i32_lt_s, wasm::i64_lt_s, wasm::f32_lt, wasm::f64_lt};
+            return ops[t];
+        }
+        case HASH(">"): {
+            const u8 ops[] = {wasm::i32_gt_s, wasm::i64_gt_s, wasm::f32_gt, wasm::f64_gt};
+            return ops[t];
+        }
+        case HASH("<="): {
+            const u8 ops[] = {wasm::i32_le_s, wasm::i64_le_s, wasm::f32_le, wasm::f64_le};
+            return ops[t];
+        }
+        case HASH(">="): {
+            const u8 ops[] = {wasm::i32_ge_s, wasm::i64_ge_s, wasm::f32_ge, wasm::f64_ge};
+            return ops[t];
+        }
+        default:
+            return wasm::unreachable;
+    }
+}
+
+void emitGetVar(u32 varIndex) {
+    if (varIndex < globalVarCount) {
+        *writePos++ = wasm::get_global;
+        writePos = insertVaruint(writePos, varIndex);
+    } else {
+        *writePos++ = wasm::get_local;
+        writePos = insertVaruint(writePos, varIndex - globalVarCount);
+    }
+}
+
+void emitSetVar(u32 varIndex) {
+    if (varIndex < globalVarCount) {
+        *writePos++ = wasm::set_global;
+        writePos = insertVaruint(writePos, varIndex);
+    } else {
+        *writePos++ = wasm::set_local;
+        writePos = insertVaruint(writePos, varIndex - globalVarCount);
+    }
+}
+
+void emitLocal(u8 op, u32 localIndex) {
+    *writePos++ = op;
+    writePos = insertVaruint(writePos, localIndex);
+}
+
+//java.lang.Math methods that map onto wasm instructions.  Returns false for any other method
+bool emitMathIntrinsic(Expr& call) {
+    u16 arg = call.lhs;
+    u16 arg2 = exprs[arg].next;
+    u8 type = getWasmType(call.type);
+    bool isFloat = type == wasm::type::f32;
+
+    switch (call.op) {
+        case HASH("Math.sqrt"):
+            emitExpressionAs(arg, wasm::type::f64);
+            *writePos++ = wasm::f64_sqrt;
+            return true;
+
+        case HASH("Math.floor"):
+            emitExpressionAs(arg, wasm::type::f64);
+            *writePos++ = wasm::f64_floor;
+            return true;
+
+        case HASH("Math.ceil"):
+            emitExpressionAs(arg, wasm::type::f64);
+            *writePos++ = wasm::f64_ceil;
+            return true;
+
+        //both round half way cases to even
+        case HASH("Math.rint"):
+            emitExpressionAs(arg, wasm::type::f64);
+            *writePos++ = wasm::f64_nearest;
+            return true;
+
+        case HASH("Math.abs"):
+            emitExpressionAs(arg, type);
+
+            if (type == wasm::type::f32 || type == wasm::type::f64) {
+                *writePos++ = isFloat ? wasm::f32_abs : wasm::f64_abs;
+            } else {
+                //x >= 0 ? x : 0 - x.  abs(MIN_VALUE) overflows back to MIN_VALUE, as in Java
+                u32 x = acquireScratchLocal(type);
+                u8 zero[] = {wasm::i32_const, 0};
+                if (type == wasm::type::i64) {
+                    zero[0] = wasm::i64_const;
+                }
+
+                emitLocal(wasm::tee_local, x);
+                *writePos++ = zero[0];
+                *writePos++ = zero[1];
+                emitLocal(wasm::get_local, x);
+                *writePos++ = getBinaryOpcode(HASH("-"), type);
+                emitLocal(wasm::get_local, x);
+                *writePos++ = zero[0];
+                *writePos++ = zero[1];
+                *writePos++ = getBinaryOpcode(HASH(">="), type);
+                *writePos++ = wasm::select;
+            }
+            return true;
+
+        case HASH("Math.min"):
+        case HASH("Math.max"):
+            emitExpressionAs(arg, type);
+
+            //wasm min and max propagate NaN and order -0.0 below 0.0, just like Java
+            if (type == wasm::type::f32 || type == wasm::type::f64) {
+                emitExpressionAs(arg2, type);
+
+                if (call.op == HASH("Math.min")) {
+                    *writePos++ = isFloat ? wasm::f32_min : wasm::f64_min;
+                } else {
+                    *writePos++ = isFloat ? wasm::f32_max : wasm::f64_max;
+                }
+            } else {
+                //a < b ? a : b
+                u32 a = acquireScratchLocal(type);
+                u32 b = acquireScratchLocal(type);
+
+                emitLocal(wasm::tee_local, a);
+                emitExpressionAs(arg2, type);
+                emitLocal(wasm::tee_local, b);
+                emitLocal(wasm::get_local, a);
+                emitLocal(wasm::get_local, b);
+                *writePos++ = getBinaryOpcode(call.op == HASH("Math.min") ? HASH("<") : HASH(">"), type);
+                *writePos++ = wasm::select;
+            }
+            return true;
+
+        case HASH("Math.signum"): {
+            //|x| > 0 ? copysign(1, x) : x.  Zeros keep their sign and NaN stays NaN
+            u32 x = acquireScratchLocal(type);
+
+            emitConst(type, 1, 1.0);
+            emitExpressionAs(arg, type);
+            emitLocal(wasm::tee_local, x);
+            *writePos++ = isFloat ? wasm::f32_copysign : wasm::f64_copysign;
+            emitLocal(wasm::get_local, x);
+            emitLocal(wasm::get_local, x);
+            *writePos++ = isFloat ? wasm::f32_abs : wasm::f64_abs;
+            emitConst(type, 0, 0.0);
+            *writePos++ = isFloat ? wasm::f32_gt : wasm::f64_gt;
+            *writePos++ = wasm::select;
+            return true;
+        }
+
+        case HASH("Math.copySign"):
+            emitExpressionAs(arg, type);
+            emitExpressionAs(arg2, type);
+            *writePos++ = isFloat ? wasm::f32_copysign : wasm::f64_copysign;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+//the id of a function, where an instruction refers to it, as a two byte varuint.  Linking
+//replaces it with the function's index in calls, and with its type index in call_indirect and
+//block types
+void emitFunctionId(u32 function) {
+    if (callSiteCount == MAX_CALL_SITES) {
+        REPORT_ERROR("too many calls");
+    } else {
+        callSiteOffsets[callSiteCount++] = writePos - codeStart;
+    }
+    patchVaruint(writePos, function);
+    writePos += 2;
+}
+
+void emitCallTo(u32 function) {
+    *writePos++ = wasm::call;
+    emitFunctionId(function);
+}
+
+u32 getMethodFunction(u32 methodIndex) {
+    return FIRST_DEFINED_FUNCTION + methodIndex;
+}
+
+//the allocator follows the last method
+u32 getAllocatorFunction() {
+    return FIRST_DEFINED_FUNCTION + methodCount;
+}
+
+//the String runtime follows the allocator
+void emitRuntimeCall(u32 function) {
+    emitCallTo(getAllocatorFunction() + 1 + function);
+}
+
+//and the library follows the String runtime.  It's only compiled along with it
+u32 getLibraryFunction(u32 function) {
+    return getAllocatorFunction() + 1 + runtime::count + function;
+}
+
+void emitLibraryCall(u32 function) {
+    emitCallTo(getLibraryFunction(function));
+}
+
+//the methods, and the runtime functions the program might call
+u32 getDefinedFunctionCount() {
+    return methodCount + usesAllocator + usesStrings * (runtime::count + library::count);
+}
+
+bool emitStringMethod(Expr& call);
+
+void emitCall(Expr& call) {
+    if (call.op == HASH("keyboard.nextFloat")) {
+        emitCallTo(host::nextF32);
+        return;
+    }
+
+    //the clocks are doubles, which hold a nanosecond count exactly for over 100 days
+    if (call.op == HASH("System.nanoTime") || call.op == HASH("System.currentTimeMillis")) {
+        emitCallTo(call.op == HASH("System.nanoTime") ? host::nanoTime : host::currentTimeMillis);
+        *writePos++ = wasm::misc_prefix;
+        *writePos++ = wasm::misc::i64_trunc_sat_f64_s;
+        return;
+    }
+
+    if (emitMathIntrinsic(call) || emitStringMethod(call)) {
+        return;
+    }
+
+    u32 mathImport = findMathImport(call.op);
+    if (mathImport != -1) {
+        for (u16 arg = call.lhs; arg; arg = exprs[arg].next) {
+            emitExpressionAs(arg, wasm::type::f64);
+        }
+
+        emitCallTo(host::count + mathImport);
+        return;
+    }
+
+    //a call parseCall couldn't resolve, which it reported
+    *writePos++ = wasm::unreachable;
+}
+
+//load or store a field of the object whose address is on the stack.  The field's offset is
+//the instruction's offset immediate, so no address arithmetic is needed
+void emitFieldAccess(u32 fieldIndex, bool isStore) {
+    Field& f = fields[fieldIndex];
+    u8 op;
+    u8 alignment; //log2 of the field's size
+
+    switch (f.type) {
+        case java::type::boolean:
+            op = isStore ? wasm::i32_store8 : wasm::i32_load8_u;
+            alignment = 0;
+            break;
+        case java::type::_char:
+            op = isStore ? wasm::i32_store16 : wasm::i32_load16_u;
+            alignment = 1;
+            break;
+        case wasm::type::i64:
+            op = isStore ? wasm::i64_store : wasm::i64_load;
+            alignment = 3;
+            break;
+        case wasm::type::f32:
+            op = isStore ? wasm::f32_store : wasm::f32_load;
+            alignment = 2;
+            break;
+        case wasm::type::f64:
+            op = isStore ? wasm::f64_store : wasm::f64_load;
+            alignment = 3;
+            break;
+        default:
+            op = isStore ? wasm::i32_store : wasm::i32_load;
+            alignment = 2;
+            break;
+    }
+
+    *writePos++ = op;
+    *writePos++ = alignment;
+    writePos = insertVaruint(writePos, f.offset);
+}
+
+void emitMemoryAccess(u8 op, u8 alignment, u32 offset) {
+    *writePos++ = op;
+    *writePos++ = alignment;
+    writePos = insertVaruint(writePos, offset);
+}
+
+//count how often the code at sourcePos runs, when profiling.  Costs one load, add and store.
+//Code the compiler made up has no position, and isn't counted
+void emitProfileCounter(u8 kind, char* sourcePos) {
+    if (!isProfiling || !sourcePos) {
+        return;
+    }
+
+    u32 site = 0;
+    while (site < profileSiteCount && (profileSitePos[site] != sourcePos || profileSiteKind[site] != kind)) {
+        ++site;
+    }
+
+    if (site == maxProfileSites) {
+        return;
+    }
+
+    if (site == profileSiteCount) {
+        profileSitePos[site] = sourcePos;
+        profileSiteKind[site] = kind;
+        ++profileSiteCount;
+    }
+
+    u32 counter = profileStart + 4 + 8 * site + 4;
+    emitConst(wasm::type::i32, 0, 0.0);
+    emitConst(wasm::type::i32, 0, 0.0);
+    emitMemoryAccess(wasm::i32_load, 2, counter);
+    emitConst(wasm::type::i32, 1, 0.0);
+    *writePos++ = wasm::i32_add;
+    emitMemoryAccess(wasm::i32_store, 2, counter);
+}
+
+//the fuel follows the count of allocations
+u32 getFuelGlobal() {
+    return globalVarCount + 2 * usesAllocator + isProfiling + (usesAllocator && isBenchmarking);
+}
+
+//burn a unit of fuel in fuel mode, or yield to the host when there's none left
+void emitFuelCheck() {
+    if (!isFueled) {
+        return;
+    }
+
+    *writePos++ = wasm::get_global;
+    writePos = insertVaruint(writePos, getFuelGlobal());
+    *writePos++ = wasm::_if;
+    *writePos++ = wasm::type::i32;
+    *writePos++ = wasm::get_global;
+    writePos = insertVaruint(writePos, getFuelGlobal());
+    emitConst(wasm::type::i32, 1, 0.0);
+    *writePos++ = wasm::i32_sub;
+    *writePos++ = wasm::_else;
+    emitCallTo(host::yield);
+    *writePos++ = wasm::end;
+    *writePos++ = wasm::set_global;
+    writePos = insertVaruint(writePos, getFuelGlobal());
+}
+
+//objects are allocated in a few size classes: multiples of 8 bytes up to 64, then powers of
+//two.  Every object is aligned for its widest field, and same sized allocations can later
+//share free lists
+u32 getSizeClass(u32 size) {
+    if (size <= 64) {
+        return size <= 8 ? 8 : (size + 7) & ~7;
+    }
+
+    u32 sizeClass = 128;
+    while (sizeClass < size) {
+        sizeClass <<= 1;
+    }
+
+    return sizeClass;
+}
+
+//a call that may run either of two methods tests the class of the receiver, whose vtable start
+//is on the stack, against the classes that run one of them.  Both are called directly, from an
+//if block that takes the receiver and the arguments as its parameters
+void emitGuardedCall(u32 classIndex, u32* targets) {
+    Method& m = methods[targets[0]];
+    u32 classCounts[2] = {0, 0};
+
+    for (u32 i = 0; i < classCount; ++i) {
+        if (classes[i].isInstantiated && isSubclass(i, classIndex)) {
+            ++classCounts[findMethod(i, m.hash, m.paramCount) != targets[0]];
+        }
+    }
+
+    //test for whichever method fewer classes run
+    u32 guarded = classCounts[1] < classCounts[0];
+    u32 vtableStart = classCounts[guarded] > 1 ? acquireScratchLocal(wasm::type::i32) : -1;
+    u32 tested = 0;
+
+    for (u32 i = 0; i < classCount; ++i) {
+        if (!classes[i].isInstantiated || !isSubclass(i, classIndex) || (findMethod(i, m.hash, m.paramCount) != targets[0]) != guarded) {
+            continue;
+        }
+
+        if (vtableStart != -1) {
+            emitLocal(tested == 0 ? wasm::tee_local : wasm::get_local, vtableStart);
+        }
+        emitConst(wasm::type::i32, classes[i].vtableStart, 0.0);
+        *writePos++ = wasm::i32_eq;
+
+        if (tested++ > 0) {
+            *writePos++ = wasm::i32_or;
+        }
+    }
+
+    *writePos++ = wasm::_if;
+    emitFunctionId(getMethodFunction(targets[guarded]));
+    emitCallTo(getMethodFunction(targets[guarded]));
+    *writePos++ = wasm::_else;
+    emitCallTo(getMethodFunction(targets[!guarded]));
+    *writePos++ = wasm::end;
+}
+
+//call a method whose receiver, if any, and arguments are chained from arg.  A virtual call is
+//made directly when the classes with instances only let it run one method, which is the common
+//case.  Otherwise it's dispatched on the vtable start in the header of the receiver
+void emitMethodCall(u32 methodIndex, u16 arg, bool isVirtual) {
+    Method& m = methods[methodIndex];
+    u32 targets[MAX_CALL_TARGETS];
+    u32 targetCount = 0;
+    u32 receiver = -1;
+    u32 classIndex = 0;
+
+    if (!m.isStatic) {
+        classIndex = exprs[arg].type - java::type::firstClass;
+        if (isVirtual) {
+            targetCount = findCallTargets(classIndex, methodIndex, targets);
+        }
+
+        emitExpression(arg);
+        if (targetCount > 1) {
+            receiver = acquireScratchLocal(wasm::type::i32);
+            emitLocal(wasm::tee_local, receiver);
+        }
+        arg = exprs[arg].next;
+    }
+
+    for (u32 i = 0; i < m.paramCount && arg; ++i) {
+        emitExpressionAs(arg, paramTypes[m.firstParam + i]);
+        arg = exprs[arg].next;
+    }
+
+    //without any instances to call it on, the receiver can only be null
+    if (targetCount <= 1) {
+        emitCallTo(getMethodFunction(targetCount == 1 ? targets[0] : methodIndex));
+        return;
+    }
+
+    emitLocal(wasm::get_local, receiver);
+    emitMemoryAccess(wasm::i32_load, 2, 0);
+
+    if (targetCount == 2) {
+        emitGuardedCall(classIndex, targets);
+        return;
+    }
+
+    //every method that overrides another has its slot, and so its type
+    if (m.slot > 0) {
+        emitConst(wasm::type::i32, m.slot, 0.0);
+        *writePos++ = wasm::i32_add;
+    }
+
+    *writePos++ = wasm::call_indirect;
+    emitFunctionId(getMethodFunction(targets[0]));
+    *writePos++ = 0; //table index
+}
+
+u32 getStackTopGlobal() {
+    return globalVarCount + 1;
+}
+
+//the count of allocations a benchmark reads follows the profile's address
+u32 getAllocationCountGlobal() {
+    return globalVarCount + 2 + isProfiling;
+}
+
+//benchmarks of methods other than main run the static initializers before them
+bool exportsStaticInitializer() {
+    return isBenchmarking && staticInitializerMethod != -1;
+}
+
+bool isBenchmarkExport(u32 methodIndex) {
+    Method& m = methods[methodIndex];
+    return isBenchmarking && m.isStatic && m.paramCount == 0 && m.parameterList && methodIndex != mainMethod;
+}
+
+//allocate an object in the current frame of the stack.  When the stack is full, the object
+//is allocated on the heap instead.  The address is left in the object local
+void emitStackAllocation(u32 size, u32 object) {
+    u32 stackTop = getStackTopGlobal();
+    u32 newTop = acquireScratchLocal(wasm::type::i32);
+
+    //remember where the stack was before this block allocated anything
+    if (blockStackSave == -1) {
+        blockStackSave = addLocal(HIDDEN_HASH, wasm::type::i32) - globalVarCount;
+
+        *writePos++ = wasm::get_global;
+        writePos = insertVaruint(writePos, stackTop);
+        emitLocal(wasm::set_local, blockStackSave);
+    }
+
+    *writePos++ = wasm::get_global;
+    writePos = insertVaruint(writePos, stackTop);
+    emitLocal(wasm::tee_local, object);
+    emitConst(wasm::type::i32, size, 0.0);
+    *writePos++ = wasm::i32_add;
+    emitLocal(wasm::tee_local, newTop);
+    emitConst(wasm::type::i32, stackLimit, 0.0);
+    *writePos++ = wasm::i32_gt_u;
+    *writePos++ = wasm::_if;
+    *writePos++ = wasm::type::_void;
+
+    emitConst(wasm::type::i32, size, 0.0);
+    emitCallTo(getAllocatorFunction());
+    emitLocal(wasm::set_local, object);
+
+    *writePos++ = wasm::_else;
+
+    emitLocal(wasm::get_local, newTop);
+    *writePos++ = wasm::set_global;
+    writePos = insertVaruint(writePos, stackTop);
+
+    //memory on the stack is reused, but new objects must start out zeroed.  Small ones take a
+    //few stores, and larger ones a memory.fill
+    if (size > MAX_ZEROING_STORES * 8) {
+        emitLocal(wasm::get_local, object);
+        emitConst(wasm::type::i32, 0, 0.0);
+        emitConst(wasm::type::i32, size, 0.0);
+        *writePos++ = wasm::misc_prefix;
+        *writePos++ = wasm::misc::memory_fill;
+        *writePos++ = 0; //memory index
+    } else {
+        for (u32 offset = 0; offset < size; offset += 8) {
+            emitLocal(wasm::get_local, object);
+            emitConst(wasm::type::i64, 0, 0.0);
+            *writePos++ = wasm::i64_store;
+            *writePos++ = 3; //alignment
+            writePos = insertVaruint(writePos, offset);
+        }
+    }
+
+    *writePos++ = wasm::end;
+}
+
+//free the objects the current block allocated on the stack
+void emitStackRestore(u32 savedStackTop) {
+    emitLocal(wasm::get_local, savedStackTop);
+    *writePos++ = wasm::set_global;
+    writePos = insertVaruint(writePos, getStackTopGlobal());
+}
+
+//free what the blocks from firstBlock on allocated before jumping out of them.  The outermost
+//of them that allocated saved the stack top from before any of them did
+void emitStackRestoreFrom(u32 firstBlock) {
+    for (u32 i = firstBlock; i < blockDepth && i < MAX_BLOCK_DEPTH; ++i) {
+        u32 save = i == blockDepth - 1 ? blockStackSave : blockStackSaves[i];
+        if (save != -1) {
+            emitStackRestore(save);
+            return;
+        }
+    }
+}
+
+void emitNew(Expr& e, bool onStack) {
+    Class& c = classes[e.type - java::type::firstClass];
+    u32 size = getSizeClass(c.size);
+
+    if (!onStack) {
+        emitConst(wasm::type::i32, size, 0.0);
+        emitCallTo(getAllocatorFunction());
+
+        if (e.op == -1 && !c.hasHeader) {
+            return;
+        }
+    }
+
+    u32 object = acquireScratchLocal(wasm::type::i32);
+    if (onStack) {
+        emitStackAllocation(size, object);
+    } else {
+        emitLocal(wasm::set_local, object);
+    }
+
+    if (c.hasHeader) {
+        emitLocal(wasm::get_local, object);
+        emitConst(wasm::type::i32, c.vtableStart, 0.0);
+        emitMemoryAccess(wasm::i32_store, 2, 0);
+    }
+
+    //the new object is the constructor's this, and then the value of the expression
+    if (e.op != -1) {
+        u16 thisArg = newExpr(expr::Variable, e.type);
+        exprs[thisArg].varIndex = globalVarCount + object;
+        exprs[thisArg].next = e.lhs;
+        emitMethodCall(e.op, thisArg, false);
+    }
+
+    emitLocal(wasm::get_local, object);
+}
+
+//the most characters a value of the given type appends to a String.  The length of a
+//String is only known at runtime
+u32 getMaxAppendLength(u8 type) {
+    switch (getWasmType(type)) {
+        case wasm::type::i64:
+            return 20; //-9223372036854775808
+        case wasm::type::f32:
+            return 15; //a sign, 9 digits, a point and E-38
+        case wasm::type::f64:
+            return 24; //-2.2250738585072014E-308.  Plain notation is at most 22, -0.0012345678901234567
+        default:
+            switch (type) {
+                case java::type::boolean: return 5;
+                case java::type::_char: return 1;
+                case java::type::null: return 4;
+                case java::type::String: return 0;
+                case java::type::StringBuilder: return 0;
+                default: return 11; //ints, and objects, which append their address
+            }
+    }
+}
+
+bool isStringValue(Expr& e) {
+    return e.kind != expr::StringLiteral && (e.type == java::type::String || e.type == java::type::StringBuilder);
+}
+
+//evaluate an operand of a concatenation into a local, and add what's known at compile time
+//about the characters it appends to capacity and coder.  A StringBuilder is replaced by
+//the String it's building.  Returns -1 for a literal, which isn't evaluated
+u32 emitAppendOperand(u16 operand, u32& capacity, u8& coder) {
+    Expr& o = exprs[operand];
+
+    if (o.kind == expr::StringLiteral) {
+        capacity += o.length;
+        coder |= dataStart[o.dataOffset + string::coder];
+        return -1;
+    }
+
+    if (o.kind == expr::Literal && o.type == java::type::_char) {
+        capacity += 1;
+        coder |= o.intValue > 0xFF;
+        return -1;
+    }
+
+    capacity += getMaxAppendLength(o.type);
+    u32 value = acquireScratchLocal(o.type);
+    emitExpression(operand);
+    if (o.type == java::type::StringBuilder) {
+        emitMemoryAccess(wasm::i32_load, 2, 0);
+    }
+    emitLocal(wasm::set_local, value);
+    return value;
+}
+
+//add the characters an operand appends, which are only known at runtime, to the capacity
+//on the stack.  null appends "null"
+void emitAppendLength(u16 operand, u32 value) {
+    if (isStringValue(exprs[operand])) {
+        emitLocal(wasm::get_local, value);
+        emitMemoryAccess(wasm::i32_load, 2, string::length);
+        emitConst(wasm::type::i32, 4, 0.0);
+        emitLocal(wasm::get_local, value);
+        *writePos++ = wasm::select;
+        *writePos++ = wasm::i32_add;
+    }
+}
+
+//combine the coder an operand needs, when it's only known at runtime, with the coder on the stack
+void emitAppendCoder(u16 operand, u32 value) {
+    Expr& o = exprs[operand];
+
+    if (isStringValue(o)) {
+        emitLocal(wasm::get_local, value);
+        emitMemoryAccess(wasm::i32_load8_u, 0, string::coder);
+        emitConst(wasm::type::i32, 0, 0.0);
+        emitLocal(wasm::get_local, value);
+        *writePos++ = wasm::select;
+        *writePos++ = wasm::i32_or;
+    } else if (o.type == java::type::_char && o.kind != expr::Literal) {
+        emitLocal(wasm::get_local, value);
+        emitConst(wasm::type::i32, 0xFF, 0.0);
+        *writePos++ = wasm::i32_gt_u;
+        *writePos++ = wasm::i32_or;
+    }
+}
+
+//append an operand of a concatenation to the String in the target local.  value is the
+//local emitAppendOperand() evaluated the operand into
+void emitAppend(u32 target, u16 operand, u32 value) {
+    Expr& o = exprs[operand];
+    emitLocal(wasm::get_local, target);
+
+    if (o.kind == expr::StringLiteral) {
+        emitConst(wasm::type::i32, o.dataOffset, 0.0);
+        emitLibraryCall(library::appendChars);
+        return;
+    }
+
+    if (o.kind == expr::Literal && o.type == java::type::_char) {
+        emitConst(wasm::type::i32, o.intValue, 0.0);
+        emitRuntimeCall(runtime::appendChar);
+        return;
+    }
+
+    switch (o.type) {
+        case java::type::String:
+        case java::type::StringBuilder:
+        case java::type::null:
+            emitLocal(wasm::get_local, value);
+            emitRuntimeCall(runtime::appendString);
+            break;
+        case java::type::boolean:
+            emitConst(wasm::type::i32, trueStringAddress, 0.0);
+            emitConst(wasm::type::i32, falseStringAddress, 0.0);
+            emitLocal(wasm::get_local, value);
+            *writePos++ = wasm::select;
+            emitRuntimeCall(runtime::appendString);
+            break;
+        case java::type::_char:
+            emitLocal(wasm::get_local, value);
+            emitRuntimeCall(runtime::appendChar);
+            break;
+        case wasm::type::f32:
+            emitLocal(wasm::get_local, value);
+            emitCallTo(host::appendFloat);
+            break;
+        case wasm::type::f64:
+            emitLocal(wasm::get_local, value);
+            emitCallTo(host::appendNumber);
+            break;
+        default:
+            //ints, longs, and objects, which append their address
+            emitLocal(wasm::get_local, value);
+            emitConversion(getWasmType(o.type), wasm::type::i64);
+            emitLibraryCall(library::appendLong);
+            break;
+    }
+}
+
+//the operands of a chain of string concatenations, from left to right
+const u32 MAX_CONCAT_OPERANDS = 32;
+
+u32 getConcatOperands(u16 index, u16* operands, u32 count) {
+    Expr& e = exprs[index];
+
+    //once the list is full, the rest of the chain is concatenated as one operand
+    if (e.kind == expr::Binary && e.type == java::type::String && count < MAX_CONCAT_OPERANDS - 1) {
+        count = getConcatOperands(e.lhs, operands, count);
+        return getConcatOperands(e.rhs, operands, count);
+    }
+
+    operands[count] = index;
+    return count + 1;
+}
+
+//a concatenation allocates its String once, with room for the most characters each operand
+//could append, and then appends the operands to it in turn.  Operands are all evaluated
+//first, so the lengths of the Strings among them are known
+void emitConcat(u16* operands, u32 count) {
+    u32 values[MAX_CONCAT_OPERANDS];
+    u32 capacity = 0;
+    u8 coder = 0;
+
+    for (u32 i = 0; i < count; ++i) {
+        values[i] = emitAppendOperand(operands[i], capacity, coder);
+    }
+
+    emitConst(wasm::type::i32, capacity, 0.0);
+    for (u32 i = 0; i < count; ++i) {
+        emitAppendLength(operands[i], values[i]);
+    }
+
+    emitConst(wasm::type::i32, coder, 0.0);
+    for (u32 i = 0; i < count; ++i) {
+        emitAppendCoder(operands[i], values[i]);
+    }
+
+    u32 result = acquireScratchLocal(wasm::type::i32);
+    emitRuntimeCall(runtime::stringAlloc);
+    emitLocal(wasm::set_local, result);
+
+    for (u32 i = 0; i < count; ++i) {
+        emitAppend(result, operands[i], values[i]);
+    }
+
+    emitLocal(wasm::get_local, result);
+}
+
+//copy the String on the stack into a new String with no spare room
+void emitStringCopy() {
+    u32 original = acquireScratchLocal(wasm::type::i32);
+    u32 copy = acquireScratchLocal(wasm::type::i32);
+
+    emitLocal(wasm::tee_local, original);
+    emitMemoryAccess(wasm::i32_load, 2, string::length);
+    emitLocal(wasm::get_local, original);
+    emitMemoryAccess(wasm::i32_load8_u, 0, string::coder);
+    emitRuntimeCall(runtime::stringAlloc);
+    emitLocal(wasm::tee_local, copy);
+    emitLocal(wasm::get_local, original);
+    emitLibraryCall(library::appendChars);
+    emitLocal(wasm::get_local, copy);
+}
+
+//a StringBuilder refers to the String it builds, which is replaced by a bigger one whenever
+//it runs out of room
+void emitNewStringBuilder(Expr& e) {
+    u16 arg = e.lhs;
+    u32 builder = acquireScratchLocal(wasm::type::i32);
+
+    emitConst(wasm::type::i32, 8, 0.0);
+    emitCallTo(getAllocatorFunction());
+    emitLocal(wasm::tee_local, builder);
+
+    //the default capacity is 16, and a String's builder starts out with 16 to spare
+    if (arg && exprs[arg].type != java::type::String) {
+        emitExpressionAs(arg, wasm::type::i32);
+        emitConst(wasm::type::i32, 0, 0.0);
+    } else {
+        u32 capacity = 16;
+        u8 coder = 0;
+        u32 value = arg ? emitAppendOperand(arg, capacity, coder) : -1;
+
+        emitConst(wasm::type::i32, capacity, 0.0);
+        if (arg) {
+            emitAppendLength(arg, value);
+        }
+
+        emitConst(wasm::type::i32, coder, 0.0);
+        if (arg) {
+            emitAppendCoder(arg, value);
+        }
+
+        emitRuntimeCall(runtime::stringAlloc);
+
+        if (arg) {
+            u32 buffer = acquireScratchLocal(wasm::type::i32);
+            emitLocal(wasm::tee_local, buffer);
+            emitMemoryAccess(wasm::i32_store, 2, 0);
+            emitAppend(buffer, arg, value);
+            emitLocal(wasm::get_local, builder);
+            return;
+        }
+    }
+
+    emitMemoryAccess(wasm::i32_store, 2, 0);
+    emitLocal(wasm::get_local, builder);
+}
+
+//methods of String and StringBuilder.  Returns false for any other method
+bool emitStringMethod(Expr& call) {
+    u16 object = call.lhs;
+    u16 arg = exprs[object].next;
+
+    switch (call.op) {
+        case HASH("String.valueOf"): {
+            u16 operands[] = {call.lhs};
+            emitConcat(operands, 1);
+            return true;
+        }
+
+        case HASH("String.length"):
+        case HASH("String.isEmpty"):
+            emitExpression(object);
+            emitMemoryAccess(wasm::i32_load, 2, string::length);
+            if (call.op == HASH("String.isEmpty")) {
+                *writePos++ = wasm::i32_eqz;
+            }
+            return true;
+
+        case HASH("String.charAt"):
+            emitExpression(object);
+            emitExpressionAs(arg, wasm::type::i32);
+            emitRuntimeCall(runtime::charAt);
+            return true;
+
+        case HASH("String.hashCode"):
+            emitExpression(object);
+            emitLibraryCall(library::hashCode);
+            return true;
+
+        case HASH("String.equals"):
+            emitExpression(object);
+            emitExpression(arg);
+            emitLibraryCall(library::equals);
+            return true;
+
+        case HASH("StringBuilder.length"):
+            emitExpression(object);
+            emitMemoryAccess(wasm::i32_load, 2, 0);
+            emitMemoryAccess(wasm::i32_load, 2, string::length);
+            return true;
+
+        case HASH("StringBuilder.charAt"):
+            emitExpression(object);
+            emitMemoryAccess(wasm::i32_load, 2, 0);
+            emitExpressionAs(arg, wasm::type::i32);
+            emitRuntimeCall(runtime::charAt);
+            return true;
+
+        case HASH("StringBuilder.toString"):
+            emitExpression(object);
+            emitMemoryAccess(wasm::i32_load, 2, 0);
+            emitStringCopy();
+            return true;
+
+        case HASH("StringBuilder.append"): {
+            //make room for the most the argument could append, then append it in place
+            u32 builder = acquireScratchLocal(wasm::type::i32);
+            u32 buffer = acquireScratchLocal(wasm::type::i32);
+            u32 capacity = 0;
+            u8 coder = 0;
+
+            emitExpression(object);
+            emitLocal(wasm::set_local, builder);
+            u32 value = emitAppendOperand(arg, capacity, coder);
+
+            emitLocal(wasm::get_local, builder);
+            emitConst(wasm::type::i32, capacity, 0.0);
+            emitAppendLength(arg, value);
+            emitConst(wasm::type::i32, coder, 0.0);
+            emitAppendCoder(arg, value);
+            emitRuntimeCall(runtime::reserve);
+            emitLocal(wasm::set_local, buffer);
+
+            emitAppend(buffer, arg, value);
+            emitLocal(wasm::get_local, builder);
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+//the remainder of floats or doubles, which has the sign of the dividend and is NaN when the
+//dividend is infinite or the divisor is 0, like C's fmod and JavaScript's %.  Floats are
+//promoted for the host's fmod, and its result fits back in a float exactly
+void emitRemainder(Expr& e) {
+    emitExpressionAs(e.lhs, e.operandType);
+    emitConversion(e.operandType, wasm::type::f64);
+    emitExpressionAs(e.rhs, e.operandType);
+    emitConversion(e.operandType, wasm::type::f64);
+    emitCallTo(host::fmod);
+    emitConversion(wasm::type::f64, e.operandType);
+}
+
+void emitExpression(u16 index) {
+    Expr& e = exprs[index];
+
+    switch (e.kind) {
+        case expr::Literal:
+            emitConst(e.type, e.intValue, e.type == wasm::type::f32 ? e.f32Value : e.f64Value);
+            break;
+
+        case expr::StringLiteral:
+            *writePos++ = wasm::i32_const;
+            writePos = insertVarint(writePos, e.dataOffset);
+            break;
+
+        case expr::Variable:
+            emitGetVar(e.varIndex);
+            break;
+
+        case expr::Unary:
+            if (e.op == HASH("!")) {
+                emitConditionValue(e.lhs, true);
+            } else if (e.op == HASH("~")) {
+                emitExpressionAs(e.lhs, e.type);
+                emitConst(e.type, -1, 0.0);
+                *writePos++ = getBinaryOpcode(HASH("^"), e.type);
+            } else if (e.type == wasm::type::f32 || e.type == wasm::type::f64) {
+                emitExpressionAs(e.lhs, e.type);
+                *writePos++ = e.type == wasm::type::f32 ? wasm::f32_neg : wasm::f64_neg;
+            } else {
+                emitConst(e.type, 0, 0.0);
+                emitExpressionAs(e.lhs, e.type);
+                *writePos++ = getBinaryOpcode(HASH("-"), e.type);
+            }
+            break;
+
+        case expr::Binary:
+            if (e.type == java::type::String) {
+                u16 operands[MAX_CONCAT_OPERANDS];
+                emitConcat(operands, getConcatOperands(index, operands, 0));
+                break;
+            }
+
+            //the right operand of && and || is only evaluated when the left doesn't decide
+            if (e.op == HASH("&&") || e.op == HASH("||")) {
+                emitConditionValue(e.lhs, false);
+                *writePos++ = wasm::_if;
+                *writePos++ = wasm::type::i32;
+                if (e.op == HASH("&&")) {
+                    emitConditionValue(e.rhs, false);
+                    *writePos++ = wasm::_else;
+                    emitConst(wasm::type::i32, 0, 0.0);
+                } else {
+                    emitConst(wasm::type::i32, 1, 0.0);
+                    *writePos++ = wasm::_else;
+                    emitConditionValue(e.rhs, false);
+                }
+                *writePos++ = wasm::end;
+                break;
+            }
+
+            if (e.op == HASH("%") && getWasmType(e.operandType) <= wasm::type::f32) {
+                emitRemainder(e);
+                break;
+            }
+
+            emitExpressionAs(e.lhs, e.operandType);
+            emitExpressionAs(e.rhs, e.operandType);
+            *writePos++ = getBinaryOpcode(e.op, e.operandType);
+            break;
+
+        case expr::Cast:
+            emitExpressionAs(e.lhs, e.type);
+            break;
+
+        case expr::Call:
+            emitCall(e);
+            break;
+
+        case expr::FieldAccess:
+            emitExpression(e.lhs);
+            emitFieldAccess(e.fieldIndex, false);
+            break;
+
+        case expr::MethodCall:
+            emitMethodCall(e.methodIndex, e.lhs, e.op != HASH("super"));
+            break;
+
+        case expr::New:
+            if (e.type == java::type::StringBuilder) {
+                emitNewStringBuilder(e);
+            } else {
+                emitNew(e, false);
+            }
+            break;
+
+        //the error expression, which the parser leaves for a missing operand.  Names and calls it
+        //couldn't resolve were reported where they were parsed
+        default:
+            REPORT_ERROR("illegal start of expression");
+            *writePos++ = wasm::unreachable;
+            break;
+    }
+}
+
+//the comparison that's true when op is false.  0 for floating point comparisons, which are
+//all false when an operand is NaN
+u32 getInvertedComparison(u32 op, u8 operandType) {
+    if (getWasmType(operandType) != wasm::type::i32 && getWasmType(operandType) != wasm::type::i64) {
+        return 0;
+    }
+
+    switch (op) {
+        case HASH("=="): return HASH("!=");
+        case HASH("!="): return HASH("==");
+        case HASH("<"): return HASH(">=");
+        case HASH(">"): return HASH("<=");
+        case HASH("<="): return HASH(">");
+        case HASH(">="): return HASH("<");
+        default: return 0;
+    }
+}
+
+//emit a boolean as 0 or 1, or as 1 or 0 when isInverted.  Integer comparisons are inverted
+//by using the opposite comparison, and comparisons with 0 use eqz
+void emitConditionValue(u16 index, bool isInverted) {
+    Expr& e = exprs[index];
+
+    if (e.kind == expr::Unary && e.op == HASH("!")) {
+        emitConditionValue(e.lhs, !isInverted);
+        return;
+    }
+
+    u32 precedence = e.kind == expr::Binary ? getBinaryPrecedence(e.op) : 0;
+    u32 op = precedence == 6 || precedence == 7 ? e.op : 0;
+    if (op && isInverted) {
+        op = getInvertedComparison(op, e.operandType);
+    }
+
+    if (op == 0) {
+        emitExpressionAs(index, java::type::boolean);
+        if (isInverted) {
+            *writePos++ = wasm::i32_eqz;
+        }
+        return;
+    }
+
+    Expr& rhs = exprs[e.rhs];
+    if (getWasmType(e.operandType) == wasm::type::i32 && rhs.kind == expr::Literal && rhs.intValue == 0 &&
+            (op == HASH("==") || op == HASH("!="))) {
+        emitExpressionAs(e.lhs, e.operandType);
+        if (op == HASH("==")) {
+            *writePos++ = wasm::i32_eqz;
+        }
+        return;
+    }
+
+    emitExpressionAs(e.lhs, e.operandType);
+    emitExpressionAs(e.rhs, e.operandType);
+    *writePos++ = getBinaryOpcode(op, e.operandType);
+}
+
+bool isShortCircuit(u16 index) {
+    Expr& e = exprs[index];
+    if (e.kind == expr::Unary && e.op == HASH("!")) {
+        return isShortCircuit(e.lhs);
+    }
+    return e.kind == expr::Binary && (e.op == HASH("&&") || e.op == HASH("||"));
+}
+
+//branch depth levels out when a boolean is isTrue, and fall through otherwise.  && and ||
+//branch as soon as an operand decides their result, without computing it
+void emitBranchIf(u16 index, bool isTrue, u32 depth) {
+    Expr& e = exprs[index];
+
+    if (e.kind == expr::Unary && e.op == HASH("!")) {
+        emitBranchIf(e.lhs, !isTrue, depth);
+        return;
+    }
+
+    if (e.kind == expr::Binary && (e.op == HASH("&&") || e.op == HASH("||"))) {
+        if ((e.op == HASH("&&")) != isTrue) {
+            //a false operand of && decides it's false, and a true operand of || decides it's true
+            emitBranchIf(e.lhs, isTrue, depth);
+            emitBranchIf(e.rhs, isTrue, depth);
+        } else {
+            //the right operand decides once the left operand doesn't
+            *writePos++ = wasm::block;
+            *writePos++ = wasm::type::_void;
+            emitBranchIf(e.lhs, !isTrue, 0);
+            emitBranchIf(e.rhs, isTrue, depth + 1);
+            *writePos++ = wasm::end;
+        }
+        return;
+    }
+
+    emitConditionValue(index, !isTrue);
+    *writePos++ = wasm::br_if;
+    writePos = insertVaruint(writePos, depth);
+}
+
+//print each operand of a string concatenation in turn rather than building the string
+void emitPrint(u16 index) {
+    Expr& e = exprs[index];
+
+    if (e.kind == expr::Binary && e.type == java::type::String) {
+        emitPrint(e.lhs);
+        emitPrint(e.rhs);
+        return;
+    }
+
+    //ASCII literals are valid UTF-8, so their characters can be printed as they are
+    if (e.kind == expr::StringLiteral) {
+        u8* str = dataStart + e.dataOffset;
+        bool isASCII = str[string::coder] == 0;
+        for (u32 i = 0; i < e.length; ++i) {
+            isASCII &= str[string::chars + i] < 0x80;
+        }
+
+        if (e.length == 0) {
+            return;
+        } else if (isASCII) {
+            emitConst(wasm::type::i32, e.dataOffset + string::chars, 0.0);
+            emitConst(wasm::type::i32, e.length, 0.0);
+            emitCallTo(host::puts);
+        } else {
+            emitConst(wasm::type::i32, e.dataOffset, 0.0);
+            emitCallTo(host::putString);
+        }
+        return;
+    }
+
+    if (e.type == java::type::String || e.type == java::type::StringBuilder) {
+        emitExpression(index);
+        if (e.type == java::type::StringBuilder) {
+            emitMemoryAccess(wasm::i32_load, 2, 0);
+        }
+        emitCallTo(host::putString);
+        return;
+    }
+
+    u8 printType = e.type;
+    u8 printFunc;
+
+    switch (e.type) {
+        case java::type::boolean:
+            printFunc = host::putbool;
+            break;
+        case java::type::_char:
+            printFunc = host::put;
+            break;
+        case wasm::type::i32:
+        case java::type::null:
+            printFunc = host::puti32;
+            break;
+        case wasm::type::i64:
+            printFunc = host::puti64;
+            break;
+        case wasm::type::f32:
+            printFunc = host::putf32;
+            break;
+        case wasm::type::f64:
+            printFunc = host::putf64;
+            break;
+        default:
+            //objects print their address
+            printType = wasm::type::i32;
+            printFunc = host::puti32;
+            break;
+    }
+
+    emitExpressionAs(index, printType);
+    emitCallTo(printFunc);
+}
+
+//compile a method into the code section
+void compileAndInsertFunction(u32 methodIndex);
+
+//the allocator behind new.  It's appended to the code section after the methods
+void insertAllocator();
+
+//the functions behind String and StringBuilder.  They're appended after the allocator
+void insertStringRuntime();
+
+//copy the precompiled library into the code section
+void insertLibrary();
+
+//custom sections of debug info, appended after the data section
+void insertNameSection();
+void insertLineTable();
+
+//the size report of the module at module, written after it
+void insertSizeReport(u8* module);
+
+//where a method's name is in the source
+const char* findMethodName(Method& m);
+
+//tok must be the first token of a statement
+void compileStatement();
+
+//tok must be the '{' that opens the block.  tok is left after the matching '}'
+void compileBlock();
+
+void compileStaticInitializers();
+
+//static field initializers and static blocks.  They run in source order in <clinit>, which main
+//calls first.  A benchmark of another method calls it through the initialize export
+const u32 MAX_STATIC_INITIALIZERS = 64;
+char* staticInitializerPos[MAX_STATIC_INITIALIZERS];
+u32 staticInitializerVar[MAX_STATIC_INITIALIZERS]; //-1 for static blocks
+u8 staticInitializerClass[MAX_STATIC_INITIALIZERS];
+u32 staticInitializerCount = 0;
+
+//instance initializer blocks, in the order they're declared.  Constructors run them along
+//with the field initializers of their class
+const u32 MAX_INSTANCE_INITIALIZERS = 64;
+char* instanceInitializerPos[MAX_INSTANCE_INITIALIZERS];
+u8 instanceInitializerClass[MAX_INSTANCE_INITIALIZERS];
+u32 instanceInitializerCount = 0;
+
+bool hasInstanceInitializer(u32 classIndex) {
+    for (u32 i = 0; i < instanceInitializerCount; ++i) {
+        if (instanceInitializerClass[i] == classIndex) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//initial values of the globals, which are all constants
+Expr globalInitialValues[MAX_VARS];
+
+//how far an object can be seen from outside of the scope of the local that refers to it
+struct escape {
+    enum {
+        None,   //only its fields are used
+        Callee, //it's also passed to methods that only use its fields
+        Global, //anything else
+    };
+};
+
+//limits how deeply methods are analyzed and constructors inlined into each other
+const u32 MAX_ANALYSIS_DEPTH = 4;
+u32 inlineDepth = 0;
+
+//names of the parameters of the method being compiled or inlined
+u32 parameterNames[256];
+char* parameterNamePos[256];
+
+//tok must be the opening brace.  tok is left after the matching closing brace
+void skipBlock() {
+    u32 depth = 0;
+    do {
+        if (isSymbol('{')) {
+            ++depth;
+        } else if (isSymbol('}')) {
+            --depth;
+        }
+        nextToken();
+    } while (tok.kind != token::End && depth > 0);
+}
+
+//skip from a '(' past its ')'
+void skipParenthesis() {
+    u32 depth = 0;
+    do {
+        if (isSymbol('(')) {
+            ++depth;
+        } else if (isSymbol(')')) {
+            --depth;
+        }
+        nextToken();
+    } while (tok.kind != token::End && depth > 0);
+}
+
+//skip the statement tok starts
+void skipStatement() {
+    if (isSymbol('{')) {
+        skipBlock();
+        return;
+    }
+
+    if (tok.kind == token::Identifier) {
+        switch (tok.hash) {
+            case HASH("if"):
+                nextToken();
+                skipParenthesis();
+                skipStatement();
+                if (tok.kind == token::Identifier && tok.hash == HASH("else")) {
+                    nextToken();
+                    skipStatement();
+                }
+                return;
+            case HASH("while"):
+            case HASH("for"):
+            case HASH("switch"):
+                nextToken();
+                skipParenthesis();
+                skipStatement();
+                return;
+            case HASH("do"):
+                nextToken();
+                skipStatement();
+                nextToken(); //while
+                skipParenthesis();
+                break;
+        }
+    }
+
+    //anything else ends with a ';' outside of any parenthesis or braces
+    u32 depth = 0;
+    while (tok.kind != token::End && (depth > 0 || !isSymbol(';'))) {
+        if (isSymbol('(') || isSymbol('[') || isSymbol('{')) {
+            ++depth;
+        } else if (isSymbol(')') || isSymbol(']') || isSymbol('}')) {
+            --depth;
+        }
+        nextToken();
+    }
+    nextToken();
+}
+
+//skip a field initializer.  tok is left on the ',' or ';' that ends it
+void skipInitializer() {
+    u32 depth = 0;
+    while (tok.kind != token::End && (depth > 0 || (!isSymbol(',') && !isSymbol(';')))) {
+        if (isSymbol('(') || isSymbol('[') || isSymbol('{')) {
+            ++depth;
+        } else if (isSymbol(')') || isSymbol(']') || isSymbol('}')) {
+            --depth;
+        }
+        nextToken();
+    }
+}
+
+//scan one declarator of a static field.  tok must be the field's name
+void scanStaticField(u8 type, bool isFinal) {
+    u32 hash = getMemberHash(currentClass, tok.start, tok.length);
+    nextToken();
+
+    exprCount = 1;
+    u16 initializer = 0;
+    char* initializerPos = 0;
+
+    if (isSymbol('=')) {
+        nextToken();
+        initializerPos = tok.start;
+        reportsUnknownNames = false;
+        initializer = parseExpression();
+        reportsUnknownNames = true;
+        skipInitializer();
+    }
+
+    Expr value = exprs[initializer];
+    bool isConstant = initializer && value.kind == expr::Literal;
+    if (isConstant) {
+        foldConversion(value, type);
+    }
+
+    //final primitives with constant values are substituted into the code that uses them
+    if (isFinal && isConstant && constantCount < MAX_CONSTANTS) {
+        constantHashes[constantCount] = hash;
+        constantValues[constantCount] = value;
+        ++constantCount;
+        return;
+    }
+
+    if (globalVarCount == MAX_VARS) {
+        REPORT_ERROR("too many static fields");
+        return;
+    }
+
+    u32 varIndex = globalVarCount++;
+    varHashes[varIndex] = hash;
+    varTypes[varIndex] = type;
+    totalVarCount = globalVarCount;
+
+    //constant initializers become the global's initial value.  Any other initializer
+    //runs in <clinit>, and the global starts out as zero
+    if (!isConstant) {
+        value.intValue = 0;
+        value.f64Value = 0.0;
+        value.type = type;
+    }
+    globalInitialValues[varIndex] = value;
+
+    if (initializer && !isConstant) {
+        if (staticInitializerCount == MAX_STATIC_INITIALIZERS) {
+            REPORT_ERROR("too many static initializers");
+            return;
+        }
+
+        staticInitializerPos[staticInitializerCount] = initializerPos;
+        staticInitializerVar[staticInitializerCount] = varIndex;
+        staticInitializerClass[staticInitializerCount] = currentClass;
+        ++staticInitializerCount;
+    }
+}
+
+//scan one declarator of an instance field.  tok must be the field's name
+void scanInstanceField(u8 type) {
+    if (fieldCount == MAX_FIELDS) {
+        REPORT_ERROR("too many fields");
+        return;
+    }
+
+    Field& f = fields[fieldCount++];
+    ++classes[currentClass].fieldCount;
+    f.hash = tok.hash;
+    f.type = type;
+    f.initializer = 0;
+    nextToken();
+
+    //the initializer is compiled into every constructor
+    if (isSymbol('=')) {
+        nextToken();
+        f.initializer = tok.start;
+        skipInitializer();
+    }
+}
+
+//whether another method fits.  The last one is kept for the empty main of a program without
+//one, so a program with more fails to compile
+bool hasRoomForMethod() {
+    if (methodCount < MAX_METHODS - 1) {
+        return true;
+    }
+
+    REPORT_ERROR("too many methods");
+    return false;
+}
+
+//record a method and the types of its parameters.  tok must be the '(' of its parameter
+//list.  tok is left after its body
+void scanMethod(u32 hash, u8 returnType, bool isStatic) {
+    if (!hasRoomForMethod()) {
+        return;
+    }
+
+    Method& m = methods[methodCount];
+    m.parameterList = tok.start;
+    m.hash = hash;
+    m.firstParam = paramTypeCount;
+    m.paramCount = 0;
+    m.returnType = returnType;
+    m.classIndex = currentClass;
+    m.isStatic = isStatic;
+    nextToken();
+
+    while (tok.kind == token::Identifier) {
+        while (tok.keyword == keyword::Modifier) {
+            nextToken();
+        }
+
+        u8 type = getTypeFromName(tok.hash);
+        nextToken();
+
+        //arrays, varargs and library objects are all passed by reference
+        while (isSymbol('[') || isSymbol(']') || isSymbol('.')) {
+            type = wasm::type::i32;
+            nextToken();
+        }
+        if (type == wasm::type::_void) {
+            type = wasm::type::i32;
+        }
+
+        if (paramTypeCount < MAX_PARAMS) {
+            paramTypes[paramTypeCount++] = type;
+            ++m.paramCount;
+        }
+
+        nextToken(); //the parameter's name
+        if (isSymbol(',')) {
+            nextToken();
+        }
+    }
+
+    //the host calls main without any arguments
+    if (hash == HASH("main") && isStatic) {
+        mainMethod = methodCount;
+        m.paramCount = 0;
+    }
+
+    ++methodCount;
+
+    //skip the body, or the ';' of an abstract method
+    while (tok.kind != token::End && !isSymbol('{') && !isSymbol(';')) {
+        nextToken();
+    }
+
+    if (isSymbol('{')) {
+        skipBlock();
+    } else {
+        nextToken();
+    }
+}
+
+//place the fields of a class from the widest to the narrowest, after the ones it inherits.
+//Every field is aligned to its size, which only takes padding after a header or inherited fields
+void layOutFields(u32 classIndex, u32 offset) {
+    Class& c = classes[classIndex];
+
+    for (u32 size = 8; size > 0; size >>= 1) {
+        for (u32 i = c.firstField; i < c.firstField + c.fieldCount; ++i) {
+            if (getTypeSize(fields[i].type) == size) {
+                offset = (offset + size - 1) & ~(size - 1);
+                fields[i].offset = offset;
+                offset += size;
+            }
+        }
+    }
+
+    c.size = offset;
+}
+
+//lay out a class after its superclass, and give the instance methods it declares the slots
+//after the ones it inherits.  A method that overrides another takes its slot
+void completeClass(u32 classIndex) {
+    Class& c = classes[classIndex];
+    if (c.isComplete) {
+        return;
+    }
+    c.isComplete = true;
+
+    u32 offset = c.hasHeader ? 4 : 0;
+    u32 slotCount = 0;
+    if (c.superclass != -1) {
+        Class& superclass = classes[c.superclass];
+        completeClass(c.superclass);
+        c.hasHeader = superclass.hasHeader;
+        offset = superclass.size;
+        slotCount = superclass.slotCount;
+    }
+
+    layOutFields(classIndex, offset);
+
+    bool hasConstructor = false;
+    for (u32 i = 0; i < methodCount; ++i) {
+        Method& m = methods[i];
+        if (m.classIndex != classIndex || m.isStatic) {
+            continue;
+        }
+
+        if (m.hash == HASH("<init>")) {
+            hasConstructor = true;
+        } else {
+            u32 overridden = c.superclass != -1 ? findMethod(c.superclass, m.hash, m.paramCount) : -1;
+            m.slot = overridden != -1 ? methods[overridden].slot : slotCount++;
+        }
+    }
+    c.slotCount = slotCount;
+
+    //a class without a constructor still runs its superclass's one without parameters
+    if (!hasConstructor && c.superclass != -1 && findMethod(c.superclass, HASH("<init>"), 0) != -1 && hasRoomForMethod()) {
+        methods[methodCount++] = Method{0, HASH("<init>"), (u16)paramTypeCount, 0, wasm::type::_void, (u8)classIndex, 0, false};
+    }
+}
+
+//once every method is known, find the calls that may run more than one of them.  The objects
+//of the class hierarchies they're made in start with a header, which holds the start of their
+//class's vtable.  Classes outside of them keep the layout they'd have without inheritance
+void layOutClasses() {
+    for (u32 i = 0; i < methodCount; ++i) {
+        Method& m = methods[i];
+        u32 targets[MAX_CALL_TARGETS];
+
+        if (!m.isStatic && m.hash != HASH("<init>") && findCallTargets(m.classIndex, i, targets) > 1) {
+            u32 root = m.classIndex;
+            while (classes[root].superclass != -1) {
+                root = classes[root].superclass;
+            }
+            classes[root].hasHeader = true;
+        }
+    }
+
+    for (u32 i = 0; i < classCount; ++i) {
+        completeClass(i);
+    }
+
+    //each slot of a vtable holds the method the class declares for it, or else the one it
+    //inherits from the nearest superclass
+    tableEntryCount = 0;
+    for (u32 i = 0; i < classCount; ++i) {
+        Class& c = classes[i];
+        if (!c.isInstantiated || !c.hasHeader) {
+            continue;
+        }
+
+        c.vtableStart = tableEntryCount;
+        for (u32 slot = 0; slot < c.slotCount; ++slot) {
+            tableEntries[tableEntryCount + slot] = -1;
+        }
+
+        for (u32 k = i; k != -1; k = classes[k].superclass) {
+            for (u32 j = 0; j < methodCount; ++j) {
+                Method& m = methods[j];
+                if (m.classIndex == k && !m.isStatic && m.hash != HASH("<init>") && tableEntries[tableEntryCount + m.slot] == (u8)-1) {
+                    tableEntries[tableEntryCount + m.slot] = j;
+                }
+            }
+        }
+
+        tableEntryCount += c.slotCount;
+    }
+}
+
+//find every top level class up front, so that code can refer to classes declared after it.
+//tok must be the first token of the source
+void scanClassNames() {
+    u32 nameHash = 0;
+    char* namePos = 0;
+    u32 superclassHash = 0;
+    bool isNameKnown = false;
+    bool isAfterKeyword = false;
+    bool isAfterExtends = false;
+
+    while (tok.kind != token::End) {
+        if (isSymbol('{')) {
+            if (classCount == MAX_CLASSES) {
+                REPORT_ERROR("too many classes");
+                break;
+            }
+
+            Class& c = classes[classCount++];
+            c.hash = nameHash;
+            c.name = namePos;
+            c.size = 0;
+            c.superclass = superclassHash;
+            c.firstField = 0;
+            c.fieldCount = 0;
+            c.vtableStart = 0;
+            c.slotCount = 0;
+            c.hasHeader = false;
+            c.isInstantiated = instantiatedHashCount > MAX_INSTANTIATED_NAMES;
+            c.isComplete = false;
+
+            for (u32 i = 0; i < instantiatedHashCount && i < MAX_INSTANTIATED_NAMES; ++i) {
+                c.isInstantiated |= instantiatedHashes[i] == nameHash;
+            }
+
+            skipBlock();
+            superclassHash = 0;
+            isNameKnown = false;
+            continue;
+        }
+
+        //the name follows the class keyword.  Failing that, it's the last identifier before
+        //the class body
+        if (tok.kind == token::Identifier && !isNameKnown) {
+            nameHash = tok.hash;
+            namePos = tok.start;
+            isNameKnown = isAfterKeyword;
+        }
+
+        if (tok.kind == token::Identifier && isAfterExtends) {
+            superclassHash = tok.hash;
+        }
+
+        isAfterKeyword = tok.keyword == keyword::TypeDeclaration;
+        isAfterExtends = tok.kind == token::Identifier && tok.hash == HASH("extends");
+        nextToken();
+    }
+
+    //superclasses may be declared after the classes extending them.  A class can't extend
+    //itself, even through others
+    for (u32 i = 0; i < classCount; ++i) {
+        classes[i].superclass = classes[i].superclass ? findClass(classes[i].superclass) : -1;
+    }
+
+    for (u32 i = 0; i < classCount; ++i) {
+        u32 superclass = classes[i].superclass;
+        for (u32 depth = 0; superclass != -1 && depth < classCount; ++depth) {
+            superclass = classes[superclass].superclass;
+        }
+
+        if (superclass != -1) {
+            classes[i].superclass = -1;
+        }
+    }
+}
+
+//scan every class for its fields and methods, and for the static initializers that run in
+//<clinit>.  tok must be the first token of the source
+void scanProgram() {
+    totalVarCount = globalVarCount;
+    inStaticContext = true;
+
+    for (u32 classIndex = 0; classIndex < classCount; ++classIndex) {
+        while (tok.kind != token::End && !isSymbol('{')) {
+            nextToken();
+        }
+        nextToken();
+
+        currentClass = classIndex;
+        Class& c = classes[classIndex];
+        c.firstField = fieldCount;
+        bool hasConstructor = false;
+        bool hasFieldInitializer = false;
+
+        while (tok.kind != token::End && !isSymbol('}')) {
+            bool isStatic = false;
+            bool isFinal = false;
+            while (tok.keyword == keyword::Modifier) {
+                isStatic |= tok.hash == HASH("static");
+                isFinal |= tok.hash == HASH("final");
+                nextToken();
+            }
+
+            if (isSymbol('{')) {
+                if (isStatic) {
+                    if (staticInitializerCount == MAX_STATIC_INITIALIZERS) {
+                        REPORT_ERROR("too many static initializers");
+                        break;
+                    }
+
+                    staticInitializerPos[staticInitializerCount] = tok.start;
+                    staticInitializerVar[staticInitializerCount] = -1;
+                    staticInitializerClass[staticInitializerCount] = classIndex;
+                    ++staticInitializerCount;
+                } else {
+                    if (instanceInitializerCount == MAX_INSTANCE_INITIALIZERS) {
+                        REPORT_ERROR("too many instance initializers");
+                        break;
+                    }
+
+                    instanceInitializerPos[instanceInitializerCount] = tok.start;
+                    instanceInitializerClass[instanceInitializerCount] = classIndex;
+                    ++instanceInitializerCount;
+                    hasFieldInitializer = true;
+                }
+
+                skipBlock();
+                continue;
+            }
+
+            if (tok.kind != token::Identifier) {
+                nextToken();
+                continue;
+            }
+
+            if (tok.keyword == keyword::TypeDeclaration) {
+                REPORT_ERROR("unsupported nested class");
+                break;
+            }
+
+            u32 typeHash = tok.hash;
+            u8 type = getTypeFromName(typeHash);
+            nextToken();
+            while (isSymbol('[') || isSymbol(']')) {
+                type = wasm::type::i32;
+                nextToken();
+            }
+
+            //constructors have no type in front of their name
+            if (typeHash == c.hash && isSymbol('(')) {
+                hasConstructor = true;
+                scanMethod(HASH("<init>"), wasm::type::_void, false);
+                continue;
+            }
+
+            char* nameStart = tok.start;
+            u32 nameHash = tok.hash;
+            nextToken();
+
+            if (isSymbol('(')) {
+                scanMethod(nameHash, type, isStatic);
+                continue;
+            }
+
+            //every declarator of a field declaration shares its type
+            rewindTo(nameStart);
+            while (tok.kind == token::Identifier) {
+                if (type == wasm::type::_void) {
+                    //the host provides the Scanner, as it does for locals.  Other library
+                    //types have no representation
+                    if (typeHash != HASH("Scanner")) {
+                        REPORT_ERROR("unsupported field type");
+                        break;
+                    }
+                    nextToken();
+                    skipInitializer();
+                } else if (isStatic) {
+                    scanStaticField(type, isFinal);
+                } else {
+                    scanInstanceField(type);
+                    hasFieldInitializer |= fields[fieldCount - 1].initializer != 0;
+                }
+
+                if (!isSymbol(',')) {
+                    break;
+                }
+                nextToken();
+            }
+
+            nextToken();
+        }
+
+        nextToken();
+
+        //field initializers and instance initializers need a constructor to run in
+        if (hasFieldInitializer && !hasConstructor && hasRoomForMethod()) {
+            methods[methodCount++] = Method{0, HASH("<init>"), (u16)paramTypeCount, 0, wasm::type::_void, (u8)classIndex, 0, false};
+        }
+    }
+
+    if (staticInitializerCount > 0 && hasRoomForMethod()) {
+        staticInitializerMethod = methodCount++;
+        methods[staticInitializerMethod] = Method{0, HASH("<clinit>"), (u16)paramTypeCount, 0, wasm::type::_void, 0, 0, true};
+    }
+
+    layOutClasses();
+
+    //a program without main still exports an empty one
+    if (mainMethod == -1) {
+        mainMethod = methodCount++;
+        methods[mainMethod] = Method{0, HASH("main"), (u16)paramTypeCount, 0, wasm::type::_void, 0, 0, true};
+    }
+}
+
+//Strings in the data section are aligned for their header.  Address 0 is null, so nothing
+//is placed there
+void alignData() {
+    while (writePos == dataStart || ((writePos - dataStart) & 3)) {
+        *writePos++ = 0;
+    }
+}
+
+//finish the String at writePos, whose characters have already been decoded after its header
+//as UTF-16.  Equal Strings are only placed once.  Returns its address
+u32 placeString(u32 length) {
+    u8* str = writePos;
+    u8* chars = str + string::chars;
+    u32 coder = 0;
+    u32 hash = 0;
+
+    for (u32 i = 0; i < length; ++i) {
+        u32 c = chars[2 * i] | chars[2 * i + 1] << 8;
+        coder |= c > 0xFF;
+        hash = 31 * hash + c;
+    }
+
+    //Latin-1 takes one byte per character
+    if (!coder) {
+        for (u32 i = 0; i < length; ++i) {
+            chars[i] = chars[2 * i];
+        }
+    }
+
+    storeU32(str + string::length, length);
+    storeU32(str + string::hash, hash);
+    storeU32(str + string::capacity, length);
+    storeU32(str + string::coder, coder);
+    writePos = chars + (length << coder);
+
+    for (u32 i = 0; i < stringLiteralCount; ++i) {
+        u8* other = dataStart + stringLiteralDataOffset[i];
+        u32 j = 0;
+        while (j < writePos - str && other[j] == str[j]) {
+            ++j;
+        }
+
+        if (j == writePos - str) {
+            writePos = str;
+            return other - dataStart;
+        }
+    }
+
+    return str - dataStart;
+}
+
+u32 placeStringConstant(const char* text) {
+    alignData();
+    u32 length = 0;
+    for (; text[length]; ++length) {
+        writePos[string::chars + 2 * length] = text[length];
+        writePos[string::chars + 2 * length + 1] = 0;
+    }
+
+    return placeString(length);
+}
+
+//a literal that can be appended to a string literal at compile time.  Returns the characters it
+//appended to dest, or -1 if it can't be
+u32 decodeFoldableLiteral(u8* dest) {
+    if (tok.kind == token::StringLiteral || tok.kind == token::CharLiteral) {
+        return decodeStringLiteral(tok.start + 1, tok.length - 2, dest);
+    }
+
+    //decimal ints print as they're written, as long as they don't begin with an octal 0
+    if (tok.kind != token::NumericLiteral || tok.length > 10 || (tok.length > 1 && tok.start[0] == '0')) {
+        return -1;
+    }
+
+    u64 value = 0;
+    for (u32 i = 0; i < tok.length; ++i) {
+        if (!isdigit(tok.start[i])) {
+            return -1;
+        }
+
+        value = value * 10 + tok.start[i] - '0';
+        dest[2 * i] = tok.start[i];
+        dest[2 * i + 1] = 0;
+    }
+
+    return value <= 0x7FFFFFFF ? tok.length : -1;
+}
+
+//place a string literal in the data section, along with the literals concatenated onto it,
+//e.g. "a" + 'b' + 1 is placed as "ab1".  Once one operand of + is a String, + is
+//associative, so only what binds tighter than + stops the folding.  tok must be the
+//literal, and is left on the last literal folded into it
+void scanStringLiteral() {
+    alignData();
+    char* literalPos = tok.start;
+    u8* chars = writePos + string::chars;
+    u32 length = decodeStringLiteral(tok.start + 1, tok.length - 2, chars);
+
+    while (true) {
+        char* resumePos = readPos;
+        Token resumeTok = tok;
+
+        nextToken();
+        u32 appended = -1;
+        if (isSymbol('+')) {
+            nextToken();
+            appended = decodeFoldableLiteral(chars + 2 * length);
+        }
+
+        Token operand = tok;
+        char* operandEnd = readPos;
+        nextToken();
+
+        bool bindsTighter = tok.kind == token::Symbol && (getBinaryPrecedence(tok.hash) > 9 || isSymbol('.') || isSymbol('['));
+        if (appended == -1 || bindsTighter) {
+            readPos = resumePos;
+            tok = resumeTok;
+            break;
+        }
+
+        length += appended;
+        readPos = operandEnd;
+        tok = operand;
+    }
+
+    stringLiteralSourcePos[stringLiteralCount] = literalPos;
+    stringLiteralEndPos[stringLiteralCount] = readPos;
+    stringLiteralDataOffset[stringLiteralCount] = placeString(length);
+    ++stringLiteralCount;
+}
+
+//the id of the function a call site refers to
+u32 getCalledFunction(u32 callSite) {
+    u8* id = codeStart + callSiteOffsets[callSite];
+    return (id[0] & 0x7F) | id[1] << 7;
+}
+
+//number the functions main reaches, imports first.  The code of each defined function starts
+//with its size, and the calls it makes are the call sites within it
+void findUsedFunctions() {
+    u32 definedCount = getDefinedFunctionCount();
+
+    u8* body = codeStart;
+    u32 callSite = 0;
+    for (u32 i = 0; i < definedCount; ++i) {
+        functionBodies[i] = body;
+        functionCallSites[i] = callSite;
+
+        body += SIZE_LENGTH + readSize(body);
+        while (callSite < callSiteCount && codeStart + callSiteOffsets[callSite] < body) {
+            ++callSite;
+        }
+    }
+    functionBodies[definedCount] = body;
+    functionCallSites[definedCount] = callSiteCount;
+
+    for (u32 i = 0; i < FIRST_DEFINED_FUNCTION + definedCount; ++i) {
+        functionIndices[i] = -1;
+    }
+
+    //functions are marked with index 0 when they're reached, and the defined ones are queued
+    //to have their calls followed
+    u32 queue[MAX_DEFINED_FUNCTIONS];
+    u32 queueLength = 0;
+    if (mainMethod != -1) {
+        functionIndices[getMethodFunction(mainMethod)] = 0;
+        queue[queueLength++] = mainMethod;
+    }
+
+    for (u32 i = 0; i < methodCount; ++i) {
+        if (isBenchmarkExport(i) || (i == staticInitializerMethod && exportsStaticInitializer())) {
+            functionIndices[getMethodFunction(i)] = 0;
+            queue[queueLength++] = i;
+        }
+    }
+
+    //the first call_indirect reached needs the table, and every method in it
+    usesTable = false;
+    while (queueLength > 0) {
+        u32 caller = queue[--queueLength];
+        for (u32 site = functionCallSites[caller]; site < functionCallSites[caller + 1]; ++site) {
+            u8 op = codeStart[callSiteOffsets[site] - 1];
+            if (op == wasm::call_indirect && !usesTable) {
+                usesTable = true;
+                for (u32 i = 0; i < tableEntryCount; ++i) {
+                    u32 method = tableEntries[i];
+                    if (functionIndices[getMethodFunction(method)] == -1) {
+                        functionIndices[getMethodFunction(method)] = 0;
+                        queue[queueLength++] = method;
+                    }
+                }
+            }
+
+            u32 callee = getCalledFunction(site);
+            if (op == wasm::call && functionIndices[callee] == -1) {
+                functionIndices[callee] = 0;
+                if (callee >= FIRST_DEFINED_FUNCTION) {
+                    queue[queueLength++] = callee - FIRST_DEFINED_FUNCTION;
+                }
+            }
+        }
+    }
+
+    importCount = 0;
+    functionCount = 0;
+    for (u32 i = 0; i < FIRST_DEFINED_FUNCTION + definedCount; ++i) {
+        if (functionIndices[i] != -1) {
+            functionIndices[i] = functionCount++;
+            importCount += i < FIRST_DEFINED_FUNCTION;
+        }
+    }
+}
+
+u32 getSignatureLength(const u8* signature) {
+    u32 paramCount = signature[1];
+    return 3 + paramCount + signature[2 + paramCount];
+}
+
+const u8* getFixedSignature(u32 signature) {
+    const u8* s = SIGNATURES;
+    for (u32 i = 0; i < signature; ++i) {
+        s += getSignatureLength(s);
+    }
+    return s;
+}
+
+//add a signature to the type section, unless the same one is already there.  Returns its
+//type index
+u32 insertType(const u8* signature) {
+    u32 length = getSignatureLength(signature);
+
+    for (u32 type = 0; type < typeCount; ++type) {
+        u32 i = 0;
+        while (i < length && typeStarts[type][i] == signature[i]) {
+            ++i;
+        }
+
+        if (i == length) {
+            return type;
+        }
+    }
+
+    typeStarts[typeCount] = writePos;
+    for (u32 i = 0; i < length; ++i) {
+        *writePos++ = signature[i];
+    }
+    return typeCount++;
+}
+
+u32 insertFunctionType(u32 function) {
+    if (function < host::count) {
+        return insertType(getFixedSignature(HOST_IMPORTS[function].signature));
+    } else if (function < FIRST_DEFINED_FUNCTION) {
+        return insertType(getFixedSignature(MATH_IMPORTS[function - host::count].signature));
+    } else if (function == getAllocatorFunction()) {
+        return insertType(getFixedSignature(signature::i32_i32));
+    } else if (function >= getLibraryFunction(0)) {
+        const u8* s = LIBRARY_SIGNATURES;
+        for (u32 i = getLibraryFunction(0); i < function; ++i) {
+            s += getSignatureLength(s);
+        }
+        return insertType(s);
+    } else if (function > getAllocatorFunction()) {
+        return insertType(getFixedSignature(RUNTIME_SIGNATURES[function - getAllocatorFunction() - 1]));
+    }
+
+    //instance methods receive this before their parameters
+    Method& m = methods[function - FIRST_DEFINED_FUNCTION];
+    u8 signature[4 + 256];
+    u8* s = signature;
+    *s++ = wasm::type::func;
+    *s++ = m.paramCount + !m.isStatic;
+
+    if (!m.isStatic) {
+        *s++ = wasm::type::i32;
+    }
+
+    for (u32 p = 0; p < m.paramCount; ++p) {
+        *s++ = getWasmType(paramTypes[m.firstParam + p]);
+    }
+
+    if (m.returnType == wasm::type::_void) {
+        *s++ = 0;
+    } else {
+        *s++ = 1;
+        *s++ = getWasmType(m.returnType);
+    }
+
+    return insertType(signature);
+}
+
+//copy compiled code into the module.  Line entries in it move along with it, and those of
+//code that was skipped over are dropped
+u32 nextLineEntry = 0;
+u32 linkedLineEntryCount = 0;
+u32 linkedCodeOffset = 0; //where the first function body is in the module
+
+void copyCode(u8* src, u8* end) {
+    while (nextLineEntry < lineEntryCount && codeStart + lineEntryOffsets[nextLineEntry] < end) {
+        u8* entryPos = codeStart + lineEntryOffsets[nextLineEntry];
+        if (entryPos >= src) {
+            lineEntryOffsets[linkedLineEntryCount] = writePos + (entryPos - src) - moduleStart;
+            lineEntryLines[linkedLineEntryCount] = lineEntryLines[nextLineEntry];
+            ++linkedLineEntryCount;
+        }
+        ++nextLineEntry;
+    }
+
+    memmove(writePos, src, end - src);
+    writePos += end - src;
+}
+
+//insert the index that replaces the function id of a call site: the called function's index in
+//calls, and its type index otherwise, which a block type encodes as a signed number
+u8* insertLinkedId(u8* writePos, u32 site) {
+    u8 op = codeStart[callSiteOffsets[site] - 1];
+    u32 function = getCalledFunction(site);
+
+    if (op == wasm::call) {
+        return insertVaruint(writePos, functionIndices[function]);
+    } else if (op == wasm::call_indirect) {
+        return insertVaruint(writePos, functionTypes[function]);
+    }
+    return insertVarint(writePos, functionTypes[function]);
+}
+
+//the size of a function's code once it's linked, without the size in front of it
+u32 getLinkedSize(u32 function) {
+    u32 size = functionBodies[function + 1] - functionBodies[function] - SIZE_LENGTH;
+    for (u32 site = functionCallSites[function]; site < functionCallSites[function + 1]; ++site) {
+        u8 id[5];
+        size += insertLinkedId(id, site) - id - 2;
+    }
+    return size;
+}
+
+//insert the contents of the code section: the code of each function main reaches, with the
+//function ids of its call sites replaced.  Sizes are known before anything is copied, so they
+//take no more bytes than they need
+void insertLinkedCode() {
+    u32 definedCount = functionCount - importCount;
+    u32 sectionSize = getVaruintLength(definedCount);
+    for (u32 i = 0; i < getDefinedFunctionCount(); ++i) {
+        if (functionIndices[FIRST_DEFINED_FUNCTION + i] != -1) {
+            u32 size = getLinkedSize(i);
+            sectionSize += getVaruintLength(size) + size;
+        }
+    }
+    writePos = insertVaruint(writePos, sectionSize);
+    writePos = insertVaruint(writePos, definedCount);
+
+    nextLineEntry = 0;
+    linkedLineEntryCount = 0;
+    linkedCodeOffset = writePos - moduleStart;
+
+    for (u32 i = 0; i < getDefinedFunctionCount(); ++i) {
+        if (functionIndices[FIRST_DEFINED_FUNCTION + i] == -1) {
+            continue;
+        }
+
+        u8* src = functionBodies[i] + SIZE_LENGTH;
+        writePos = insertVaruint(writePos, getLinkedSize(i));
+
+        for (u32 site = functionCallSites[i]; site < functionCallSites[i + 1]; ++site) {
+            copyCode(src, codeStart + callSiteOffsets[site]);
+            writePos = insertLinkedId(writePos, site);
+            src = codeStart + callSiteOffsets[site] + 2;
+        }
+        copyCode(src, functionBodies[i + 1]);
+    }
+
+    lineEntryCount = linkedLineEntryCount;
+}
+
+//a hash of the tokens of a source, which whitespace and comments don't change, for hosts to
+//cache modules by.  It's 64 bits of FNV-1a over the kind and the characters of each token, and
+//its line when the module records lines: in a profile, a line table or a size report.  It's
+//returned as two words, low word first, since JavaScript can't take an i64
+u32 sourceHash[2];
+
+EXPORT u32* hashSource(char* sourceCode, u32 length) {
+    const u64 FNV_PRIME = 0x100000001B3;
+    u64 hash = 0xCBF29CE484222325;
+    bool hashesLines = isProfiling || emitsLineTable || emitsSizeReport;
+
+    readPos = sourceCode;
+    endReadPos = sourceCode + length;
+    sourceStart = sourceCode;
+    lineCachePos = 0;
+    for (nextToken(); tok.kind != token::End; nextToken()) {
+        hash = (hash ^ tok.kind) * FNV_PRIME;
+        if (hashesLines) {
+            hash = (hash ^ findLine(tok.start)) * FNV_PRIME;
+        }
+        for (u32 i = 0; i < tok.length; ++i) {
+            hash = (hash ^ (u8)tok.start[i]) * FNV_PRIME;
+        }
+    }
+
+    sourceHash[0] = (u32)hash;
+    sourceHash[1] = (u32)(hash >> 32);
+    return sourceHash;
+}
+
+//the compiled module, which getWasmFromJava returns.  Its address and size are returned
+//through memory, since JavaScript can't take an i64
+struct CompiledModule {
+    u8* start;
+    u32 length; //0 when the source had an error, or there was no memory to compile it in
+};
+
+CompiledModule compiledModule;
+
+//the output of a compile is placed after its source.  Nothing in it is bounds checked, so the
+//memory is grown ahead of each step to what it can write at most: the data and code are a few
+//bytes per byte of source, and the linked module and the size report are bounded by the code
+//and the source
+const u32 OUTPUT_BYTES_PER_SOURCE_BYTE = 16;
+const u32 OUTPUT_HEADROOM = 0x10000;
+
+//grow the memory so that everything below end can be written.  False if it can't grow
+bool reserveMemory(u8* end) {
+    u32 pageCount = ((u32)(void*)end + 0xFFFF) >> 16;
+    u32 currentPageCount = __builtin_wasm_memory_size(0);
+    return pageCount <= currentPageCount || __builtin_wasm_memory_grow(0, pageCount - currentPageCount) != -1;
+}
+
+u8* getOutputEnd(u8* start, u32 sourceLength) {
+    return start + OUTPUT_BYTES_PER_SOURCE_BYTE * sourceLength + OUTPUT_HEADROOM;
+}
+
+//where the host writes a source of the given length for hashSource and getWasmFromJava, after
+//the compiler's own data.  The memory is grown to fit the source and its output, so the host
+//must view the memory again after calling this.  0 if it can't grow
+EXPORT char* getSourceBuffer(u32 length) {
+    u8* start = &__heap_base;
+    return reserveMemory(getOutputEnd(start + length, length)) ? (char*)start : 0;
+}
+
+EXPORT CompiledModule* getWasmFromJava(char *sourceCode, u32 length)
+{
+    compiledModule.start = (u8*)(sourceCode + length);
+    compiledModule.length = 0;
+    if (!reserveMemory(getOutputEnd(compiledModule.start, length))) {
+        return &compiledModule;
+    }
+
+    //start placing the compiled output immediately after the input
+    readPos = sourceCode;
+    endReadPos = sourceCode + length;
+    writePos = (u8*) (sourceCode + length);
+
+    //reset the counter in case this module is reused.
+    initialDataSize = 0;
+    globalVarCount = 0;
+    stringLiteralCount = 0;
+    constantCount = 0;
+    staticInitializerCount = 0;
+    instanceInitializerCount = 0;
+    classCount = 0;
+    fieldCount = 0;
+    methodCount = 0;
+    mainMethod = -1;
+    staticInitializerMethod = -1;
+    paramTypeCount = 0;
+    instantiatedHashCount = 0;
+    tableEntryCount = 0;
+    usesAllocator = false;
+    usesStrings = false;
+    dataStart = writePos;
+    sourceStart = sourceCode;
+    profileSiteCount = 0;
+    maxProfileSites = 0;
+    lineCachePos = 0;
+    lineEntryCount = 0;
+    firstLocalName[0] = 0;
+    compileError.message = 0;
+    resetCompileStats();
+
+    //scan source code and add all string literals to the data section.  Note whether anything
+    //is allocated while at it
+    u32 prevHash = 0;
+    bool prevIsString = false;
+    nextToken();
+    while (tok.kind != token::End) {
+        //Strings that are only printed don't need the String runtime.  Anything else done with
+        //them needs a variable or method of a String type, or a method called on a literal
+        usesStrings |= prevIsString && !isSymbol('[');
+
+        u32 nameLength = 0;
+        while (tok.kind == token::Identifier && nameLength < tok.length && tok.start[nameLength] != '.') {
+            ++nameLength;
+        }
+        u32 nameHash = getIdentifierHash(tok.start, nameLength);
+        prevIsString = tok.kind == token::Identifier && (nameHash == HASH("String") || nameHash == HASH("StringBuilder"));
+
+        if (tok.kind == token::StringLiteral) {
+            if (stringLiteralCount == MAX_STRING_LITERALS) {
+                REPORT_ERROR("too many string literals");
+                break;
+            }
+
+            scanStringLiteral();
+
+            char* resumePos = readPos;
+            Token resumeTok = tok;
+            nextToken();
+            usesStrings |= isSymbol('.');
+            readPos = resumePos;
+            tok = resumeTok;
+        } else if (tok.kind == token::Identifier) {
+            //the Scanner is provided by the host
+            usesAllocator |= prevHash == HASH("new") && tok.hash != HASH("Scanner");
+
+            if (prevHash == HASH("new")) {
+                u32 i = 0;
+                while (i < instantiatedHashCount && i < MAX_INSTANTIATED_NAMES && instantiatedHashes[i] != tok.hash) {
+                    ++i;
+                }
+
+                if (i == instantiatedHashCount) {
+                    if (i < MAX_INSTANTIATED_NAMES) {
+                        instantiatedHashes[i] = tok.hash;
+                    }
+                    ++instantiatedHashCount;
+                }
+            }
+        }
+
+        //every branch and loop has at most one site.  Methods have one more each
+        if (tok.kind == token::Identifier) {
+            switch (tok.hash) {
+                case HASH("if"):
+                case HASH("else"):
+                case HASH("while"):
+                case HASH("for"):
+                case HASH("do"):
+                case HASH("case"):
+                case HASH("default"):
+                    ++maxProfileSites;
+            }
+        }
+
+        prevHash = tok.hash;
+        nextToken();
+    }
+
+    if (usesStrings) {
+        usesAllocator = true;
+        nullStringAddress = placeStringConstant("null");
+        trueStringAddress = placeStringConstant("true");
+        falseStringAddress = placeStringConstant("false");
+    }
+
+    initialDataSize = writePos - dataStart;
+    endPhase(phase::Prescan);
+
+    //find the classes, fields and methods of the program
+    rewindTo(sourceCode);
+    scanClassNames();
+    rewindTo(sourceCode);
+    scanProgram();
+    endPhase(phase::Declarations);
+
+    //objects are allocated on the stack from the end of the data, and on the heap from the
+    //end of the stack.  Neither starts at address 0, which is null
+    u32 stackStart = (initialDataSize + 7) & ~7;
+    if (stackStart == 0) {
+        stackStart = 8;
+    }
+
+    if (isProfiling || isTiered) {
+        maxProfileSites += methodCount;
+        if (maxProfileSites > MAX_PROFILE_SITES) {
+            maxProfileSites = MAX_PROFILE_SITES;
+        }
+
+        profileStart = stackStart;
+        stackStart = (profileStart + 4 + 8 * maxProfileSites + 7) & ~7;
+    }
+    stackLimit = usesAllocator ? stackStart + STACK_SIZE : stackStart;
+
+    //the code is compiled before the sections in front of it, since the imports and types it
+    //uses aren't known until then.  It's linked into the module after them
+    codeStart = writePos;
+    callSiteCount = 0;
+
+    for (u32 i = 0; i < methodCount; ++i) {
+        compileAndInsertFunction(i);
+    }
+
+    if (usesAllocator) {
+        insertAllocator();
+    }
+
+    if (usesStrings) {
+        insertStringRuntime();
+        insertLibrary();
+    }
+
+    findUsedFunctions();
+    endPhase(phase::Code);
+
+    if (compileError.message) {
+        return &compiledModule;
+    }
+
+    //the sections in front of the code are smaller than it
+    if (!reserveMemory(writePos + 2 * (writePos - codeStart) + OUTPUT_HEADROOM)) {
+        return &compiledModule;
+    }
+
+    //begin the outputted program with the 8 byte wasm header
+    moduleStart = writePos;
+    for (int i = 0; i < 8; ++i) {
+        *writePos++ = WASM_HEADER[i];
+    }
+
+    //functions with the same signature share a type
+    *writePos++ = wasm::section::Type;
+    u8 *typeSectionSize = writePos;
+    writePos += SIZE_LENGTH;
+    u8* typeCountPos = writePos;
+    writePos += 2; //# of func headers defined (patched once they're deduplicated)
+    typeCount = 0;
+
+    for (u32 i = 0; i < FIRST_DEFINED_FUNCTION + getDefinedFunctionCount(); ++i) {
+        if (functionIndices[i] != -1) {
+            functionTypes[i] = insertFunctionType(i);
+        }
+    }
+
+    patchVaruint(typeCountPos, typeCount);
+    patchSectionSize(typeSectionSize);
+    countSection(typeSectionSize - 1);
+    // PRINT_LIT("Finished Type section\n");
+
+
+    *writePos++ = wasm::section::Import;
+    u8 *importSectionSize = writePos;
+    writePos += SIZE_LENGTH; //bytes belong to this section (patched further down)
+    writePos = insertVaruint(writePos, importCount); //# functions to import
+
+    for (u32 i = 0; i < FIRST_DEFINED_FUNCTION; ++i) {
+        if (functionIndices[i] != -1) {
+            const Import& imported = i < host::count ? HOST_IMPORTS[i] : MATH_IMPORTS[i - host::count];
+            writePos = insertName(writePos, imported.module);
+            writePos = insertName(writePos, imported.name);
+            *writePos++ = wasm::external::Function;
+            writePos = insertVaruint(writePos, functionTypes[i]);
+        }
+    }
+
+    patchSectionSize(importSectionSize);
+    countSection(importSectionSize - 1);
+    // PRINT_LIT("Finished Import section\n");
+
+
+    *writePos++ = wasm::section::Function;
+    u8 *functionSectionSize = writePos;
+    writePos += SIZE_LENGTH;
+    writePos = insertVaruint(writePos, functionCount - importCount); //# of functions defined inside this module
+
+    for (u32 i = FIRST_DEFINED_FUNCTION; i < FIRST_DEFINED_FUNCTION + getDefinedFunctionCount(); ++i) {
+        if (functionIndices[i] != -1) {
+            writePos = insertVaruint(writePos, functionTypes[i]);
+        }
+    }
+
+    patchSectionSize(functionSectionSize);
+    countSection(functionSectionSize - 1);
+    // PRINT_LIT("Finished Function section\n");
+
+
+    //the vtables virtual calls are dispatched through
+    if (usesTable) {
+        *writePos++ = wasm::section::Table;
+        u8* tableSectionSize = writePos;
+        writePos += SIZE_LENGTH;
+        *writePos++ = 1; //one table defined
+        *writePos++ = wasm::type::anyFunc;
+        *writePos++ = 1; //table has a maximum
+        writePos = insertVaruint(writePos, tableEntryCount); //initial size
+        writePos = insertVaruint(writePos, tableEntryCount); //maximum size
+        patchSectionSize(tableSectionSize);
+        countSection(tableSectionSize - 1);
+    }
+
+
+    //memory grows as objects are allocated
+    *writePos++ = wasm::section::Memory;
+    u8 *memorySectionSize = writePos;
+    writePos += SIZE_LENGTH;
+    *writePos++ = 1; //one memory defined
+    *writePos++ = 0; //memory has no maximum
+    writePos = insertVaruint(writePos, (stackLimit + 0xFFFF) >> 16); //initial pages
+    patchSectionSize(memorySectionSize);
+    countSection(memorySectionSize - 1);
+    // PRINT_LIT("Finished Memory section\n");
+
+
+    *writePos++ = wasm::section::Global;
+    u8 *globalSectionSize = writePos;
+    writePos += SIZE_LENGTH; //# of bytes belong to this section.  This'll be patched further down the code
+    bool countsAllocations = usesAllocator && isBenchmarking;
+    writePos = insertVaruint(writePos, getFuelGlobal() + isFueled); //# of global variables defined
+
+    for (u32 i = 0; i < globalVarCount; ++i) {
+        Expr& value = globalInitialValues[i];
+        *writePos++ = getWasmType(varTypes[i]);
+        *writePos++ = 1; //is mutable
+        emitConst(value.type, value.intValue, value.type == wasm::type::f32 ? value.f32Value : value.f64Value);
+        *writePos++ = wasm::end;
+    }
+
+    //the tops of the heap and of the stack
+    if (usesAllocator) {
+        *writePos++ = wasm::type::i32;
+        *writePos++ = 1; //is mutable
+        emitConst(wasm::type::i32, stackLimit, 0.0);
+        *writePos++ = wasm::end;
+
+        *writePos++ = wasm::type::i32;
+        *writePos++ = 1; //is mutable
+        emitConst(wasm::type::i32, stackStart, 0.0);
+        *writePos++ = wasm::end;
+    }
+
+    if (isProfiling) {
+        *writePos++ = wasm::type::i32;
+        *writePos++ = 0; //is immutable
+        emitConst(wasm::type::i32, profileStart, 0.0);
+        *writePos++ = wasm::end;
+    }
+
+    if (countsAllocations) {
+        *writePos++ = wasm::type::i32;
+        *writePos++ = 1; //is mutable
+        emitConst(wasm::type::i32, 0, 0.0);
+        *writePos++ = wasm::end;
+    }
+
+    if (isFueled) {
+        *writePos++ = wasm::type::i32;
+        *writePos++ = 1; //is mutable
+        emitConst(wasm::type::i32, 0, 0.0);
+        *writePos++ = wasm::end;
+    }
+
+    patchSectionSize(globalSectionSize);
+    countSection(globalSectionSize - 1);
+    // PRINT_LIT("Finished Global section\n");
+
+
+    bool exportsHeapTop = usesAllocator && (isBenchmarking || isTiered);
+    u32 benchmarkExportCount = exportsHeapTop + countsAllocations + exportsStaticInitializer();
+    for (u32 i = 0; i < methodCount; ++i) {
+        benchmarkExportCount += isBenchmarkExport(i);
+    }
+    u32 staticExportCount = isTiered ? globalVarCount : 0;
+
+    *writePos++ = wasm::section::Export;
+    u8 *exportSectionSize = writePos;
+    writePos += SIZE_LENGTH; //# of bytes that belong to this section
+    writePos = insertVaruint(writePos, 2 + isProfiling + benchmarkExportCount + isFueled + staticExportCount); //# of things to export
+
+    INSERT_LIT("main", writePos);
+    *writePos++ = wasm::external::Function;
+    writePos = insertVaruint(writePos, functionIndices[getMethodFunction(mainMethod)]); //index of function
+
+    INSERT_LIT("memory", writePos);
+    *writePos++ = wasm::external::Memory;
+    *writePos++ = 0; //index of memory
+
+    if (isProfiling) {
+        INSERT_LIT("profile", writePos);
+        *writePos++ = wasm::external::Global;
+        writePos = insertVaruint(writePos, globalVarCount + 2 * usesAllocator);
+    }
+
+    for (u32 i = 0; i < methodCount; ++i) {
+        if (isBenchmarkExport(i)) {
+            writePos = insertQualifiedName(writePos, classes[methods[i].classIndex].name, findMethodName(methods[i]));
+            *writePos++ = wasm::external::Function;
+            writePos = insertVaruint(writePos, functionIndices[getMethodFunction(i)]);
+        }
+    }
+
+    if (exportsStaticInitializer()) {
+        INSERT_LIT("initialize", writePos);
+        *writePos++ = wasm::external::Function;
+        writePos = insertVaruint(writePos, functionIndices[getMethodFunction(staticInitializerMethod)]);
+    }
+
+    if (exportsHeapTop) {
+        INSERT_LIT("heapTop", writePos);
+        *writePos++ = wasm::external::Global;
+        writePos = insertVaruint(writePos, globalVarCount);
+    }
+
+    if (countsAllocations) {
+        INSERT_LIT("allocations", writePos);
+        *writePos++ = wasm::external::Global;
+        writePos = insertVaruint(writePos, getAllocationCountGlobal());
+    }
+
+    if (isFueled) {
+        INSERT_LIT("fuel", writePos);
+        *writePos++ = wasm::external::Global;
+        writePos = insertVaruint(writePos, getFuelGlobal());
+    }
+
+    for (u32 i = 0; i < staticExportCount; ++i) {
+        writePos = insertNumberedName(writePos, "static", i);
+        *writePos++ = wasm::external::Global;
+        writePos = insertVaruint(writePos, i);
+    }
+
+    patchSectionSize(exportSectionSize);
+    countSection(exportSectionSize - 1);
+    // PRINT_LIT("Finished Export section\n");
+
+
+    //the table is filled with the vtables, from index 0
+    if (usesTable) {
+        *writePos++ = wasm::section::Element;
+        u8* elementSectionSize = writePos;
+        writePos += SIZE_LENGTH;
+        *writePos++ = 1; //one element segment
+        *writePos++ = 0; //table index 0
+        emitConst(wasm::type::i32, 0, 0.0);
+        *writePos++ = wasm::end;
+        writePos = insertVaruint(writePos, tableEntryCount);
+
+        for (u32 i = 0; i < tableEntryCount; ++i) {
+            writePos = insertVaruint(writePos, functionIndices[getMethodFunction(tableEntries[i])]);
+        }
+
+        patchSectionSize(elementSectionSize);
+        countSection(elementSectionSize - 1);
+    }
+    endPhase(phase::Headers);
+
+
+    u8* codeSection = writePos;
+    *writePos++ = wasm::section::Code;
+    insertLinkedCode();
+    countSection(codeSection);
+    // PRINT_LIT("Finished Code section\n");
+
+    if (initialDataSize > 0 || profileSiteCount > 0) {
+        u8* dataSection = writePos;
+        *writePos++ = wasm::section::Data;
+        u8* dataSectionSize = writePos;
+        writePos += SIZE_LENGTH;
+        *writePos++ = (initialDataSize > 0) + (profileSiteCount > 0); //# of data segments
+
+        if (initialDataSize > 0) {
+            *writePos++ = 0; //memory index 0
+            *writePos++ = wasm::i32_const;
+            *writePos++ = 0;
+            *writePos++ = wasm::end;
+            writePos = insertVaruint(writePos, initialDataSize);
+
+            //copy those bytes from the beginning of the module to the correct
+            //location at the end of the module
+            readPos = sourceCode + length;
+            for (int i = 0; i < initialDataSize; ++i) {
+                *writePos++ = *readPos++;
+            }
+        }
+
+        //the profile's sites.  Their counts start at 0
+        if (profileSiteCount > 0) {
+            *writePos++ = 0; //memory index 0
+            emitConst(wasm::type::i32, profileStart, 0.0);
+            *writePos++ = wasm::end;
+            writePos = insertVaruint(writePos, 4 + 8 * profileSiteCount);
+
+            storeU32(writePos, profileSiteCount);
+            writePos += 4;
+
+            for (u32 i = 0; i < profileSiteCount; ++i) {
+                storeU32(writePos, findLine(profileSitePos[i]) << 2 | profileSiteKind[i]);
+                storeU32(writePos + 4, 0);
+                writePos += 8;
+            }
+        }
+
+        patchSectionSize(dataSectionSize);
+        countSection(dataSection);
+    }
+
+    if (emitsNameSection) {
+        insertNameSection();
+    }
+
+    if (emitsLineTable) {
+        insertLineTable();
+    }
+
+    //a section too large for its size
+    if (compileError.message) {
+        return &compiledModule;
+    }
+
+    //the module was linked after the code it was linked from.  It's moved down over it
+    u8* moduleEnd = writePos;
+    writePos = (u8*)(sourceCode + length + initialDataSize);
+    for (u8* c = moduleStart; c < moduleEnd; ++c) {
+        *writePos++ = *c;
+    }
+
+    u8* module = (u8*)(sourceCode + length + initialDataSize);
+    stats.moduleBytes = writePos - module;
+
+    sizeReport.start = writePos;
+    if (emitsSizeReport && reserveMemory(getOutputEnd(writePos, length))) {
+        insertSizeReport(module);
+    }
+    sizeReport.length = writePos - sizeReport.start;
+    endPhase(phase::Data);
+
+    compiledModule.start = module;
+    compiledModule.length = stats.moduleBytes;
+    return &compiledModule;
+}
+
+
+
+//find the name of each parameter of a method.  Returns the '{' its body starts with, or 0
+//if it has no body
+char* findParameterNames(Method& m, u32* names) {
+    if (!m.parameterList) {
+        return 0;
+    }
+
+    rewindTo(m.parameterList);
+
+    //each parameter's name is the identifier before the ',' or ')' that ends it
+    u32 param = 0;
+    u32 nameHash = 0;
+    char* namePos = 0;
+    while (tok.kind != token::End && !isSymbol('{') && !isSymbol(';')) {
+        if (tok.kind == token::Identifier) {
+            nameHash = tok.hash;
+            namePos = tok.start;
+        } else if ((isSymbol(',') || isSymbol(')')) && param < m.paramCount) {
+            parameterNamePos[param] = namePos;
+            names[param++] = nameHash;
+        }
+        nextToken();
+    }
+
+    return isSymbol('{') ? tok.start : 0;
+}
+
+//constructors start by running their superclass's, before the field initializers.  It's the
+//one the body starts by calling with super(...), or else the one without parameters.  The
+//statement calling it is skipped when the body is compiled
+void compileSuperConstructorCall(u32 classIndex, char* body) {
+    u32 superclass = classes[classIndex].superclass;
+    if (superclass == -1) {
+        return;
+    }
+
+    exprCount = 1;
+    releaseScratchLocals();
+    u16 args = 0;
+    u32 argCount = 0;
+
+    if (body) {
+        rewindTo(body);
+        nextToken();
+        if (tok.kind == token::Identifier && tok.hash == HASH("super")) {
+            nextToken();
+            args = parseArguments(argCount);
+        }
+    }
+
+    u32 constructor = findMethod(superclass, HASH("<init>"), argCount);
+    if (constructor != -1) {
+        u16 thisArg = newExpr(expr::Variable, java::type::firstClass + classIndex);
+        exprs[thisArg].varIndex = findVar(HASH("this"));
+        exprs[thisArg].next = args;
+        emitMethodCall(constructor, thisArg, false);
+    }
+}
+
+//field initializers run at the start of every constructor
+void compileInstanceInitializer(u32 index) {
+    rewindTo(instanceInitializerPos[index]);
+    compileBlock();
+}
+
+//the field initializers and instance initializers of a class, interleaved in the order they're
+//declared, as Java runs them
+void compileFieldInitializers(u32 classIndex) {
+    Class& c = classes[classIndex];
+    u32 block = 0;
+
+    for (u32 i = c.firstField; i < c.firstField + c.fieldCount; ++i) {
+        if (fields[i].initializer) {
+            for (; block < instanceInitializerCount && instanceInitializerPos[block] < fields[i].initializer; ++block) {
+                if (instanceInitializerClass[block] == classIndex) {
+                    compileInstanceInitializer(block);
+                }
+            }
+
+            rewindTo(fields[i].initializer);
+            exprCount = 1;
+            releaseScratchLocals();
+
+            u16 object = newExpr(expr::Variable, java::type::firstClass + classIndex);
+            exprs[object].varIndex = findVar(HASH("this"));
+            u16 target = newFieldAccess(object, i);
+
+            if (exprs[target].kind == expr::Variable) {
+                emitExpressionAs(parseExpression(), fields[i].type);
+                emitSetVar(exprs[target].varIndex);
+            } else {
+                emitGetVar(exprs[object].varIndex);
+                emitExpressionAs(parseExpression(), fields[i].type);
+                emitFieldAccess(i, true);
+            }
+        }
+    }
+
+    for (; block < instanceInitializerCount; ++block) {
+        if (instanceInitializerClass[block] == classIndex) {
+            compileInstanceInitializer(block);
+        }
+    }
+}
+
+//whether a line of a method, from its parameters to the end of its body, is hot.  Methods
+//without a body aren't
+bool hasHotLine(Method& m, char* body) {
+    if (!body) {
+        return false;
+    }
+
+    u32 line = findLine(m.parameterList);
+    rewindTo(body);
+    skipBlock();
+    u32 lastLine = findLine(tok.start);
+
+    for (; line <= lastLine && line < MAX_HOT_LINES; ++line) {
+        if (hotLines[line / 32] & 1 << line % 32) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void compileAndInsertFunction(u32 methodIndex) {
+    Method& m = methods[methodIndex];
+    ++stats.methodsCompiled;
+
+    //write to this address at the end of the function once the body size is known
+    u8* functionBodySize = writePos;
+    writePos += SIZE_LENGTH; //# of bytes
+
+    //parameters are the first locals.  Instance methods receive this before the others
+    totalVarCount = globalVarCount;
+    if (!m.isStatic) {
+        varNames[addLocal(HASH("this"), java::type::firstClass + m.classIndex)] = (char*)"this";
+    }
+
+    char* beginningOfFuncBody = findParameterNames(m, parameterNames);
+    for (u32 i = 0; i < m.paramCount; ++i) {
+        varNames[addLocal(parameterNames[i], paramTypes[m.firstParam + i])] = parameterNamePos[i];
+    }
+
+    isMethodOptimized = isOptimizing && (!hasHotLines || hasHotLine(m, beginningOfFuncBody));
+
+    u8* beginningOfCode = writePos;
+    u32 firstLocal = totalVarCount;
+    u32 firstLineEntry = lineEntryCount;
+    u32 firstCallSite = callSiteCount;
+
+    //compile the function twice.  The first pass finds all local variables, including the
+    //scratch locals the code needs.  Its code is thrown away once the locals are declared
+    for (int pass = 0; pass < 2; ++pass) {
+        totalVarCount = firstLocal;
+        blockStackSave = -1;
+        blockDepth = 0;
+        jumpTargetCount = 0;
+        controlDepth = 0;
+        inlineDepth = 0;
+
+        lineEntryCount = firstLineEntry;
+        callSiteCount = firstCallSite;
+        for (u32 i = 0; i < MAX_VARS; ++i) {
+            varFirstScalar[i] = -1;
+        }
+        for (u32 i = firstLocal; i < MAX_VARS; ++i) {
+            varNames[i] = 0;
+        }
+
+        emitProfileCounter(profile::MethodEntry, m.parameterList);
+        emitFuelCheck();
+
+        if (methodIndex == mainMethod && staticInitializerMethod != -1) {
+            emitCallTo(getMethodFunction(staticInitializerMethod));
+        } else if (methodIndex == staticInitializerMethod) {
+            compileStaticInitializers();
+        }
+
+        currentClass = m.classIndex;
+        inStaticContext = m.isStatic;
+        currentReturnType = m.returnType;
+
+        if (m.hash == HASH("<init>")) {
+            compileSuperConstructorCall(m.classIndex, beginningOfFuncBody);
+            compileFieldInitializers(m.classIndex);
+        }
+
+        if (beginningOfFuncBody) {
+            rewindTo(beginningOfFuncBody);
+            compileBlock();
+        }
+
+        //methods that return a value must do so before reaching their end
+        if (m.returnType != wasm::type::_void) {
+            *writePos++ = wasm::unreachable;
+        }
+        *writePos++ = wasm::end;
+
+        //encode local variable metadata at the top of the function body
+        if (pass == 0) {
+            writePos = beginningOfCode;
+
+            //runs of locals with the same type share one entry
+            u8* localEntryCount = writePos++;
+            *localEntryCount = 0;
+
+            for (u32 i = firstLocal; i < totalVarCount; ) {
+                u8 type = getWasmType(varTypes[i]);
+                u32 count = 0;
+                while (i < totalVarCount && getWasmType(varTypes[i]) == type) {
+                    ++count;
+                    ++i;
+                }
+
+                writePos = insertVaruint(writePos, count); //# of locals of the following type
+                *writePos++ = type;
+                ++*localEntryCount;
+            }
+        }
+    }
+
+    //remember the names of the locals for the name section
+    u32 localName = firstLocalName[methodIndex];
+    for (u32 i = globalVarCount; i < totalVarCount && localName < MAX_LOCAL_NAMES; ++i) {
+        localNames[localName++] = varNames[i];
+    }
+    firstLocalName[methodIndex + 1] = localName;
+
+    //patch in the body size of the function earlier in the output
+    patchSize(functionBodySize);
+}
+
+void insertAllocator() {
+    u32 heapTop = globalVarCount;
+
+    u8* functionBodySize = writePos;
+    writePos += SIZE_LENGTH;
+    *writePos++ = 1; //# of local entries
+    *writePos++ = 1; //the new top of the heap
+    *writePos++ = wasm::type::i32;
+
+    if (isBenchmarking) {
+        *writePos++ = wasm::get_global;
+        writePos = insertVaruint(writePos, getAllocationCountGlobal());
+        emitConst(wasm::type::i32, 1, 0.0);
+        *writePos++ = wasm::i32_add;
+        *writePos++ = wasm::set_global;
+        writePos = insertVaruint(writePos, getAllocationCountGlobal());
+    }
+
+    //the object starts at the old top of the heap.  Nothing is ever freed
+    *writePos++ = wasm::get_global;
+    writePos = insertVaruint(writePos, heapTop);
+    *writePos++ = wasm::get_global;
+    writePos = insertVaruint(writePos, heapTop);
+    emitLocal(wasm::get_local, 0); //the size class
+    *writePos++ = wasm::i32_add;
+    emitLocal(wasm::tee_local, 1);
+    *writePos++ = wasm::set_global;
+    writePos = insertVaruint(writePos, heapTop);
+
+    //grow memory by as many pages as the object needs when it doesn't fit
+    emitLocal(wasm::get_local, 1);
+    *writePos++ = wasm::memory_size;
+    *writePos++ = 0; //memory index
+    emitConst(wasm::type::i32, 16, 0.0);
+    *writePos++ = wasm::i32_shl;
+    *writePos++ = wasm::i32_gt_u;
+    *writePos++ = wasm::_if;
+    *writePos++ = wasm::type::_void;
+
+    emitLocal(wasm::get_local, 1);
+    emitConst(wasm::type::i32, 0xFFFF, 0.0);
+    *writePos++ = wasm::i32_add;
+    emitConst(wasm::type::i32, 16, 0.0);
+    *writePos++ = wasm::i32_shr_u;
+    *writePos++ = wasm::memory_size;
+    *writePos++ = 0; //memory index
+    *writePos++ = wasm::i32_sub;
+    *writePos++ = wasm::memory_grow;
+    *writePos++ = 0; //memory index
+
+    //out of memory
+    emitConst(wasm::type::i32, -1, 0.0);
+    *writePos++ = wasm::i32_eq;
+    *writePos++ = wasm::_if;
+    *writePos++ = wasm::type::_void;
+    *writePos++ = wasm::unreachable;
+    *writePos++ = wasm::end;
+
+    *writePos++ = wasm::end;
+    *writePos++ = wasm::end;
+
+    patchSize(functionBodySize);
+}
+
+
+//begin a function of the runtime that has localCount locals of one type after its parameters
+u8* beginRuntimeFunction(u32 localCount, u8 localType) {
+    u8* functionBodySize = writePos;
+    writePos += SIZE_LENGTH;
+
+    if (localCount) {
+        *writePos++ = 1; //# of local entries
+        *writePos++ = localCount;
+        *writePos++ = localType;
+    } else {
+        *writePos++ = 0;
+    }
+
+    return functionBodySize;
+}
+
+void endRuntimeFunction(u8* functionBodySize) {
+    *writePos++ = wasm::end;
+    patchSize(functionBodySize);
+}
+
+void insertStringRuntime() {
+    //stringAlloc(capacity, coder).  Strings are allocated in multiples of 8 bytes, with no
+    //size classes, since they're never freed
+    u8* body = beginRuntimeFunction(1, wasm::type::i32);
+    emitLocal(wasm::get_local, 0);
+    emitLocal(wasm::get_local, 1);
+    *writePos++ = wasm::i32_shl;
+    emitConst(wasm::type::i32, string::chars + 7, 0.0);
+    *writePos++ = wasm::i32_add;
+    emitConst(wasm::type::i32, -8, 0.0);
+    *writePos++ = wasm::i32_and;
+    emitCallTo(getAllocatorFunction());
+    emitLocal(wasm::tee_local, 2);
+    emitLocal(wasm::get_local, 0);
+    emitMemoryAccess(wasm::i32_store, 2, string::capacity);
+    emitLocal(wasm::get_local, 2);
+    emitLocal(wasm::get_local, 1);
+    emitMemoryAccess(wasm::i32_store, 2, string::coder);
+    emitLocal(wasm::get_local, 2);
+    endRuntimeFunction(body);
+
+    //charAt(str, index)
+    body = beginRuntimeFunction(0, 0);
+    emitLocal(wasm::get_local, 0);
+    emitMemoryAccess(wasm::i32_load8_u, 0, string::coder);
+    *writePos++ = wasm::_if;
+    *writePos++ = wasm::type::i32;
+    emitLocal(wasm::get_local, 0);
+    emitLocal(wasm::get_local, 1);
+    emitConst(wasm::type::i32, 1, 0.0);
+    *writePos++ = wasm::i32_shl;
+    *writePos++ = wasm::i32_add;
+    emitMemoryAccess(wasm::i32_load16_u, 1, string::chars);
+    *writePos++ = wasm::_else;
+    emitLocal(wasm::get_local, 0);
+    emitLocal(wasm::get_local, 1);
+    *writePos++ = wasm::i32_add;
+    emitMemoryAccess(wasm::i32_load8_u, 0, string::chars);
+    *writePos++ = wasm::end;
+    endRuntimeFunction(body);
+
+    //appendChar(str, c).  The String must have room for it, and be UTF-16 if c needs it
+    body = beginRuntimeFunction(0, 0);
+    emitLocal(wasm::get_local, 0);
+    emitMemoryAccess(wasm::i32_load8_u, 0, string::coder);
+    *writePos++ = wasm::_if;
+    *writePos++ = wasm::type::_void;
+    emitLocal(wasm::get_local, 0);
+    emitLocal(wasm::get_local, 0);
+    emitMemoryAccess(wasm::i32_load, 2, string::length);
+    emitConst(wasm::type::i32, 1, 0.0);
+    *writePos++ = wasm::i32_shl;
+    *writePos++ = wasm::i32_add;
+    emitLocal(wasm::get_local, 1);
+    emitMemoryAccess(wasm::i32_store16, 1, string::chars);
+    *writePos++ = wasm::_else;
+    emitLocal(wasm::get_local, 0);
+    emitLocal(wasm::get_local, 0);
+    emitMemoryAccess(wasm::i32_load, 2, string::length);
+    *writePos++ = wasm::i32_add;
+    emitLocal(wasm::get_local, 1);
+    emitMemoryAccess(wasm::i32_store8, 0, string::chars);
+    *writePos++ = wasm::end;
+    emitLocal(wasm::get_local, 0);
+    emitLocal(wasm::get_local, 0);
+    emitMemoryAccess(wasm::i32_load, 2, string::length);
+    emitConst(wasm::type::i32, 1, 0.0);
+    *writePos++ = wasm::i32_add;
+    emitMemoryAccess(wasm::i32_store, 2, string::length);
+    endRuntimeFunction(body);
+
+    //appendString(str, other).  A null other appends "null"
+    body = beginRuntimeFunction(0, 0);
+    emitLocal(wasm::get_local, 0);
+    emitLocal(wasm::get_local, 1);
+    emitConst(wasm::type::i32, nullStringAddress, 0.0);
+    emitLocal(wasm::get_local, 1);
+    *writePos++ = wasm::select;
+    emitLibraryCall(library::appendChars);
+    endRuntimeFunction(body);
+
+    //reserve(builder, chars, coder).  When the builder's String doesn't have room for the
+    //characters, or needs to be widened to UTF-16, it's copied into a String with at least
+    //twice the capacity.  Returns the builder's String
+    body = beginRuntimeFunction(2, wasm::type::i32); //the String, and the length it needs
+    emitLocal(wasm::get_local, 0);
+    emitMemoryAccess(wasm::i32_load, 2, 0);
+    emitLocal(wasm::tee_local, 3);
+    emitMemoryAccess(wasm::i32_load, 2, string::length);
+    emitLocal(wasm::get_local, 1);
+    *writePos++ = wasm::i32_add;
+    emitLocal(wasm::tee_local, 4);
+    emitLocal(wasm::get_local, 3);
+    emitMemoryAccess(wasm::i32_load, 2, string::capacity);
+    *writePos++ = wasm::i32_gt_u;
+    emitLocal(wasm::get_local, 2);
+    emitLocal(wasm::get_local, 3);
+    emitMemoryAccess(wasm::i32_load8_u, 0, string::coder);
+    *writePos++ = wasm::i32_gt_u;
+    *writePos++ = wasm::i32_or;
+    *writePos++ = wasm::_if;
+    *writePos++ = wasm::type::_void;
+
+    //max(capacity * 2, needed)
+    emitLocal(wasm::get_local, 3);
+    emitMemoryAccess(wasm::i32_load, 2, string::capacity);
+    emitConst(wasm::type::i32, 1, 0.0);
+    *writePos++ = wasm::i32_shl;
+    emitLocal(wasm::get_local, 4);
+    emitLocal(wasm::get_local, 3);
+    emitMemoryAccess(wasm::i32_load, 2, string::capacity);
+    emitConst(wasm::type::i32, 1, 0.0);
+    *writePos++ = wasm::i32_shl;
+    emitLocal(wasm::get_local, 4);
+    *writePos++ = wasm::i32_gt_u;
+    *writePos++ = wasm::select;
+
+    emitLocal(wasm::get_local, 2);
+    emitLocal(wasm::get_local, 3);
+    emitMemoryAccess(wasm::i32_load8_u, 0, string::coder);
+    *writePos++ = wasm::i32_or;
+    emitRuntimeCall(runtime::stringAlloc);
+    emitLocal(wasm::tee_local, 4);
+    emitLocal(wasm::get_local, 3);
+    emitLibraryCall(library::appendChars);
+    emitLocal(wasm::get_local, 0);
+    emitLocal(wasm::get_local, 4);
+    emitMemoryAccess(wasm::i32_store, 2, 0);
+    emitLocal(wasm::get_local, 4);
+    emitLocal(wasm::set_local, 3);
+    *writePos++ = wasm::end;
+
+    emitLocal(wasm::get_local, 3);
+    endRuntimeFunction(body);
+}
+
+void insertLibrary() {
+    for (u32 f = 0; f < library::count; ++f) {
+        u8* functionBodySize = writePos;
+        writePos += SIZE_LENGTH;
+
+        u32 i = LIBRARY_CODE_STARTS[f];
+        for (u32 call = LIBRARY_CALL_STARTS[f]; call < LIBRARY_CALL_STARTS[f + 1]; ++call) {
+            while (i < LIBRARY_CALL_OFFSETS[call]) {
+                *writePos++ = LIBRARY_CODE[i++];
+            }
+            emitLibraryCall(LIBRARY_CALLEES[call]);
+        }
+        while (i < LIBRARY_CODE_STARTS[f + 1]) {
+            *writePos++ = LIBRARY_CODE[i++];
+        }
+
+        patchSize(functionBodySize);
+    }
+}
+
+//the identifier a method is declared with, found before its parameter list
+const char* findMethodName(Method& m) {
+    if (m.hash == HASH("<init>")) {
+        return "<init>";
+    } else if (m.hash == HASH("<clinit>")) {
+        return "<clinit>";
+    }
+
+    char* c = m.parameterList;
+    while (c > sourceStart && (c[-1] == ' ' || c[-1] == '\t' || c[-1] == '\n' || c[-1] == '\r')) {
+        --c;
+    }
+    while (c > sourceStart && isValidNonLeadingIDChar(c[-1])) {
+        --c;
+    }
+
+    return c;
+}
+
+void insertNameSection() {
+    u8* nameSection = writePos;
+    *writePos++ = wasm::section::UserDefined;
+    u8* nameSectionSize = writePos;
+    writePos += SIZE_LENGTH;
+    INSERT_LIT("name", writePos);
+
+    //the module is named after the class with main
+    *writePos++ = 0; //module name subsection
+    u8* subsectionSize = writePos;
+    writePos += SIZE_LENGTH;
+    writePos = insertQualifiedName(writePos, classes[methods[mainMethod].classIndex].name, 0);
+    patchSectionSize(subsectionSize);
+
+    //functions are named like the Java methods they're compiled from
+    *writePos++ = 1; //function names subsection
+    subsectionSize = writePos;
+    writePos += SIZE_LENGTH;
+    writePos = insertVaruint(writePos, functionCount);
+
+    for (u32 i = 0; i < FIRST_DEFINED_FUNCTION + getDefinedFunctionCount(); ++i) {
+        if (functionIndices[i] == -1) {
+            continue;
+        }
+
+        writePos = insertVaruint(writePos, functionIndices[i]);
+        if (i < host::count) {
+            writePos = insertName(writePos, HOST_IMPORTS[i].name);
+        } else if (i < FIRST_DEFINED_FUNCTION) {
+            writePos = insertQualifiedName(writePos, MATH_IMPORTS[i - host::count].module, MATH_IMPORTS[i - host::count].name);
+        } else if (i < getAllocatorFunction()) {
+            Method& m = methods[i - FIRST_DEFINED_FUNCTION];
+            writePos = insertQualifiedName(writePos, classes[m.classIndex].name, findMethodName(m));
+        } else if (i == getAllocatorFunction()) {
+            writePos = insertName(writePos, "allocate");
+        } else if (i >= getLibraryFunction(0)) {
+            writePos = insertName(writePos, LIBRARY_NAMES[i - getLibraryFunction(0)]);
+        } else {
+            writePos = insertName(writePos, RUNTIME_NAMES[i - getAllocatorFunction() - 1]);
+        }
+    }
+    patchSectionSize(subsectionSize);
+
+    //locals are named by their declarations.  Those the compiler made up are left unnamed
+    *writePos++ = 2; //local names subsection
+    subsectionSize = writePos;
+    writePos += SIZE_LENGTH;
+
+    u32 usedMethodCount = 0;
+    for (u32 i = 0; i < methodCount; ++i) {
+        usedMethodCount += functionIndices[getMethodFunction(i)] != -1;
+    }
+    writePos = insertVaruint(writePos, usedMethodCount);
+
+    for (u32 i = 0; i < methodCount; ++i) {
+        if (functionIndices[getMethodFunction(i)] == -1) {
+            continue;
+        }
+
+        writePos = insertVaruint(writePos, functionIndices[getMethodFunction(i)]);
+
+        u32 namedCount = 0;
+        for (u32 local = firstLocalName[i]; local < firstLocalName[i + 1]; ++local) {
+            namedCount += localNames[local] != 0;
+        }
+        writePos = insertVaruint(writePos, namedCount);
+
+        for (u32 local = firstLocalName[i]; local < firstLocalName[i + 1]; ++local) {
+            if (localNames[local]) {
+                writePos = insertVaruint(writePos, local - firstLocalName[i]);
+                writePos = insertQualifiedName(writePos, 0, localNames[local]);
+            }
+        }
+    }
+    patchSectionSize(subsectionSize);
+
+    patchSectionSize(nameSectionSize);
+    countSection(nameSection);
+}
+
+void insertLineTable() {
+    u8* lineSection = writePos;
+    *writePos++ = wasm::section::UserDefined;
+    u8* lineSectionSize = writePos;
+    writePos += SIZE_LENGTH;
+    INSERT_LIT("lines", writePos);
+    writePos = insertVaruint(writePos, lineEntryCount);
+
+    u32 offset = 0;
+    u32 line = 0;
+    for (u32 i = 0; i < lineEntryCount; ++i) {
+        writePos = insertVaruint(writePos, lineEntryOffsets[i] - offset);
+        writePos = insertVarint(writePos, (i64)lineEntryLines[i] - line);
+        offset = lineEntryOffsets[i];
+        line = lineEntryLines[i];
+    }
+
+    patchSectionSize(lineSectionSize);
+    countSection(lineSection);
+}
+
+//the classes of instructions in the size report
+struct opcodeClass {
+    enum {
+        Control,
+        Call,
+        Parametric,
+        Variable,
+        Memory,
+        Constant,
+        Numeric,
+        Conversion,
+        BulkMemory,
+        count
+    };
+};
+
+const char* OPCODE_CLASS_NAMES[opcodeClass::count] = {
+    "control",
+    "call",
+    "parametric",
+    "variable",
+    "memory",
+    "constant",
+    "numeric",
+    "conversion",
+    "bulkMemory",
+};
+
+//code on lines past the last of these is only counted in the totals
+const u32 MAX_REPORT_LINES = 2048;
+u32 lineOpcodeBytes[MAX_REPORT_LINES][opcodeClass::count];
+u32 opcodeBytes[opcodeClass::count];
+
+u32 readVaruint(u8*& pos) {
+    u32 value = 0;
+    u32 shift = 0;
+    u8 byte;
+    do {
+        byte = *pos++;
+        value |= (u32)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    return value;
+}
+
+//the class of the instruction at pos, which is left after it.  Signed immediates are skipped
+//like unsigned ones
+u32 decodeInstruction(u8*& pos) {
+    u8 op = *pos++;
+
+    switch (op) {
+        case wasm::block:
+        case wasm::loop:
+        case wasm::_if:
+        case wasm::br:
+        case wasm::br_if:
+            readVaruint(pos);
+            return opcodeClass::Control;
+        case wasm::br_table: {
+            u32 targetCount = readVaruint(pos);
+            for (u32 i = 0; i <= targetCount; ++i) {
+                readVaruint(pos);
+            }
+            return opcodeClass::Control;
+        }
+        case wasm::call:
+            readVaruint(pos);
+            return opcodeClass::Call;
+        case wasm::call_indirect:
+            readVaruint(pos);
+            ++pos; //table index
+            return opcodeClass::Call;
+        case wasm::drop:
+        case wasm::select:
+            return opcodeClass::Parametric;
+        case wasm::get_local:
+        case wasm::set_local:
+        case wasm::tee_local:
+        case wasm::get_global:
+        case wasm::set_global:
+            readVaruint(pos);
+            return opcodeClass::Variable;
+        case wasm::memory_size:
+        case wasm::memory_grow:
+            ++pos; //memory index
+            return opcodeClass::Memory;
+        case wasm::i32_const:
+        case wasm::i64_const:
+            readVaruint(pos);
+            return opcodeClass::Constant;
+        case wasm::f32_const:
+            pos += 4;
+            return opcodeClass::Constant;
+        case wasm::f64_const:
+            pos += 8;
+            return opcodeClass::Constant;
+        case wasm::misc_prefix: {
+            u32 miscOp = readVaruint(pos);
+            pos += 2 * (miscOp == wasm::misc::memory_copy) + (miscOp == wasm::misc::memory_fill);
+            return miscOp >= wasm::misc::memory_copy ? opcodeClass::BulkMemory : opcodeClass::Conversion;
+        }
+    }
+
+    if (op >= wasm::i32_load && op < wasm::memory_size) {
+        readVaruint(pos); //alignment
+        readVaruint(pos); //offset
+        return opcodeClass::Memory;
+    } else if (op >= wasm::i32_wrap_from_i64 && op <= wasm::f64_reinterpret_from_i64) {
+        return opcodeClass::Conversion;
+    } else if (op >= wasm::i32_eqz) {
+        return opcodeClass::Numeric;
+    }
+    return opcodeClass::Control;
+}
+
+void reportText(const char* text) {
+    while (*text) {
+        *writePos++ = *text++;
+    }
+}
+
+void reportIdentifier(const char* name) {
+    u32 length = getIdentifierLength(name);
+    for (u32 i = 0; i < length; ++i) {
+        *writePos++ = name[i];
+    }
+}
+
+void reportNumber(u32 value) {
+    char digits[10];
+    u32 digitCount = 0;
+    do {
+        digits[digitCount++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+
+    while (digitCount > 0) {
+        *writePos++ = digits[--digitCount];
+    }
+}
+
+//a "name": number pair, after a comma unless it's the first of its object
+void reportField(const char* name, u32 value, bool isFirst = false) {
+    reportText(isFirst ? "\"" : ",\"");
+    reportText(name);
+    reportText("\":");
+    reportNumber(value);
+}
+
+//an object of the bytes of each class of instruction, without those there are none of
+void reportOpcodeBytes(u32* bytes) {
+    *writePos++ = '{';
+    bool isFirst = true;
+    for (u32 i = 0; i < opcodeClass::count; ++i) {
+        if (bytes[i] > 0) {
+            reportField(OPCODE_CLASS_NAMES[i], bytes[i], isFirst);
+            isFirst = false;
+        }
+    }
+    *writePos++ = '}';
+}
+
+void insertSizeReport(u8* module) {
+    const char* sectionNames[wasm::section::Data + 1] = {
+        "custom", "type", "import", "function", "table", "memory", "global", "export", "start", "element", "code", "data",
+    };
+
+    for (u32 line = 0; line < MAX_REPORT_LINES; ++line) {
+        for (u32 i = 0; i < opcodeClass::count; ++i) {
+            lineOpcodeBytes[line][i] = 0;
+        }
+    }
+    for (u32 i = 0; i < opcodeClass::count; ++i) {
+        opcodeBytes[i] = 0;
+    }
+
+    reportText("{");
+    reportField("moduleBytes", stats.moduleBytes, true);
+    reportField("dataBytes", initialDataSize);
+
+    reportText(",\"sections\":{");
+    for (u32 i = 0; i <= wasm::section::Data; ++i) {
+        reportField(sectionNames[i], stats.sectionBytes[i], i == 0);
+    }
+
+    //each function's code is attributed to the line of the line entry before it, or to its
+    //method's line before its first entry
+    reportText("},\"functions\":[");
+    u8* body = module + linkedCodeOffset;
+    u32 lineEntry = 0;
+    bool isFirst = true;
+
+    for (u32 i = 0; i < getDefinedFunctionCount(); ++i) {
+        u32 function = FIRST_DEFINED_FUNCTION + i;
+        if (functionIndices[function] == -1) {
+            continue;
+        }
+
+        u8* pos = body;
+        u32 bodySize = readVaruint(pos);
+        u8* end = pos + bodySize;
+
+        u32 localEntryCount = readVaruint(pos);
+        u32 localCount = 0;
+        for (u32 entry = 0; entry < localEntryCount; ++entry) {
+            localCount += readVaruint(pos);
+            ++pos; //type
+        }
+        u32 localBytes = pos - body - 2;
+
+        u32 line = 0;
+        reportText(isFirst ? "{\"name\":\"" : ",{\"name\":\"");
+        if (function < getAllocatorFunction()) {
+            Method& m = methods[i];
+            reportIdentifier(classes[m.classIndex].name);
+            *writePos++ = '.';
+            reportIdentifier(findMethodName(m));
+            line = m.parameterList ? findLine(m.parameterList) : 0;
+        } else if (function == getAllocatorFunction()) {
+            reportText("allocate");
+        } else if (function >= getLibraryFunction(0)) {
+            reportText(LIBRARY_NAMES[function - getLibraryFunction(0)]);
+        } else {
+            reportText(RUNTIME_NAMES[function - getAllocatorFunction() - 1]);
+        }
+        *writePos++ = '"';
+
+        if (line > 0) {
+            reportField("line", line);
+        }
+        reportField("bytes", end - body);
+        reportField("localDeclarationBytes", localBytes);
+        reportField("locals", localCount);
+        *writePos++ = '}';
+        isFirst = false;
+
+        while (pos < end) {
+            while (lineEntry < lineEntryCount && module + lineEntryOffsets[lineEntry] <= pos) {
+                line = lineEntryLines[lineEntry++];
+            }
+
+            u8* instruction = pos;
+            u32 opClass = decodeInstruction(pos);
+            opcodeBytes[opClass] += pos - instruction;
+            if (line > 0 && line < MAX_REPORT_LINES) {
+                lineOpcodeBytes[line][opClass] += pos - instruction;
+            }
+        }
+
+        body = end;
+    }
+
+    reportText("],\"opcodes\":");
+    reportOpcodeBytes(opcodeBytes);
+
+    reportText(",\"lines\":[");
+    isFirst = true;
+    for (u32 line = 1; line < MAX_REPORT_LINES; ++line) {
+        u32 bytes = 0;
+        for (u32 i = 0; i < opcodeClass::count; ++i) {
+            bytes += lineOpcodeBytes[line][i];
+        }
+        if (bytes == 0) {
+            continue;
+        }
+
+        reportText(isFirst ? "{" : ",{");
+        reportField("line", line, true);
+        reportField("bytes", bytes);
+        reportText(",\"opcodes\":");
+        reportOpcodeBytes(lineOpcodeBytes[line]);
+        *writePos++ = '}';
+        isFirst = false;
+    }
+
+    //literals with the same characters share their data, which the first of them is charged for
+    reportText("],\"strings\":[");
+    for (u32 i = 0; i < stringLiteralCount; ++i) {
+        u32 offset = stringLiteralDataOffset[i];
+        u32 bytes = 0;
+        u32 first = 0;
+        while (stringLiteralDataOffset[first] != offset) {
+            ++first;
+        }
+
+        if (first == i) {
+            u8* str = dataStart + offset;
+            bytes = string::chars + (loadU32(str + string::length) << loadU32(str + string::coder));
+        }
+
+        reportText(i == 0 ? "{" : ",{");
+        reportField("line", findLine(stringLiteralSourcePos[i]), true);
+        reportField("bytes", bytes);
+        *writePos++ = '}';
+    }
+    reportText("]}");
+}
+
+void beginBlockScope() {
+    if (blockDepth > 0 && blockDepth <= MAX_BLOCK_DEPTH) {
+        blockStackSaves[blockDepth - 1] = blockStackSave;
+    }
+    ++blockDepth;
+    blockStackSave = -1;
+}
+
+void endBlockScope() {
+    //free the objects this block allocated on the stack
+    if (blockStackSave != -1) {
+        emitStackRestore(blockStackSave);
+    }
+
+    --blockDepth;
+    blockStackSave = blockDepth > 0 && blockDepth <= MAX_BLOCK_DEPTH ? blockStackSaves[blockDepth - 1] : -1;
+}
+
+void compileBlock() {
+    beginBlockScope();
+    nextToken();
+
+    //don't read past the end of the input string in the event of malformed Java
+    while (tok.kind != token::End && !isSymbol('}')) {
+        compileStatement();
+    }
+
+    endBlockScope();
+    nextToken();
+}
+
+void compileStaticInitializers() {
+    inStaticContext = true;
+
+    for (u32 i = 0; i < staticInitializerCount; ++i) {
+        rewindTo(staticInitializerPos[i]);
+        u32 varIndex = staticInitializerVar[i];
+        currentClass = staticInitializerClass[i];
+
+        if (varIndex == -1) {
+            compileBlock();
+        } else {
+            exprCount = 1;
+            releaseScratchLocals();
+            emitExpressionAs(parseExpression(), varTypes[varIndex]);
+            emitSetVar(varIndex);
+        }
+    }
+}
+
+//the method a call refers to, if it can be known without knowing the type of any expression
+u32 findCalledMethod(u32 classIndex, Token& name, bool isNew, u32 argCount) {
+    if (isNew) {
+        u32 newClass = findClass(name.hash);
+        return newClass != -1 ? findMethod(newClass, HASH("<init>"), argCount) : -1;
+    }
+
+    u32 nameStart = name.length;
+    while (nameStart > 0 && name.start[nameStart - 1] != '.') {
+        --nameStart;
+    }
+
+    if (nameStart > 0) {
+        classIndex = findClass(getIdentifierHash(name.start, nameStart - 1));
+        if (classIndex == -1) {
+            return -1;
+        }
+    }
+
+    return findMethod(classIndex, getIdentifierHash(name.start + nameStart, name.length - nameStart), argCount);
+}
+
+u8 findEscape(u32 hash, u32 classIndex, u32 contextClass, u32 depth);
+
+//how far an object passed to a method can be seen from outside of the method.  The
+//constructor's this is parameter -1
+u8 findParameterEscape(u32 methodIndex, u32 param, u32 depth) {
+    Method& m = methods[methodIndex];
+    u8 type = param == -1 ? java::type::firstClass + m.classIndex : paramTypes[m.firstParam + param];
+    u32 names[256];
+
+    if (depth > MAX_ANALYSIS_DEPTH || type < java::type::firstClass) {
+        return escape::Global;
+    }
+
+    //field initializers don't let this escape
+    if (!m.parameterList) {
+        return escape::None;
+    }
+
+    char* resumePos = readPos;
+    Token resumeTok = tok;
+    u8 result = escape::Global;
+
+    char* body = findParameterNames(m, names);
+    if (body) {
+        rewindTo(body);
+        nextToken();
+        result = findEscape(param == -1 ? HASH("this") : names[param], type - java::type::firstClass, m.classIndex, depth);
+    }
+
+    readPos = resumePos;
+    tok = resumeTok;
+    return result;
+}
+
+//scan from tok to the end of the enclosing block for uses of the object named by hash, which
+//is an instance of classIndex.  The code scanned belongs to contextClass
+u8 findEscape(u32 hash, u32 classIndex, u32 contextClass, u32 depth) {
+    struct CallSite {
+        Token name;     //of the called method.  Empty for parenthesis that aren't a call
+        bool isNew;
+        u32 argIndex;
+        u32 objectArgs; //a bit for each argument that is the object
+    };
+
+    const u32 MAX_CALL_DEPTH = 16;
+    CallSite calls[MAX_CALL_DEPTH];
+    u32 callDepth = 0;
+    u32 braceDepth = 0;
+    u8 result = escape::None;
+    Token prevPrev = {0};
+    Token prev = {0};
+
+    while (tok.kind != token::End) {
+        //decide how prev uses the object now that the tokens on both sides of it are known
+        if (prev.kind == token::Identifier) {
+            u32 length = 0;
+            while (length < prev.length && prev.start[length] != '.') {
+                ++length;
+            }
+
+            if (getIdentifierHash(prev.start, length) == hash) {
+                if (length == prev.length) {
+                    //the object itself may only be an argument of a call
+                    bool isBetweenArgs = prevPrev.kind == token::Symbol && prevPrev.length == 1 &&
+                            (*prevPrev.start == '(' || *prevPrev.start == ',') && (isSymbol(',') || isSymbol(')'));
+
+                    if (!isBetweenArgs || callDepth == 0 || callDepth > MAX_CALL_DEPTH ||
+                            calls[callDepth - 1].name.length == 0 || calls[callDepth - 1].argIndex >= 32) {
+                        return escape::Global;
+                    }
+
+                    calls[callDepth - 1].objectArgs |= 1 << calls[callDepth - 1].argIndex;
+                } else {
+                    //calling a method of the object passes it as this
+                    u32 fieldEnd = length + 1;
+                    while (fieldEnd < prev.length && prev.start[fieldEnd] != '.') {
+                        ++fieldEnd;
+                    }
+
+                    u32 fieldHash = getIdentifierHash(prev.start + length + 1, fieldEnd - length - 1);
+                    if (findField(classIndex, fieldHash) == -1 || (fieldEnd == prev.length && isSymbol('('))) {
+                        return escape::Global;
+                    }
+                }
+            }
+        }
+
+        if (isSymbol('{')) {
+            ++braceDepth;
+        } else if (isSymbol('}')) {
+            if (braceDepth == 0) {
+                break;
+            }
+            --braceDepth;
+        } else if (isSymbol('(')) {
+            if (callDepth < MAX_CALL_DEPTH) {
+                CallSite& call = calls[callDepth];
+                call.name = prev.kind == token::Identifier ? prev : Token{0};
+                call.isNew = prevPrev.kind == token::Identifier && prevPrev.hash == HASH("new");
+                call.argIndex = 0;
+                call.objectArgs = 0;
+            }
+            ++callDepth;
+        } else if (isSymbol(',') && callDepth > 0 && callDepth <= MAX_CALL_DEPTH) {
+            ++calls[callDepth - 1].argIndex;
+        } else if (isSymbol(')') && callDepth > 0) {
+            --callDepth;
+            CallSite& call = calls[callDepth];
+
+            if (callDepth < MAX_CALL_DEPTH && call.name.length > 0) {
+                bool hasArgs = prev.kind != token::Symbol || prev.length != 1 || *prev.start != '(';
+                u32 methodIndex = findCalledMethod(contextClass, call.name, call.isNew, call.argIndex + hasArgs);
+
+                //unqualified calls to instance methods pass this
+                bool isUnqualified = !call.isNew;
+                for (u32 i = 0; i < call.name.length; ++i) {
+                    isUnqualified &= call.name.start[i] != '.';
+                }
+
+                if (hash == HASH("this") && isUnqualified && methodIndex != -1 && !methods[methodIndex].isStatic) {
+                    return escape::Global;
+                }
+
+                if (call.objectArgs) {
+                    //a call that may run one of several methods can't be followed into them
+                    if (methodIndex != -1 && !call.isNew && !methods[methodIndex].isStatic) {
+                        methodIndex = findDirectTarget(contextClass, methodIndex);
+                    }
+
+                    if (methodIndex == -1) {
+                        return escape::Global;
+                    }
+
+                    for (u32 i = 0; i < 32; ++i) {
+                        if ((call.objectArgs & (1 << i)) && findParameterEscape(methodIndex, i, depth + 1) == escape::Global) {
+                            return escape::Global;
+                        }
+                    }
+
+                    result = escape::Callee;
+                }
+            }
+        }
+
+        prevPrev = prev;
+        prev = tok;
+        nextToken();
+    }
+
+    return result;
+}
+
+//whether a block returns from anywhere within it.  tok must be its '{'
+bool hasReturn() {
+    u32 depth = 0;
+    do {
+        if (isSymbol('{')) {
+            ++depth;
+        } else if (isSymbol('}')) {
+            --depth;
+        } else if (tok.kind == token::Identifier && tok.hash == HASH("return")) {
+            return true;
+        }
+        nextToken();
+    } while (tok.kind != token::End && depth > 0);
+
+    return false;
+}
+
+//how far the new object a local is initialized with can be seen from outside of the local's
+//scope.  canInline is set when its constructor can be compiled into the code creating it.
+//tok must be the first token of the initializer, and is left there
+u8 findDeclarationEscape(u32 varIndex, u32& constructor, bool& canInline) {
+    u8 type = varTypes[varIndex];
+    char* initializer = tok.start;
+    constructor = -1;
+    canInline = false;
+
+    if (!isMethodOptimized || type < java::type::firstClass || tok.hash != HASH("new") || inlineDepth >= MAX_ANALYSIS_DEPTH) {
+        return escape::Global;
+    }
+
+    //the constructors of superclasses and instance initializers aren't analyzed
+    u32 classIndex = type - java::type::firstClass;
+    if (classes[classIndex].superclass != -1 || hasInstanceInitializer(classIndex)) {
+        return escape::Global;
+    }
+
+    nextToken();
+    if (tok.kind != token::Identifier || findClass(tok.hash) != classIndex) {
+        rewindTo(initializer);
+        return escape::Global;
+    }
+
+    //count the arguments of the constructor
+    nextToken();
+    u32 argCount = 0;
+    u32 depth = 0;
+    do {
+        if (isSymbol('(') || isSymbol('[') || isSymbol('{')) {
+            ++depth;
+        } else if (isSymbol(')') || isSymbol(']') || isSymbol('}')) {
+            --depth;
+        } else if (argCount == 0 || (depth == 1 && isSymbol(','))) {
+            ++argCount;
+        }
+        nextToken();
+    } while (tok.kind != token::End && depth > 0);
+
+    //the local must be the only thing that refers to the object
+    u8 result = escape::Global;
+    if (isSymbol(';') || isSymbol(',')) {
+        result = findEscape(varHashes[varIndex], classIndex, currentClass, 0);
+    }
+
+    constructor = findMethod(classIndex, HASH("<init>"), argCount);
+    canInline = constructor != -1 || argCount == 0;
+
+    if (constructor != -1 && result != escape::Global) {
+        u8 thisEscape = findParameterEscape(constructor, -1, 1);
+        result = thisEscape > result ? thisEscape : result;
+
+        //a return in the constructor would return from the code it's inlined into
+        char* body = methods[constructor].parameterList ? findParameterNames(methods[constructor], parameterNames) : 0;
+        if (body) {
+            rewindTo(body);
+            canInline = !hasReturn();
+        }
+    }
+
+    rewindTo(initializer);
+    return result;
+}
+
+//compile a new object into a local for each of its fields, with its constructor inlined.
+//tok must be the new.  tok is left after the constructor's arguments
+void compileScalarReplacement(u32 varIndex, u32 constructor) {
+    u32 classIndex = varTypes[varIndex] - java::type::firstClass;
+    Class& c = classes[classIndex];
+
+    //new objects start out zeroed
+    varFirstScalar[varIndex] = totalVarCount;
+    for (u32 i = c.firstField; i < c.firstField + c.fieldCount; ++i) {
+        u32 fieldVar = addLocal(HIDDEN_HASH, fields[i].type);
+
+        emitConst(fields[i].type, 0, 0.0);
+        emitSetVar(fieldVar);
+    }
+
+    //the arguments are evaluated into the locals of the constructor's parameters.  They're
+    //named once every argument is evaluated, so they don't hide the caller's variables
+    Method* m = constructor != -1 ? &methods[constructor] : 0;
+    u32 firstParam = totalVarCount;
+    nextToken(); //new
+    nextToken(); //the class name
+    nextToken(); //(
+
+    for (u32 param = 0; m && param < m->paramCount && tok.kind != token::End && !isSymbol(')'); ++param) {
+        exprCount = 1;
+        releaseScratchLocals();
+
+        u32 paramVar = addLocal(HIDDEN_HASH, paramTypes[m->firstParam + param]);
+        emitExpressionAs(parseExpression(), varTypes[paramVar]);
+        emitSetVar(paramVar);
+
+        if (isSymbol(',')) {
+            nextToken();
+        }
+    }
+
+    nextToken(); //)
+    char* resumePos = tok.start;
+
+    //this refers to the same locals as the local being declared
+    u32 thisVar = addLocal(HASH("this"), varTypes[varIndex]);
+    varFirstScalar[thisVar] = varFirstScalar[varIndex];
+
+    u32 callerClass = currentClass;
+    bool callerIsStatic = inStaticContext;
+    u8 callerReturnType = currentReturnType;
+    currentClass = classIndex;
+    inStaticContext = false;
+    ++inlineDepth;
+
+    compileFieldInitializers(classIndex);
+
+    if (m) {
+        char* body = findParameterNames(*m, parameterNames);
+        for (u32 i = 0; i < m->paramCount; ++i) {
+            varHashes[firstParam + i] = parameterNames[i];
+        }
+
+        if (body) {
+            rewindTo(body);
+            compileBlock();
+        }
+
+        //the parameters go out of scope
+        for (u32 i = 0; i < m->paramCount; ++i) {
+            varHashes[firstParam + i] = HIDDEN_HASH;
+        }
+    }
+
+    varHashes[thisVar] = HIDDEN_HASH;
+    currentClass = callerClass;
+    inStaticContext = callerIsStatic;
+    currentReturnType = callerReturnType;
+    --inlineDepth;
+
+    rewindTo(resumePos);
+}
+
+//compile a declaration of the given type, starting from the first declared name
+void compileDeclaration(u8 type) {
+    while (tok.kind == token::Identifier) {
+        u32 varIndex = addLocal(tok.hash, type);
+        varNames[varIndex] = tok.start;
+
+        // PRINT_LIT("Local \"");
+        // puts(tok.start, tok.length);
+        // PRINT_LIT("\" index: ");
+        // puti32(varIndex);
+        // put('\n');
+
+        nextToken();
+        if (isSymbol('=')) {
+            nextToken();
+
+            bool canInline;
+            u32 constructor;
+            u8 objectEscape = findDeclarationEscape(varIndex, constructor, canInline);
+
+            if (objectEscape == escape::None && canInline) {
+                compileScalarReplacement(varIndex, constructor);
+            } else {
+                u16 value = parseExpression();
+                Expr& e = exprs[value];
+
+                if (objectEscape != escape::Global && e.kind == expr::New && classes[type - java::type::firstClass].size <= MAX_STACK_OBJECT_SIZE) {
+                    emitNew(e, true);
+                } else {
+                    emitExpressionAs(value, type);
+                }
+                emitSetVar(varIndex);
+            }
+        }
+
+        if (!isSymbol(',')) {
+            break;
+        }
+        nextToken();
+    }
+}
+
+//compile an assignment, compound assignment, or increment of a variable or field.  prefixOp
+//is the ++ or -- in front of the target, if any.  Returns false if tok isn't an assignment
+bool compileAssignment(u16 target, u32 prefixOp = 0) {
+    u8 kind = exprs[target].kind;
+    u8 type = exprs[target].type;
+    u32 op = prefixOp ? prefixOp : tok.hash;
+    u16 value;
+
+    if (kind != expr::Variable && kind != expr::FieldAccess) {
+        return false;
+    }
+
+    if (!prefixOp && tok.kind != token::Symbol) {
+        return false;
+    }
+
+    if (op == HASH("=") && !prefixOp) {
+        nextToken();
+        value = parseExpression();
+    } else if (op == HASH("++") || op == HASH("--")) {
+        if (!prefixOp) {
+            nextToken();
+        }
+
+        u16 one = newExpr(expr::Literal, wasm::type::i32);
+        exprs[one].intValue = 1;
+        value = one;
+        op = op == HASH("++") ? HASH("+") : HASH("-");
+    } else if (!prefixOp && tok.length >= 2 && tok.start[tok.length - 1] == '=' && op != HASH("==") &&
+               op != HASH("!=") && op != HASH("<=") && op != HASH(">=")) {
+        //x op= y is compiled as x = (type)(x op y)
+        op = getIdentifierHash(tok.start, tok.length - 1);
+        nextToken();
+        value = parseExpression();
+    } else {
+        return false;
+    }
+
+    //the object of a field is evaluated once, even though a compound assignment reads it too
+    if (kind == expr::FieldAccess) {
+        u16 object = exprs[target].lhs;
+        emitExpression(object);
+
+        if (op != HASH("=")) {
+            u32 objectLocal = acquireScratchLocal(wasm::type::i32);
+            emitLocal(wasm::tee_local, objectLocal);
+
+            u16 objectVar = newExpr(expr::Variable, exprs[object].type);
+            exprs[objectVar].varIndex = globalVarCount + objectLocal;
+            exprs[target].lhs = objectVar;
+        }
+    }
+
+    if (op != HASH("=")) {
+        value = makeBinary(op, target, value);
+    }
+
+    emitExpressionAs(value, type);
+
+    if (kind == expr::FieldAccess) {
+        emitFieldAccess(exprs[target].fieldIndex, true);
+    } else {
+        emitSetVar(exprs[target].varIndex);
+    }
+    return true;
+}
+
+//an assignment, increment, or any other expression evaluated for its side effects.  tok is
+//left on the token that ended it
+void compileExpressionStatement() {
+    char* startOfStatement = tok.start;
+    exprCount = 1;
+
+    if (tok.kind == token::Symbol && (tok.hash == HASH("++") || tok.hash == HASH("--"))) {
+        u32 op = tok.hash;
+        nextToken();
+        compileAssignment(parsePrimary(), op);
+        return;
+    }
+
+    u16 target = parsePrimary();
+    if (!compileAssignment(target)) {
+        rewindTo(startOfStatement);
+        exprCount = 1;
+        u16 e = parseExpression();
+        emitExpression(e);
+
+        if (exprs[e].type != wasm::type::_void) {
+            *writePos++ = wasm::drop;
+        }
+    }
+}
+
+//open a wasm block, loop or if that statements are compiled into
+void beginControl(u8 op) {
+    *writePos++ = op;
+    *writePos++ = wasm::type::_void;
+    ++controlDepth;
+}
+
+void endControl() {
+    *writePos++ = wasm::end;
+    --controlDepth;
+}
+
+void emitBranch(u32 level) {
+    *writePos++ = wasm::br;
+    writePos = insertVaruint(writePos, controlDepth - level);
+}
+
+void pushJumpTarget(u32 breakLevel, u32 continueLevel) {
+    if (jumpTargetCount < MAX_JUMP_TARGETS) {
+        jumpTargets[jumpTargetCount] = {breakLevel, continueLevel, blockDepth};
+    }
+    ++jumpTargetCount;
+}
+
+bool isKeyword(u32 hash) {
+    return tok.kind == token::Identifier && tok.hash == hash;
+}
+
+//compile the arms of an if statement.  tok must be the first token of the statement run when
+//condition is true.  Conditions with && or || branch to the else arm as soon as they're known
+//to be false
+void compileIf(u16 condition, char* startOfStatement) {
+    char* thenArm = tok.start;
+    skipStatement();
+    char* elseArm = isKeyword(HASH("else")) ? tok.start : 0;
+    rewindTo(thenArm);
+
+    if (!isShortCircuit(condition)) {
+        emitConditionValue(condition, false);
+        beginControl(wasm::_if);
+        emitProfileCounter(profile::BranchArm, startOfStatement);
+        compileStatement();
+
+        if (elseArm) {
+            nextToken(); //else
+            *writePos++ = wasm::_else;
+            emitProfileCounter(profile::BranchArm, elseArm);
+            compileStatement();
+        }
+
+        endControl();
+        return;
+    }
+
+    if (elseArm) {
+        beginControl(wasm::block);
+    }
+    beginControl(wasm::block);
+    emitBranchIf(condition, false, 0);
+    emitProfileCounter(profile::BranchArm, startOfStatement);
+    compileStatement();
+
+    if (elseArm) {
+        emitBranch(controlDepth - 1);
+        endControl();
+
+        nextToken(); //else
+        emitProfileCounter(profile::BranchArm, elseArm);
+        compileStatement();
+    }
+    endControl();
+}
+
+//compile a while, for or do loop.  tok must be its keyword.  The loop is in a block that break
+//jumps to the end of, and continue jumps to the end of the body
+void compileLoop() {
+    u32 kind = tok.hash;
+    char* startOfStatement = tok.start;
+    nextToken();
+
+    //a for loop's variables are declared before it starts
+    char* conditionPos = 0;
+    char* updatePos = 0;
+    if (kind == HASH("for")) {
+        nextToken();
+        if (isSymbol(';')) {
+            nextToken();
+        } else {
+            compileStatement();
+        }
+
+        conditionPos = tok.start;
+        skipPast(';');
+        updatePos = tok.start;
+        while (tok.kind != token::End && !isSymbol(')')) {
+            if (isSymbol('(')) {
+                skipParenthesis();
+            } else {
+                nextToken();
+            }
+        }
+        nextToken();
+    } else if (kind == HASH("while")) {
+        char* openingParenthesis = tok.start;
+        nextToken();
+        conditionPos = tok.start;
+        rewindTo(openingParenthesis);
+        skipParenthesis();
+    }
+
+    beginControl(wasm::block);
+    u32 breakLevel = controlDepth;
+    beginControl(wasm::loop);
+    u32 loopLevel = controlDepth;
+
+    //while and for loops leave before the body once the condition is false
+    if (conditionPos) {
+        char* bodyPos = tok.start;
+        rewindTo(conditionPos);
+        exprCount = 1;
+        releaseScratchLocals();
+
+        if (!isSymbol(';')) {
+            u16 condition = parseExpression();
+            if (exprs[condition].kind != expr::Literal || !exprs[condition].intValue) {
+                emitBranchIf(condition, false, controlDepth - breakLevel);
+            }
+        }
+        rewindTo(bodyPos);
+    }
+
+    beginControl(wasm::block);
+    pushJumpTarget(breakLevel, controlDepth);
+    compileStatement();
+    --jumpTargetCount;
+    endControl();
+    char* afterBody = tok.start;
+
+    //the end of each iteration is a back edge
+    if (updatePos) {
+        rewindTo(updatePos);
+        while (tok.kind != token::End && !isSymbol(')')) {
+            releaseScratchLocals();
+            compileExpressionStatement();
+            if (isSymbol(',')) {
+                nextToken();
+            }
+        }
+        rewindTo(afterBody);
+    }
+
+    emitProfileCounter(profile::BackEdge, startOfStatement);
+    emitFuelCheck();
+
+    if (kind == HASH("do")) {
+        nextToken(); //while
+        nextToken(); //opening parenthesis
+        exprCount = 1;
+        releaseScratchLocals();
+        emitBranchIf(parseExpression(), true, controlDepth - loopLevel);
+        skipPast(';');
+    } else {
+        emitBranch(loopLevel);
+    }
+
+    endControl();
+    endControl();
 }
 
-constexpr bool isdigit(char c) {
-    return c >= '0' && c <= '9';
-}
+//compile break or continue, which jump out of the innermost loop, or switch for break
+void compileJump(bool isContinue) {
+    u32 i = jumpTargetCount < MAX_JUMP_TARGETS ? jumpTargetCount : MAX_JUMP_TARGETS;
+    while (i > 0 && isContinue && jumpTargets[i - 1].continueLevel == -1) {
+        --i;
+    }
 
-constexpr bool isValidLeadingIDChar(char c) {
-    return isalpha(c) || c == '_';
-}
+    if (i == 0) {
+        return;
+    }
 
-constexpr bool isValidNonLeadingIDChar(char c) {
-    return isValidLeadingIDChar(c) || isdigit(c);
+    JumpTarget& target = jumpTargets[i - 1];
+    emitStackRestoreFrom(target.blockDepth);
+    emitBranch(isContinue ? target.continueLevel : target.breakLevel);
 }
 
-constexpr float stof(char* c, u32 length);
+//jump to the group of statements matching the value in the local.  Group i starts where the
+//block i levels out ends.  Values outside the cases jump defaultDepth levels out.  extraDepth
+//counts the blocks the search itself opened
+void emitSwitchSearch(u32 value, u32 first, u32 end, u32 defaultDepth, u32 extraDepth) {
+    //a few cases are compared one by one
+    if (end - first <= 4) {
+        for (u32 i = first; i < end; ++i) {
+            emitLocal(wasm::get_local, value);
+            if (switchCaseValues[i] == 0) {
+                *writePos++ = wasm::i32_eqz;
+            } else {
+                emitConst(wasm::type::i32, switchCaseValues[i], 0.0);
+                *writePos++ = wasm::i32_eq;
+            }
+            *writePos++ = wasm::br_if;
+            writePos = insertVaruint(writePos, switchCaseGroups[i] + extraDepth);
+        }
 
-char* findNextIdentifier(char *p) {
-    //find where identifier begins
-    while (!isValidLeadingIDChar(*p)) {
-        ++p;
-    };
+        *writePos++ = wasm::br;
+        writePos = insertVaruint(writePos, defaultDepth + extraDepth);
+        return;
+    }
 
-    return p;
+    //otherwise the lower half is searched when the value is below the middle case
+    u32 middle = first + (end - first) / 2;
+    emitLocal(wasm::get_local, value);
+    emitConst(wasm::type::i32, switchCaseValues[middle], 0.0);
+    *writePos++ = wasm::i32_lt_s;
+    *writePos++ = wasm::_if;
+    *writePos++ = wasm::type::_void;
+    emitSwitchSearch(value, first, middle, defaultDepth, extraDepth + 1);
+    *writePos++ = wasm::end;
+    emitSwitchSearch(value, middle, end, defaultDepth, extraDepth);
 }
 
-//assume p points to a the first character of a valid token (identifier or numeric literal)
-char* findTokenEnd(char* p) {
-    //decimal places separate identifiers, but join numeric literals
-    if (*p == '-' || *p == '.' || isdigit(*p)) {
-        do {
-            ++p;
-        } while (isdigit(*p) || *p == '.' || *p == 'f');
-    } else if (isValidLeadingIDChar(*p)) {
-        do {
-            ++p;
-        } while (isValidNonLeadingIDChar(*p) || *p == ':' || *p == '.'); //the : and . are temporary
-    } else {
-        //assume single character symbols like . and ,
-        ++p;
+//jump to the group of statements of the case matching the value in the local.  Cases that
+//span a dense range of values index a br_table.  Others are found by a binary search
+void emitSwitchDispatch(u32 value, u32 first, u32 end, u32 defaultDepth) {
+    u32 count = end - first;
+    i64 range = count > 0 ? (i64)switchCaseValues[end - 1] - switchCaseValues[first] + 1 : 0;
+
+    if (count < 4 || range > 3 * count || range > 0x1000) {
+        emitSwitchSearch(value, first, end, defaultDepth, 0);
+        return;
     }
 
-    return p;
+    i32 min = switchCaseValues[first];
+    emitLocal(wasm::get_local, value);
+    if (min != 0) {
+        emitConst(wasm::type::i32, min, 0.0);
+        *writePos++ = wasm::i32_sub;
+    }
+
+    *writePos++ = wasm::br_table;
+    writePos = insertVaruint(writePos, range);
+    u32 i = first;
+    for (i64 v = min; v < min + range; ++v) {
+        if (switchCaseValues[i] == v) {
+            writePos = insertVaruint(writePos, switchCaseGroups[i++]);
+        } else {
+            writePos = insertVaruint(writePos, defaultDepth);
+        }
+    }
+    writePos = insertVaruint(writePos, defaultDepth);
 }
 
-char* findNextIdentifierOrNumericLiteral(char* p) {
-    //find where identifier begins
-    while (p < endReadPos && !isValidNonLeadingIDChar(*p)) {
-        ++p;
-    };
+//compile the body of a switch.  tok must be its '{'.  Consecutive case labels start the same
+//group of statements.  Each group starts at the end of a block, innermost first, with the
+//dispatch inside of the innermost one.  Statements fall through into the next group
+void compileSwitch(u16 valueExpr) {
+    u32 value = acquireScratchLocal(wasm::type::i32);
+    emitExpressionAs(valueExpr, wasm::type::i32);
+    emitLocal(wasm::set_local, value);
+
+    //find the cases.  Objects allocated by the switch's own statements are freed when it ends
+    char* body = tok.start;
+    u32 firstCase = switchCaseCount;
+    u32 groupCount = 0;
+    u32 defaultGroup = -1;
+    bool isAfterLabel = false;
+    bool allocates = false;
+    u32 depth = 0;
+
+    nextToken();
+    while (tok.kind != token::End && (depth > 0 || !isSymbol('}'))) {
+        if (depth == 0 && (isKeyword(HASH("case")) || isKeyword(HASH("default")))) {
+            groupCount += !isAfterLabel;
+            isAfterLabel = true;
+
+            if (isKeyword(HASH("default"))) {
+                defaultGroup = groupCount - 1;
+                nextToken();
+            } else {
+                nextToken();
+                exprCount = 1;
+                Expr& label = exprs[parseExpression()];
+
+                if (label.kind != expr::Literal) {
+                    REPORT_ERROR("constant expression required");
+                    break;
+                }
 
-    return p;
-}
+                if (switchCaseCount == MAX_SWITCH_CASES) {
+                    REPORT_ERROR("too many switch cases");
+                    break;
+                }
 
-char* findNextOperator(char* p) {
-    //find where identifier begins
-    while (p < endReadPos && *readPos != '+' && *readPos != '-' && *readPos != '*' && *readPos != '/') {
-        ++readPos;
-    };
+                //keep the cases sorted by value
+                u32 i = switchCaseCount++;
+                for (; i > firstCase && switchCaseValues[i - 1] > (i32)label.intValue; --i) {
+                    switchCaseValues[i] = switchCaseValues[i - 1];
+                    switchCaseGroups[i] = switchCaseGroups[i - 1];
+                }
+                switchCaseValues[i] = label.intValue;
+                switchCaseGroups[i] = groupCount - 1;
+            }
 
-    return p;
-}
+            skipPast(':');
+            continue;
+        }
 
-char* findNextToken(char* p) {
-    while (p < endReadPos && (*p == ' ' || *p == '\n')) {
-        ++p;
-    }
+        if (isSymbol('(') || isSymbol('[') || isSymbol('{')) {
+            ++depth;
+        } else if (isSymbol(')') || isSymbol(']') || isSymbol('}')) {
+            --depth;
+        }
 
-    return p;
-}
+        allocates |= depth == 0 && isKeyword(HASH("new"));
+        isAfterLabel = false;
+        nextToken();
+    }
 
-u8 getWasmOpFromOperator(char c) {
-    //for the purposes of this hackathon, all types are assumed floats
-    switch (c) {
-        case '+':
-            return wasm::f32_add;
-        case '-':
-            return wasm::f32_sub;
-        case '*':
-            return wasm::f32_mul;
-        case '/':
-            return wasm::f32_div;
-        case '<':
-            return wasm::f32_lt;
-        case '>':
-            return wasm::f32_gt;
-        default:
-            return wasm::unreachable;
+    //the dispatch can skip the statements that would save the stack top, so it's saved first
+    beginControl(wasm::block);
+    u32 breakLevel = controlDepth;
+    pushJumpTarget(breakLevel, -1);
+    beginBlockScope();
+
+    if (allocates && usesAllocator) {
+        blockStackSave = addLocal(HIDDEN_HASH, wasm::type::i32) - globalVarCount;
+        *writePos++ = wasm::get_global;
+        writePos = insertVaruint(writePos, getStackTopGlobal());
+        emitLocal(wasm::set_local, blockStackSave);
     }
-}
 
-u8 getWasmTypeFromCppName(u32 hash) {
-    //for the purposes of this hackathon, assume no unsigned types and well formed programs
-    switch(hash) {
-        case HASH("int"):
-           return wasm::type::i32;
-        case HASH("long"):
-            return wasm::type::i64;
-        case HASH("float"):
-            return wasm::type::f32;
-        case HASH("double"):
-            return wasm::type::f64;
-        default:
-            return wasm::type::_void;
+    for (u32 i = 0; i < groupCount; ++i) {
+        beginControl(wasm::block);
     }
-}
 
-//readPos must be placed on the '(' character containing the func parameters
-void compileAndInsertFunction();
+    emitSwitchDispatch(value, firstCase, switchCaseCount, defaultGroup != -1 ? defaultGroup : groupCount);
+    switchCaseCount = firstCase;
 
-//readPos must be placed on the first character of a identifier or numeric literal
-void compileAndInsertIdentifierOrNumericLiteral(u32 totalVarCount);
+    rewindTo(body);
+    nextToken();
+    isAfterLabel = false;
 
-//readPos must be placed after the open parenthesis of a function call or after an equal sign
-//white space doesn't matter
-void compileExpression(u32 totalVarCount);
+    while (tok.kind != token::End && !isSymbol('}')) {
+        if (isKeyword(HASH("case")) || isKeyword(HASH("default"))) {
+            if (!isAfterLabel && controlDepth > breakLevel) {
+                endControl();
+                emitProfileCounter(profile::BranchArm, tok.start);
+            }
+            isAfterLabel = true;
+            skipPast(':');
+            continue;
+        }
 
-EXPORT u32 getWasmFromJava(char *sourceCode, u32 length)
-{
-    //start placing the compiled output immediately after the input
-    readPos = sourceCode;
-    endReadPos = sourceCode + length;
-    writePos = (u8*) (sourceCode + length);
+        isAfterLabel = false;
+        compileStatement();
+    }
 
-    //scan source code and add all string literals to the data section
-    while (readPos < endReadPos) {
-        if (*readPos == '"') {
-            ++readPos;
+    endBlockScope();
+    --jumpTargetCount;
+    nextToken();
+    endControl();
+}
 
-            while (readPos < endReadPos && *readPos != '"') {
-                *writePos++ = *readPos++;
+void compileStatement() {
+    //every statement starts with an empty expression pool
+    exprCount = 1;
+    releaseScratchLocals();
+    addLineEntry(tok.start);
+
+    if (tok.kind == token::Identifier) {
+        u32 hash = tok.hash;
+        char* startOfStatement = tok.start;
+        u8 type = getTypeFromName(hash);
+        nextToken();
+
+        if (hash == HASH("final")) {
+            //modifiers don't affect code generation
+            return;
+        } else if (hash == HASH("super") && isSymbol('(')) {
+            //the superclass's constructor was called before the field initializers
+        } else if (type != wasm::type::_void && tok.kind == token::Identifier) {
+            //if the identifier on the beginning of the line is a type name, then declare
+            //a variable of that type with the following identifier as its name/hash
+            compileDeclaration(type);
+        } else if (hash == HASH("Scanner")) {
+            //DEBUG ignore this line for now
+        } else if (hash == HASH("return")) {
+            if (!isSymbol(';')) {
+                emitExpressionAs(parseExpression(), currentReturnType);
             }
-        }
 
-        ++readPos;
+            emitStackRestoreFrom(0);
+            *writePos++ = wasm::_return;
+        } else if (hash == HASH("if")) {
+            //set read position to one char past the open parenthesis
+            nextToken();
+            u16 condition = parseExpression();
+            nextToken(); //closing parenthesis
+            compileIf(condition, startOfStatement);
+            return;
+        } else if (hash == HASH("System.out.println") || hash == HASH("System.out.print")) {
+            nextToken();
+            if (!isSymbol(')')) {
+                emitPrint(parseExpression());
+            }
+            nextToken(); //closing parenthesis
+
+            //println prints a '\n' at the end of its call
+            if (hash == HASH("System.out.println")) {
+                *writePos++ = wasm::i32_const;
+                *writePos++ = '\n';
+                emitCallTo(host::put);
+            }
+        } else if (hash == HASH("while") || hash == HASH("for") || hash == HASH("do")) {
+            rewindTo(startOfStatement);
+            compileLoop();
+            return;
+        } else if (hash == HASH("break") || hash == HASH("continue")) {
+            compileJump(hash == HASH("continue"));
+        } else if (hash == HASH("switch")) {
+            nextToken();
+            u16 value = parseExpression();
+            nextToken(); //closing parenthesis
+            compileSwitch(value);
+            return;
+        } else {
+            rewindTo(startOfStatement);
+            compileExpressionStatement();
+        }
+    } else if (tok.kind == token::Symbol && (tok.hash == HASH("++") || tok.hash == HASH("--"))) {
+        compileExpressionStatement();
+    } else if (isSymbol('{')) {
+        compileBlock();
+        return;
+    } else if (!isSymbol(';')) {
+        REPORT_ERROR("unsupported statement");
+        return;
     }
 
-    //reset the counter in case this module is reused.
-    initialDataSize = 0;
-    globalVarCount = 0;
+    //skip to the end of the statement
+    skipPast(';');
+}
 
-    //begin the outputted program with the 8 byte wasm header
-    for (int i = 0; i < 8; ++i) {
-        *writePos++ = WASM_HEADER[i];
+//integer literals may be hex, octal or binary, and wrap around like Java's do
+u64 parseInteger(char* c, char* end) {
+    u32 radix = 10;
+    if (end - c > 1 && c[0] == '0') {
+        char prefix = c[1] | 0x20; //lower case
+        radix = prefix == 'x' ? 16 : prefix == 'b' ? 2 : 8;
+        c += radix == 8 ? 1 : 2;
     }
 
-    *writePos++ = wasm::section::Type;
-    u8 *typeSectionSize = writePos;
-    *writePos++ = 0;
-    *writePos++ = 0;
-    *writePos++ = 5; //# of func headers defined
-
-    *writePos++ = wasm::type::func;
-    *writePos++ = 0;
-    *writePos++ = 0;
-
-    *writePos++ = wasm::type::func;
-    *writePos++ = 1;
-    *writePos++ = wasm::type::f32;
-    *writePos++ = 0;
-    
-    *writePos++ = wasm::type::func;
-    *writePos++ = 1;
-    *writePos++ = wasm::type::i32;
-    *writePos++ = 0;
-    
-    *writePos++ = wasm::type::func;
-    *writePos++ = 2;
-    *writePos++ = wasm::type::i32;
-    *writePos++ = wasm::type::i32;
-    *writePos++ = 0;
-    
-    *writePos++ = wasm::type::func;
-    *writePos++ = 0;
-    *writePos++ = 1;
-    *writePos++ = wasm::type::f32;
-
-    u32 size = writePos - typeSectionSize - 2;
-    typeSectionSize[0] = (size & 0x7F) | 0x80;
-    typeSectionSize[1] = size >> 7;
-    // PRINT_LIT("Finished Type section\n");
+    u64 value = 0;
+    for (; c < end; ++c) {
+        if (*c != '_') {
+            value = value * radix + (isdigit(*c) ? *c - '0' : (*c | 0x20) - 'a' + 10);
+        }
+    }
 
+    return value;
+}
 
-    *writePos++ = wasm::section::Import;
-    u8 *importSectionSize = writePos;
-    *writePos++ = 0x80; //bytes belong to this section (patched further down)
-    *writePos++ = 4; //# functions to import
+//floating point literals are rounded to the closest float or double, ties to even.  Most are
+//converted with one double operation (Clinger's fast path), or by multiplying their first 19
+//digits by the 128 most significant bits of a power of 5 (Eisel-Lemire).  Those with more
+//digits than that which Eisel-Lemire can't decide between two floats for, are converted
+//digit by digit
+struct FloatFormat {
+    u32 mantissaBits;       //not counting the implicit leading 1
+    i32 minExponent;        //of the smallest normal float, minus 1
+    u32 infiniteExponent;   //the biased exponent of infinity
+    i32 minPower;           //powers of 10 past which every significand rounds to 0 or infinity
+    i32 maxPower;
+    i32 minRoundToEvenPower;    //powers of 10 whose products can be exactly halfway between floats
+    i32 maxRoundToEvenPower;
+    i32 maxExactPower;      //the largest power of 10, and significand, that are exact floats
+    u64 maxExactSignificand;
+};
 
-    INSERT_LIT("env", writePos);
-    INSERT_LIT("putf32", writePos);
-    *writePos++ = wasm::external::Function;
-    *writePos++ = 1; //use the function signature: (f32) => (void)
+const FloatFormat DOUBLE_FORMAT = {52, -1023, 0x7FF, -342, 308, -4, 23, 22, 1ull << 53};
+const FloatFormat FLOAT_FORMAT = {23, -127, 0xFF, -65, 38, -17, 10, 10, 1ull << 24};
 
-    INSERT_LIT("env", writePos);
-    INSERT_LIT("put", writePos);
-    *writePos++ = wasm::external::Function;
-    *writePos++ = 2; //use the function signature: (i32) => (void)
+const f64 EXACT_POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
 
-    INSERT_LIT("env", writePos);
-    INSERT_LIT("puts", writePos);
-    *writePos++ = wasm::external::Function;
-    *writePos++ = 3; //use the function signature: (i32) => (void)
+//numbers too big for 64 bits, as 32 bit words from the least significant up.  They're only
+//used to compute powers of 5, the largest of which are 5^342 and 2^1718 / 5^342
+const u32 MAX_BIG_WORDS = 32;
 
-    INSERT_LIT("env", writePos);
-    INSERT_LIT("nextF32", writePos);
-    *writePos++ = wasm::external::Function;
-    *writePos++ = 4; //use the function signature: () => (f32)
+struct BigInt {
+    u32 words[MAX_BIG_WORDS];
+    u32 count;
+};
 
-    *importSectionSize = writePos - importSectionSize - 1;
-    // PRINT_LIT("Finished Import section\n");
+BigInt bigPower;
+BigInt bigQuotient;
+BigInt bigRemainder;
 
+u32 getBitLength(BigInt& x) {
+    return x.count ? 32 * x.count - __builtin_clz(x.words[x.count - 1]) : 0;
+}
 
-    *writePos++ = wasm::section::Function;
-    *writePos++ = 2; //# of bytes that belong to this section
-    *writePos++ = 1; //# of functions defined inside this module
-    *writePos++ = 0; //first uses () -> (void)
-    // PRINT_LIT("Finished Function section\n");
+bool getBit(BigInt& x, i32 bit) {
+    return bit >= 0 && (u32)bit < 32 * x.count && (x.words[bit >> 5] >> (bit & 31) & 1);
+}
 
+void multiplyBig(BigInt& x, u32 factor) {
+    u64 carry = 0;
+    for (u32 i = 0; i < x.count; ++i) {
+        carry += (u64)x.words[i] * factor;
+        x.words[i] = carry;
+        carry >>= 32;
+    }
 
-    *writePos++ = wasm::section::Memory;
-    *writePos++ = 4; //# of bytes that belong to this section
-    *writePos++ = 1; //one memory defined
-    *writePos++ = 1; //memory is limited
-    *writePos++ = 1; //initial one page
-    *writePos++ = 1; //max one page
-    // PRINT_LIT("Finished Memory section\n");
+    if (carry) {
+        x.words[x.count++] = carry;
+    }
+}
 
+//x = x * 2 + bit
+void shiftBigLeft(BigInt& x, u32 bit) {
+    for (u32 i = 0; i < x.count; ++i) {
+        u32 next = x.words[i] >> 31;
+        x.words[i] = x.words[i] << 1 | bit;
+        bit = next;
+    }
 
-    *writePos++ = wasm::section::Global;
-    u8 *globalSectionSize = writePos;
-    *writePos++ = 0; //# of bytes belong to this section.  This'll be patched further down the code
-    *writePos++ = 0; //# of global variables defined
+    if (bit) {
+        x.words[x.count++] = bit;
+    }
+}
 
-    //scan through the program looking for globals
-    readPos = sourceCode;
-    endReadPos = sourceCode + length;
+bool isBigLess(BigInt& a, BigInt& b) {
+    if (a.count != b.count) {
+        return a.count < b.count;
+    }
 
-    // while (readPos < endReadPos) {
-    //     //skip line comments
-    //     if (readPos[0] == '/' && readPos[1] == '/') {
-    //         while (*readPos++ != '\n');
-    //     }
-
-    //     //skip block comments
-    //     if (readPos[0] == '/' && readPos[1] == '*') {
-    //         while (readPos[-2] != '*' || readPos[-1] != '/') {
-    //             ++readPos;
-    //         }
-    //     }
-
-    //     if (isValidLeadingIDChar(*readPos)) {
-    //         char* endOfToken = findTokenEnd(readPos);
-    //         u32 tokenLen = endOfToken - readPos;
-    //         u32 hash = getIdentifierHash(readPos, tokenLen);
-
-    //         u8 globalVarType = getWasmTypeFromCppName(hash);
-            
-    //         readPos = findNextIdentifier(endOfToken);
-    //         endOfToken = findTokenEnd(readPos);
-    //         tokenLen = endOfToken - readPos;
-    //         hash = getIdentifierHash(readPos, tokenLen);
-
-    //         //look for the known function name rather than properly look to see if the identifier is a function name
-    //         //TODO do this properly
-    //         if (hash == HASH("main")) {
-    //             //skip through the the function body
-    //             int scopeDepth = 0;
-    //             while (true) {
-    //                 if (*readPos == '{') {
-    //                     ++scopeDepth;
-    //                 }
-    //                 if (*readPos == '}') {
-    //                     --scopeDepth;
-    //                     if (scopeDepth == 0) {
-    //                         break;
-    //                     }
-    //                 }
-
-    //                 ++readPos;
-    //             }
-    //         } else {
-    //             varHashes[globalVarCount] = hash;
-    //             varTypes[globalVarCount] = globalVarType;
-    //             ++globalVarCount;
-    //             *writePos++ = globalVarType;
-    //             *writePos++ = 1; //is mutable
-
-    //             //for now ignore global variable initial values as specified by the user
-    //             switch (globalVarType) {
-    //                 case wasm::type::i32:
-    //                 *writePos++ = wasm::i32_const;
-    //                 *writePos++ = 0;
-    //                 break;
-
-    //                 case wasm::type::i64:
-    //                 *writePos++ = wasm::i64_const;
-    //                 *writePos++ = 0;
-    //                 break;
-
-    //                 case wasm::type::f32:
-    //                 *writePos++ = wasm::f32_const;
-    //                 memset(writePos, 0, 4);
-    //                 writePos += 4;
-    //                 break;
-
-    //                 case wasm::type::f64:
-    //                 *writePos++ = wasm::f64_const;
-    //                 memset(writePos, 0, 8);
-    //                 writePos += 8;
-    //                 break;
-    //             }
-    //             *writePos++ = wasm::end;
-
-    //             PRINT_LIT("Global \"");
-    //             puts(readPos, tokenLen);
-    //             PRINT_LIT("\"\n");
-
-    //             //assume only one global var per line for now  TODO
-    //             while (*readPos != '\n') {
-    //                 ++readPos;
-    //             };
-    //         }
-    //     }
-
-    //     ++readPos;
-    // }
-
-    //update byte size of global section (assume it fits within 127 bytes)
-    globalSectionSize[0] = 1;//writePos - globalSectionSize - 1;
-    globalSectionSize[1] = 0;//globalVarCount;
-
-    //reset the read position so the code generation pass can run later
-    readPos = sourceCode;
+    for (u32 i = a.count; i-- > 0;) {
+        if (a.words[i] != b.words[i]) {
+            return a.words[i] < b.words[i];
+        }
+    }
+    return false;
+}
 
-    // PRINT_LIT("Finished Global section\n");
+//a -= b, where b <= a
+void subtractBig(BigInt& a, BigInt& b) {
+    u64 borrow = 0;
+    for (u32 i = 0; i < a.count; ++i) {
+        u64 difference = (u64)a.words[i] - (i < b.count ? b.words[i] : 0) - borrow;
+        a.words[i] = difference;
+        borrow = difference >> 63;
+    }
 
+    while (a.count && a.words[a.count - 1] == 0) {
+        --a.count;
+    }
+}
 
-    *writePos++ = wasm::section::Export;
-    u8 *exportSectionSize = writePos;
-    *writePos++ = 0; //# of bytes that belong to this section
-    *writePos++ = 2; //# of things to export
+//the 128 most significant bits of 5^q, computed the first time they're needed and 0 until
+//then.  The powers Eisel-Lemire needs would take 10KB of the compiler, most of which no
+//program uses
+const i32 MIN_POWER_OF_FIVE = -342;
+const u32 POWER_OF_FIVE_COUNT = 308 - MIN_POWER_OF_FIVE + 1;
+u64 powersOfFive[POWER_OF_FIVE_COUNT][2];
+
+//5^q truncated to 128 bits.  Negative powers are 2^b / 5^-q, rounded up, with b big enough
+//that the quotient has at least 128 bits
+u64* getPowerOfFive(i32 q) {
+    u64* power = powersOfFive[q - MIN_POWER_OF_FIVE];
+    if (power[0] != 0) {
+        return power;
+    }
 
-    INSERT_LIT("main", writePos);
-    *writePos++ = wasm::external::Function;
-    *writePos++ = 4; //index of function
+    bigPower.words[0] = 1;
+    bigPower.count = 1;
+    for (i32 i = 0; i < (q < 0 ? -q : q); ++i) {
+        multiplyBig(bigPower, 5);
+    }
 
-    INSERT_LIT("memory", writePos);
-    *writePos++ = wasm::external::Memory;
-    *writePos++ = 0; //index of memory
+    BigInt* value = &bigPower;
+    if (q < 0) {
+        u32 length = getBitLength(bigPower);
+        u32 b = q >= -27 ? length + 127 : 2 * length + 128;
 
-    *exportSectionSize = writePos - exportSectionSize - 1;
-    // PRINT_LIT("Finished Export section\n");
+        //long division, one bit of the quotient at a time
+        for (u32 i = 0; i < MAX_BIG_WORDS; ++i) {
+            bigQuotient.words[i] = 0;
+        }
+        bigQuotient.count = 0;
+        bigRemainder.count = 0;
+
+        for (i32 bit = b; bit >= 0; --bit) {
+            shiftBigLeft(bigRemainder, bit == b);
+            if (!isBigLess(bigRemainder, bigPower)) {
+                subtractBig(bigRemainder, bigPower);
+                bigQuotient.words[bit >> 5] |= 1u << (bit & 31);
+                if (bigQuotient.count <= (u32)bit >> 5) {
+                    bigQuotient.count = (bit >> 5) + 1;
+                }
+            }
+        }
 
+        //+ 1
+        for (u32 i = 0; ++bigQuotient.words[i] == 0; ++i) {
+        }
+        if (bigQuotient.words[bigQuotient.count] != 0) {
+            ++bigQuotient.count;
+        }
 
-    *writePos++ = wasm::section::Code;
-    u8 *codeSectionSize = writePos;
-    *writePos++ = 0x80; //# of bytes (LO)
-    *writePos++ = 0x00; //# of bytes (HI)
-    *writePos++ = 1; //# of functions are defined
-
-    //scan the program looking for each function in-order
-
-    //TODO re-write this function scanner and the global variable scanner to use
-    //the findToken() function so I stop repeating code and improve correctness.
-    
-    //for now, assume an open parenthesis marks the beginning of a function
-    while (readPos < endReadPos && (*readPos != '(' || readPos[-1] != 'n' || readPos[-2] != 'i' || readPos[-3] != 'a' || readPos[-4] != 'm')) {
-        ++readPos;
+        value = &bigQuotient;
     }
 
-    // PRINT_LIT("Before Start Function\n");
-    compileAndInsertFunction();
-    // PRINT_LIT("Finished Start Function\n");
+    i32 first = getBitLength(*value) - 128;
+    for (i32 i = 0; i < 128; ++i) {
+        power[1 - i / 64] |= (u64)getBit(*value, first + i) << (i % 64);
+    }
 
-    size = writePos - codeSectionSize - 2;
-    // PRINT_LIT("Code section size: ");
-    // puti32(size);
-    // PRINT_LIT(" bytes\n");
-    codeSectionSize[0] = (size & 0x7F) | 0x80;
-    codeSectionSize[1] = size >> 7;
+    return power;
+}
 
-    // PRINT_LIT("Finished Code section\n");
+//the 128 bit product of a and b
+void multiply64(u64 a, u64 b, u64& high, u64& low) {
+    u64 lowLow = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+    u64 lowHigh = (a & 0xFFFFFFFF) * (b >> 32);
+    u64 highLow = (a >> 32) * (b & 0xFFFFFFFF);
+    u64 highHigh = (a >> 32) * (b >> 32);
 
-    if (initialDataSize > 0) {
-        *writePos++ = wasm::section::Data;
-        *writePos++ = ((initialDataSize + 7) & 0x7F) | 0x80; //data section size LOW
-        *writePos++ = (initialDataSize + 7) >> 7; //data section size HI
-        *writePos++ = 1; //exactly 1 data segment defined
+    u64 middle = (lowLow >> 32) + (lowHigh & 0xFFFFFFFF) + (highLow & 0xFFFFFFFF);
+    low = middle << 32 | (lowLow & 0xFFFFFFFF);
+    high = highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+}
 
-        *writePos++ = 0; //memory index 0
-        *writePos++ = wasm::i32_const;
-        *writePos++ = 0;
-        *writePos++ = wasm::end;
+u64 getInfinity(const FloatFormat& f) {
+    return (u64)f.infiniteExponent << f.mantissaBits;
+}
+
+//the bits of the float closest to w * 10^q (Eisel-Lemire)
+u64 getClosestFloat(u64 w, i32 q, const FloatFormat& f) {
+    if (w == 0 || q < f.minPower) {
+        return 0;
+    } else if (q > f.maxPower) {
+        return getInfinity(f);
+    }
 
-        *writePos++ = (initialDataSize & 0x7F) | 0x80; //data section size LOW
-        *writePos++ = initialDataSize >> 7; //data section size HI
+    u32 leadingZeros = __builtin_clzll(w);
+    w <<= leadingZeros;
+
+    //the second half of the power only matters when the bits of the product past the mantissa
+    //and the two bits after it are all ones
+    u64* power = getPowerOfFive(q);
+    u64 high, low;
+    multiply64(w, power[0], high, low);
+
+    u64 precisionMask = ~0ull >> (f.mantissaBits + 3);
+    if ((high & precisionMask) == precisionMask) {
+        u64 secondHigh, secondLow;
+        multiply64(w, power[1], secondHigh, secondLow);
+        low += secondHigh;
+        high += secondHigh > low;
+    }
 
-        //copy those bytes from the beginning of the module to the correct
-        //location at the end of the module
-        readPos = sourceCode + length;
-        for (int i = 0; i < initialDataSize; ++i) {
-            *writePos++ = *readPos++;
+    //the mantissa with an extra bit to round with.  log2(10^q) = q * log2(5) + q, where
+    //log2(5) is about 152170 / 65536
+    u32 upperBit = high >> 63;
+    u32 shift = upperBit + 64 - f.mantissaBits - 3;
+    u64 mantissa = high >> shift;
+    i32 exponent = (((152170 + 65536) * q) >> 16) + 63 + upperBit - leadingZeros - f.minExponent;
+
+    if (exponent <= 0) {
+        //subnormals round to a mantissa with fewer bits.  Rounding up to 2^mantissaBits makes
+        //one normal, which is encoded the same way
+        if (1 - exponent >= 64) {
+            return 0;
         }
+
+        mantissa >>= 1 - exponent;
+        mantissa += mantissa & 1;
+        return mantissa >> 1;
+    }
+
+    //a product that's exactly halfway between two floats rounds to the even one
+    if (low <= 1 && q >= f.minRoundToEvenPower && q <= f.maxRoundToEvenPower && (mantissa & 3) == 1 && (mantissa << shift) == high) {
+        mantissa &= ~1ull;
     }
 
-    u32 wasmModuleAddress = (u32)(void*)(sourceCode + length + initialDataSize);
-    u32 wasmModuleSize = (u32)(void*)writePos - wasmModuleAddress;
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= 2ull << f.mantissaBits) {
+        mantissa = 1ull << f.mantissaBits;
+        ++exponent;
+    }
 
-    // logi32(initialDataSize);
-    // logi32(wasmModuleAddress);
-    // logi32(wasmModuleSize);
+    if ((u32)exponent >= f.infiniteExponent) {
+        return getInfinity(f);
+    }
 
-    //Wasm only supports one return type.  JavaScript doesn't support i64.
-    //For now, limit return address and lengths to 16 bits and pack them together.
-    return (wasmModuleAddress << 16) | wasmModuleSize;
+    return (mantissa & ~(1ull << f.mantissaBits)) | (u64)exponent << f.mantissaBits;
 }
 
+//a decimal for converting literals digit by digit.  Its value is 0.digits * 10^point.  It's
+//halved and doubled until it's between 1/2 and 1, then the digits of its mantissa are shifted
+//in front of the point
+const u32 MAX_DECIMAL_DIGITS = 800;
 
+struct Decimal {
+    u8 digits[MAX_DECIMAL_DIGITS];
+    u32 count;
+    i32 point;
+    bool isTruncated; //whether nonzero digits past the last one were dropped
+};
 
-void compileAndInsertFunction() {
-    //write to this address at the end of the function once the body size is known
-    u8* functionBodySize = writePos;
-    *writePos++ = 0x80; //# of bytes (LO)
-    *writePos++ = 0x00; //# of bytes (HI)
-
-    u32 totalVarCount = globalVarCount;
-
-    //temporarily disable function paremeter detection DEBUG TODO
-    //Parse parameters and their types.  Parameters count as local variables
-    while (readPos < endReadPos && *readPos != ')') {
-        // if (isValidLeadingIDChar(*readPos)) {
-        //     //assume the parameter list is filled with chains of type identifiers and parameter names
-        //     char* endOfToken = findTokenEnd(readPos);
-        //     u32 tokenLen = endOfToken - readPos;
-        //     u32 hash = getIdentifierHash(readPos, tokenLen);
-
-        //     u32 paramType = getWasmTypeFromCppName(hash);
-
-        //     //now extract parameter name
-        //     readPos = findNextIdentifier(endOfToken);
-        //     endOfToken = findTokenEnd(readPos);
-        //     tokenLen = endOfToken - readPos;
-        //     hash = getIdentifierHash(readPos, tokenLen);
-
-        //     // PRINT_LIT("Parameter \"");
-        //     // puts(readPos, tokenLen);
-        //     // PRINT_LIT("\" index: ");
-        //     // puti32(totalVarCount);
-        //     // put('\n');
-
-        //     varTypes[totalVarCount] = paramType;
-        //     varHashes[totalVarCount] = hash;
-        //     ++totalVarCount;
-
-        //     readPos = endOfToken;
-        // } else {
-            ++readPos;
-        // }
+Decimal decimal;
+u8 shiftedDigits[MAX_DECIMAL_DIGITS + 20];
+
+//the most a decimal is shifted by at once, so that a digit shifted by it still fits in 64 bits
+const u32 MAX_DECIMAL_SHIFT = 60;
+
+void trimDecimal() {
+    while (decimal.count > 0 && decimal.digits[decimal.count - 1] == 0) {
+        --decimal.count;
     }
 
-    char* beginningOfFuncBody = readPos;
-    u32 varIndexToAssignTo = -1;
-    u32 funcIndexToCall = -1;
-    bool isIfStatement = false;
-    u32 scopeDepth = 0;
+    if (decimal.count == 0) {
+        decimal.point = 0;
+    }
+}
 
-    int startingvarCount = totalVarCount;
+//multiply the decimal by 2^shift.  Its digits are found from the last up
+void shiftDecimalLeft(u32 shift) {
+    u32 w = MAX_DECIMAL_DIGITS + 20;
+    u64 n = 0;
+    for (u32 r = decimal.count; r-- > 0;) {
+        n += (u64)decimal.digits[r] << shift;
+        shiftedDigits[--w] = n % 10;
+        n /= 10;
+    }
 
-    //parse the function twice.  Once to find all local variables and again to generate code
-    for (int pass = 0; pass < 2; ++pass) {
-        //restore state having only written local var declarations at the top of the function1
-        totalVarCount = startingvarCount;
-        readPos = beginningOfFuncBody;
-        varIndexToAssignTo = -1;
+    while (n > 0) {
+        shiftedDigits[--w] = n % 10;
+        n /= 10;
+    }
 
-        //don't read past the end of the input string in the event of malformed C++
-        while (readPos < endReadPos) {
-            if (*readPos == '{') {
-                ++scopeDepth;
-            }
+    u32 count = MAX_DECIMAL_DIGITS + 20 - w;
+    decimal.point += count - decimal.count;
+    if (count > MAX_DECIMAL_DIGITS) {
+        for (u32 i = MAX_DECIMAL_DIGITS; i < count; ++i) {
+            decimal.isTruncated |= shiftedDigits[w + i] != 0;
+        }
+        count = MAX_DECIMAL_DIGITS;
+    }
 
-            if (*readPos == '}') {
-                --scopeDepth;
-                *writePos++ = wasm::end;
+    for (u32 i = 0; i < count; ++i) {
+        decimal.digits[i] = shiftedDigits[w + i];
+    }
+    decimal.count = count;
+    trimDecimal();
+}
 
-                if (scopeDepth == 0) {
-                    break;
-                }
+//divide the decimal by 2^shift.  Its digits are found from the first down
+void shiftDecimalRight(u32 shift) {
+    u32 r = 0;
+    u32 w = 0;
+    u64 n = 0;
+
+    //enough leading digits to be shifted by it
+    for (; n >> shift == 0; ++r) {
+        if (r >= decimal.count) {
+            if (n == 0) {
+                decimal.count = 0;
+                return;
             }
 
-            char* endOfToken = findTokenEnd(readPos);
-            u32 tokenLen = endOfToken - readPos;
-            u32 hash = getIdentifierHash(readPos, tokenLen);
-
-            // puts(readPos, endOfToken - readPos);
-            // put(',');
-
-            if (hash == HASH("Scanner")) {
-                //DEBUG ignore this line for now
-                while (readPos < endReadPos && *readPos != ';') {++readPos;};
-                varIndexToAssignTo = -1;
-            }
-            else if (isValidLeadingIDChar(*readPos)) {
-                u32 wasmType = getWasmTypeFromCppName(hash);
-                if (wasmType != wasm::type::_void) {
-                    //if the identifier on the beginning of the line is a type name, then declare
-                    //a variable of that type with the following identifier as its name/hash
-                    readPos = findNextIdentifier(endOfToken);
-                    endOfToken = findTokenEnd(readPos);
-                    tokenLen = endOfToken - readPos;
-                    hash = getIdentifierHash(readPos, tokenLen);
-
-                    varIndexToAssignTo = totalVarCount;
-
-                    // PRINT_LIT("Local \"");
-                    // puts(readPos, tokenLen);
-                    // PRINT_LIT("\" index: ");
-                    // puti32(totalVarCount);
-                    // PRINT_LIT(" type: ");
-                    // puti32(wasmType);
-                    // put('\n');
-
-                    if (pass == 0) {
-                        varTypes[totalVarCount] = wasmType;
-                        varHashes[totalVarCount] = hash;
-                    }
+            while (n >> shift == 0) {
+                n *= 10;
+                ++r;
+            }
+            break;
+        }
 
-                    ++totalVarCount;
+        n = n * 10 + decimal.digits[r];
+    }
 
-                    //place cursor one char past assignment operator or at end of line
-                    do {
-                        ++readPos;
-                    } while (*readPos != '=' && *readPos != ';');
-                } else if (pass == 1) {
-                    //if the identifier at the beginning of the line isn't a type name,
-                    //then check if it is instead a local or global variable
+    decimal.point -= r - 1;
+    u64 mask = (1ull << shift) - 1;
 
-                    if (hash == HASH("if")) {
-                        // PRINT_LIT("found if statement\n");
-                        isIfStatement = true;
-                        readPos = endOfToken;
+    for (; r < decimal.count; ++r) {
+        u8 digit = decimal.digits[r];
+        decimal.digits[w++] = n >> shift;
+        n = (n & mask) * 10 + digit;
+    }
 
-                        //set read position to one char past the open parenthesis
-                        readPos = findNextToken(readPos) + 1;
+    while (n > 0) {
+        u64 digit = n >> shift;
+        if (w < MAX_DECIMAL_DIGITS) {
+            decimal.digits[w++] = digit;
+        } else if (digit > 0) {
+            decimal.isTruncated = true;
+        }
+        n = (n & mask) * 10;
+    }
 
-                        compileExpression(totalVarCount);
-                    }
-                    else if (hash == HASH("System.out.println")) {
-                        //this functionality is very hard coded at the moment.  It will
-                        //likely only work with literals and numbers.
-                        readPos = endOfToken;
-
-                        while (readPos < endReadPos && *readPos != ';') {
-                            if (*readPos == '"') {
-                                ++readPos;
-
-                                char* startOfString = readPos;
-
-                                while (readPos < endReadPos && *readPos != '"') {
-                                    ++readPos;
-                                }
-
-                                int stringLength = readPos - startOfString;
-
-                                *writePos++ = wasm::i32_const;
-                                *writePos++ = initialDataSize;
-                                *writePos++ = wasm::i32_const;
-                                *writePos++ = stringLength;
-                                *writePos++ = wasm::call;
-                                *writePos++ = 2; //puts()
-
-                                initialDataSize += stringLength;
-
-                                readPos += 1;
-                                if (varIndexToAssignTo != -1) {
-                                    PRINT_LIT("After println, attempted to assign var");
-                                    puti32(varIndexToAssignTo);
-                                    put('\n');
-                                    varIndexToAssignTo = -1;
-                                }
-                            }
-
-                            //print out variables
-                            else if (isValidLeadingIDChar(*readPos)) {
-                                endOfToken = findTokenEnd(readPos);
-                                tokenLen = endOfToken - readPos;
-                                hash = getIdentifierHash(readPos, tokenLen);
-                                readPos = endOfToken;
-
-                                for (int i = 0; i < totalVarCount; ++i) {
-                                    if (hash == varHashes[i]) {
-                                        if (i < globalVarCount) {
-                                            *writePos++ = wasm::get_global;
-                                            *writePos++ = i;
-                                        } else {
-                                            *writePos++ = wasm::get_local;
-                                            *writePos++ = i - globalVarCount;
-                                        }
-
-                                        *writePos++ = wasm::call;
-                                        *writePos++ = 0; //putf32()
-                                    }
-                                }
-                            }
-
-                            ++readPos;
-                        }
+    decimal.count = w;
+    trimDecimal();
+}
 
-                        //println prints a '\n' at the end of its call
-                        *writePos++ = wasm::i32_const;
-                        *writePos++ = '\n';
-                        *writePos++ = wasm::call;
-                        *writePos++ = 1; //put('\n')
+void shiftDecimal(i32 shift) {
+    for (; shift > (i32)MAX_DECIMAL_SHIFT; shift -= MAX_DECIMAL_SHIFT) {
+        shiftDecimalLeft(MAX_DECIMAL_SHIFT);
+    }
+    for (; shift < -(i32)MAX_DECIMAL_SHIFT; shift += MAX_DECIMAL_SHIFT) {
+        shiftDecimalRight(MAX_DECIMAL_SHIFT);
+    }
 
-                    } else {
-                        //I am aware that this is an O(n) search.  The dataset is small,
-                        //so a better algorithm isn't needed yet
+    if (shift > 0) {
+        shiftDecimalLeft(shift);
+    } else if (shift < 0) {
+        shiftDecimalRight(-shift);
+    }
+}
 
-                        for (int i = 0; i < totalVarCount; ++i) {
-                            if (hash == varHashes[i]) {
-                                varIndexToAssignTo = i;
-                            }
-                        }
+//the integer part of the decimal, rounded half to even.  A 5 that digits were dropped after
+//is more than half
+u64 getRoundedDecimal() {
+    if (decimal.point > 20) {
+        return ~0ull;
+    }
 
-                        //place cursor one char past assignment operator
-                        while (*readPos++ != '=');
+    u64 n = 0;
+    i32 i = 0;
+    for (; i < decimal.point && i < (i32)decimal.count; ++i) {
+        n = n * 10 + decimal.digits[i];
+    }
+    for (; i < decimal.point; ++i) {
+        n *= 10;
+    }
 
-                        //TODO detect = sign before assuming assignment
-                    }
+    if (decimal.point >= 0 && decimal.point < (i32)decimal.count) {
+        u8 next = decimal.digits[decimal.point];
+        if (next == 5 && decimal.point + 1 == (i32)decimal.count) {
+            n += decimal.isTruncated || (n & 1);
+        } else {
+            n += next >= 5;
+        }
+    }
 
-                }
+    return n;
+}
 
-                if (pass == 0) {
-                    //skip the rest of the line.  Assuming only one var declaration per statement
-                    while (*readPos++ != ';');
-                } else {
-                    // PRINT_LIT("Before compileExpression()\n");
-                    compileExpression(totalVarCount);
-                    // PRINT_LIT("After compileExpression()\n");
-                }
-            }
+//the bits of the float closest to the decimal
+u64 getDecimalFloat(const FloatFormat& f) {
+    if (decimal.count == 0 || decimal.point < -330) {
+        return 0;
+    } else if (decimal.point > 310) {
+        return getInfinity(f);
+    }
 
-            if (*readPos == ';') {
-                if (varIndexToAssignTo != -1) {
-                    // LOG_LIT("var index to assign to: ");
-                    // logi32(varIndexToAssignTo);
-                    // LOG_LIT("\n");
-                    if (varIndexToAssignTo < globalVarCount) {
-                        *writePos++ = wasm::set_global;
-                        *writePos++ = varIndexToAssignTo;
-                    } else {
-                        *writePos++ = wasm::set_local;
-                        *writePos++ = varIndexToAssignTo - globalVarCount;
-                    }
+    //the powers of 2 at most as large as each power of 10, up to 10^8
+    const u8 POWER_SHIFTS[] = {1, 3, 6, 9, 13, 16, 19, 23, 26};
 
-                    varIndexToAssignTo = -1;
-                } else if (funcIndexToCall != -1) {
-                    *writePos++ = wasm::call;
-                    *writePos++ = funcIndexToCall;
-                    funcIndexToCall = -1;
-                }
-            }
+    i32 exponent = 0;
+    while (decimal.point > 0) {
+        u32 n = decimal.point < 9 ? POWER_SHIFTS[decimal.point] : 27;
+        shiftDecimal(-n);
+        exponent += n;
+    }
 
-            if (*readPos == ')' && isIfStatement) {
-                *writePos++ = wasm::_if;
-                *writePos++ = wasm::type::_void;
-                isIfStatement = false;
-            }
+    while (decimal.point < 0 || (decimal.point == 0 && decimal.digits[0] < 5)) {
+        u32 n = -decimal.point < 9 ? POWER_SHIFTS[-decimal.point] : 27;
+        shiftDecimal(n);
+        exponent -= n;
+    }
 
-            ++readPos;
-        }
+    //between 1/2 and 1, where floats are between 1 and 2
+    --exponent;
 
-        //encode local variable metadata at the top of the function body
-        if (pass == 0) {
-            //number of local var entries
-            functionBodySize[2] = totalVarCount - globalVarCount;
+    //subnormals have the exponent of the smallest normal float
+    if (exponent <= f.minExponent) {
+        shiftDecimal(exponent - f.minExponent - 1);
+        exponent = f.minExponent + 1;
+    }
 
-            //at the moment, making no effort to collapse repeating parameter types
-            for (int i = globalVarCount; i < totalVarCount; ++i) {
-                *writePos++ = 1; //one parameter of the following type
-                *writePos++ = varTypes[i]; //parameter type
-            }
+    if ((u32)(exponent - f.minExponent) >= f.infiniteExponent) {
+        return getInfinity(f);
+    }
+
+    shiftDecimal(1 + f.mantissaBits);
+    u64 mantissa = getRoundedDecimal();
+
+    //rounding up may have carried into another bit
+    if (mantissa == 2ull << f.mantissaBits) {
+        mantissa >>= 1;
+        ++exponent;
+        if ((u32)(exponent - f.minExponent) >= f.infiniteExponent) {
+            return getInfinity(f);
         }
     }
 
-    //patch in the body size of the function earlier in the output
-    u32 size = writePos - functionBodySize - 2;
-    functionBodySize[0] = (size & 0x7F) | 0x80;
-    functionBodySize[1] = size >> 7;
-}
+    if ((mantissa & 1ull << f.mantissaBits) == 0) {
+        exponent = f.minExponent;
+    }
 
+    return (mantissa & ~(1ull << f.mantissaBits)) | (u64)(exponent - f.minExponent) << f.mantissaBits;
+}
 
-void compileExpression(u32 totalVarCount) {
-    u8 queuedOperation = 0;
+//the exponent after the e or p of a literal, if it has one.  Large exponents are clamped to
+//values that still round to 0 or infinity
+i32 parseExponent(char* c, char* end) {
+    if (c == end) {
+        return 0;
+    }
 
-    readPos = findNextToken(readPos);
+    ++c;
+    bool isNegative = *c == '-';
+    c += *c == '-' || *c == '+';
 
-    while (readPos < endReadPos && *readPos != ';' && *readPos != ')') {
-        char* endOfToken = findTokenEnd(readPos);
-        u32 tokenLen = endOfToken - readPos;
-        // PRINT_LIT("token: ");
-        // puts(readPos, tokenLen);
-        // put('\n');
+    i32 exponent = 0;
+    for (; c < end; ++c) {
+        if (isdigit(*c) && exponent < 100000) {
+            exponent = exponent * 10 + (*c - '0');
+        }
+    }
 
-        // PRINT_LIT("Token \"");
-        // puts(readPos, tokenLen);
-        // PRINT_LIT("\" at ");
-        // puti32((u32)(void*)readPos);
-        // put('\n');
+    return isNegative ? -exponent : exponent;
+}
 
-        //assume every token is an identifier, a number, or an operator
-        if (isValidLeadingIDChar(*readPos)) {
-            u32 hash = getIdentifierHash(readPos, tokenLen);
+u64 parseDecimalFloat(char* c, char* end, const FloatFormat& f) {
+    char* start = c;
+
+    //the first 19 significant digits are the significand.  The value is w * 10^q, or between
+    //that and (w + 1) * 10^q when nonzero digits were dropped
+    u64 w = 0;
+    i32 q = 0;
+    u32 significantDigits = 0;
+    bool isTruncated = false;
+    bool isFraction = false;
+
+    for (; c < end && (*c | 0x20) != 'e'; ++c) {
+        if (*c == '.') {
+            isFraction = true;
+        } else if (*c != '_' && (*c != '0' || significantDigits > 0)) {
+            if (significantDigits < 19) {
+                w = w * 10 + (*c - '0');
+                q -= isFraction;
+            } else {
+                isTruncated |= *c != '0';
+                q += !isFraction;
+            }
+            ++significantDigits;
+        } else if (*c == '0') {
+            q -= isFraction;
+        }
+    }
 
-            for (int i = 0; i < totalVarCount; ++i) {
-                if (hash == varHashes[i]) {
-                    if (i < globalVarCount) {
-                        *writePos++ = wasm::get_global;
-                        *writePos++ = i;
-                    } else {
-                        *writePos++ = wasm::get_local;
-                        *writePos++ = i - globalVarCount;
+    i32 exponent = parseExponent(c, end);
+    q += exponent;
 
-                    }
+    if (!isTruncated && w <= f.maxExactSignificand && q >= -f.maxExactPower && q <= f.maxExactPower) {
+        if (f.mantissaBits == DOUBLE_FORMAT.mantissaBits) {
+            f64 value = w;
+            value = q < 0 ? value / EXACT_POWERS_OF_TEN[-q] : value * EXACT_POWERS_OF_TEN[q];
 
-                    if (queuedOperation) {
-                        *writePos++ = queuedOperation;
-                        queuedOperation = 0;
-                    }
-                }
-            }
+            u64 bits;
+            memcpy(&bits, &value, 8);
+            return bits;
+        }
 
-            if (hash == HASH("keyboard.nextFloat")) {
-                *writePos++ = wasm::call;
-                *writePos++ = 3; //nextF32()
-            } 
-        } else if ((readPos[0] == '-' && (isdigit(readPos[1]) || readPos[1] == '.')) || isdigit(*readPos) || *readPos == '.') {
-            //TODO for now assuming all numeric literals are floating point literals
-            if (readPos[tokenLen - 1] == 'f') {
-                //make the trailing f at the end of literals optional
-                --tokenLen;
-            }
+        f32 value = w;
+        f32 power = EXACT_POWERS_OF_TEN[q < 0 ? -q : q];
+        value = q < 0 ? value / power : value * power;
 
-            f32 result = stof(readPos, tokenLen);
-            readPos = endOfToken;
+        u32 bits;
+        memcpy(&bits, &value, 4);
+        return bits;
+    }
 
-            *writePos++ = wasm::f32_const;
-            insertF32(writePos, result);
-            writePos += 4;
+    u64 bits = getClosestFloat(w, q, f);
+    if (!isTruncated || getClosestFloat(w + 1, q, f) == bits) {
+        return bits;
+    }
 
-            if (queuedOperation) {
-                *writePos++ = queuedOperation;
-                queuedOperation = 0;
+    //too close to halfway between two floats to tell which without the rest of the digits
+    decimal.count = 0;
+    decimal.point = exponent;
+    decimal.isTruncated = false;
+    isFraction = false;
+
+    for (c = start; c < end && (*c | 0x20) != 'e'; ++c) {
+        if (*c == '.') {
+            isFraction = true;
+        } else if (*c != '_' && (*c != '0' || decimal.count > 0)) {
+            decimal.point += !isFraction;
+            if (decimal.count < MAX_DECIMAL_DIGITS) {
+                decimal.digits[decimal.count++] = *c - '0';
+            } else {
+                decimal.isTruncated |= *c != '0';
             }
-        } else {
-            //assume 1 character operators for now (e.g. no <<, >>, &&, or ||)
-            u8 wasmOp = getWasmOpFromOperator(*readPos++);
+        } else if (*c == '0') {
+            decimal.point -= isFraction;
+        }
+    }
 
-            //for now, don't take into account operator precedence
-            if (queuedOperation) {
-                *writePos++ = queuedOperation;
-            }
+    trimDecimal();
+    return getDecimalFloat(f);
+}
 
-            queuedOperation = wasmOp;
+//hex literals like 0x1.8p1 are exact in binary, so they're only rounded once, to nearest even
+u64 parseHexFloat(char* c, char* end, const FloatFormat& f) {
+    u64 significand = 0;
+    i32 exponent = 0;
+    bool isSticky = false; //whether nonzero bits past those in the significand were dropped
+    bool isFraction = false;
+
+    for (; c < end && (*c | 0x20) != 'p'; ++c) {
+        if (*c == '.') {
+            isFraction = true;
+        } else if (*c != '_') {
+            u32 digit = isdigit(*c) ? *c - '0' : (*c | 0x20) - 'a' + 10;
+            if (significand >> 60 == 0) {
+                significand = significand << 4 | digit;
+                exponent -= 4 * isFraction;
+            } else {
+                isSticky |= digit != 0;
+                exponent += 4 * !isFraction;
+            }
         }
+    }
 
-        readPos = findNextToken(endOfToken);
+    exponent += parseExponent(c, end);
+    if (significand == 0) {
+        return 0;
     }
-}
 
-constexpr float stof(char* c, u32 length) {
-    //For now, only convert fixed-point float literals to float values
-    float result = 0.0f;
-    float sign = 1.0f;
+    //the biased exponent of the leading bit, once it's shifted to the top
+    u32 leadingZeros = __builtin_clzll(significand);
+    significand <<= leadingZeros;
+    i32 biasedExponent = exponent + 63 - leadingZeros - f.minExponent;
+
+    //subnormals drop more bits
+    u32 dropped = 63 - f.mantissaBits + (biasedExponent < 1 ? 1 - biasedExponent : 0);
+    if (biasedExponent > (i32)f.infiniteExponent) {
+        return getInfinity(f);
+    } else if (dropped > 64) {
+        return 0;
+    } else if (dropped == 64) {
+        return significand > 1ull << 63 || isSticky;
+    }
 
-    if (*c == '-') {
-        sign = -1.0f;
-        ++c;
-        --length;
+    u64 mantissa = significand >> dropped;
+    u64 rest = significand << (64 - dropped);
+    if (rest > 1ull << 63 || (rest == 1ull << 63 && (isSticky || (mantissa & 1)))) {
+        ++mantissa;
     }
 
-    //calculate portion of value larger than 10
-    //NOTE: float literals may begin with a decimal point e.g. ".01f"
-    while (length && *c != '.') {
-        result = result * 10.0f + (*c++ - '0');
-        --length;
+    if (biasedExponent < 1) {
+        return mantissa;
     }
 
-    if (length && *c == '.') {
-        ++c;
-        --length;
+    if (mantissa == 2ull << f.mantissaBits) {
+        mantissa >>= 1;
+        ++biasedExponent;
+    }
 
-        float scale = 0.1f;
-        while (length) {
-            result += scale * (*c++ - '0');
-            scale *= 0.1f;
-            --length;
-        }
+    if ((u32)biasedExponent >= f.infiniteExponent) {
+        return getInfinity(f);
     }
 
-    return result * sign;
-}
\ No newline at end of file
+    return (mantissa & ~(1ull << f.mantissaBits)) | (u64)biasedExponent << f.mantissaBits;
+}
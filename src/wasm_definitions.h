@@ -266,6 +266,30 @@ struct wasm
         i64_reinterpret_from_f64,
         f32_reinterpret_from_i32,
         f64_reinterpret_from_i64,
+        // undefined,
+        // ...
+        misc_prefix = 0xFC,
+    };
+
+    //opcodes that follow the misc_prefix byte.  The index is encoded as a varuint32
+    struct misc
+    {
+        enum
+        {
+            i32_trunc_sat_f32_s,
+            i32_trunc_sat_f32_u,
+            i32_trunc_sat_f64_s,
+            i32_trunc_sat_f64_u,
+            i64_trunc_sat_f32_s,
+            i64_trunc_sat_f32_u,
+            i64_trunc_sat_f64_s,
+            i64_trunc_sat_f64_u,
+
+            //bulk memory.  memory.copy is followed by the indices of the memories it copies to
+            //and from, and memory.fill by the index of the memory it fills, each a 0 byte
+            memory_copy = 0x0A,
+            memory_fill,
+        };
     };
 
     struct type
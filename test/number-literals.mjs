@@ -0,0 +1,110 @@
+//numeric literals, and what Java prints for them.  The literals are printed by one program,
+//which is compiled with compiler.wasm and run headless, and each line it prints is compared
+//with the table.  Run it with npm test after rebuilding the compiler
+import {spawnSync} from "node:child_process";
+import {mkdtempSync, rmSync, writeFileSync} from "node:fs";
+import {tmpdir} from "node:os";
+import {join} from "node:path";
+import {fileURLToPath} from "node:url";
+
+//the exact decimal value of count halves of the smallest subnormal double, 2^-1075 each
+function subnormalHalves(count) {
+    const digits = (BigInt(count) * 5n ** 1075n).toString();
+    return "0." + digits.padStart(1075, "0");
+}
+
+//the exact decimal value of the midpoint between 1 and the next double, 1 + 2^-53
+const ONE_MIDPOINT = "1.00000000000000011102230246251565404236316680908203125";
+
+const cases = [
+    //ints and longs, which wrap to their type like Java's
+    ["0", "0"],
+    ["2147483647", "2147483647"],
+    ["-2147483648", "-2147483648"],
+    ["0xFFFFFFFF", "-1"],
+    ["0x7FFFFFFF", "2147483647"],
+    ["017", "15"],
+    ["0b101", "5"],
+    ["1_000_000", "1000000"],
+    ["9223372036854775807L", "9223372036854775807"],
+    ["-9223372036854775808L", "-9223372036854775808"],
+    ["0xFFFFFFFFFFFFFFFFL", "-1"],
+    ["0x8000000000000000L", "-9223372036854775808"],
+
+    //doubles that a digit at a time parser gets wrong
+    ["0.1", "0.1"],
+    ["1e23", "1.0E23"],
+    ["8.41e21", "8.41E21"],
+    ["9007199254740993.0", "9.007199254740992E15"],
+    ["2.2250738585072011e-308", "2.225073858507201E-308"],
+    ["2.2250738585072014e-308", "2.2250738585072014E-308"],
+
+    //the largest double, and the halfway point past it, which rounds to infinity
+    ["1.7976931348623157e308", "1.7976931348623157E308"],
+    ["1.7976931348623158e308", "1.7976931348623157E308"],
+    ["1.7976931348623159e308", "Infinity"],
+    ["1e400", "Infinity"],
+
+    //halfway subnormals round to even: half of the smallest to 0, one and a half to two.  Like
+    //Java, two digits are printed when one would do, the two closest to the double
+    ["2.4703282292062327e-324", "0.0"],
+    ["2.4703282292062328e-324", "4.9E-324"],
+    [subnormalHalves(1), "0.0"],
+    [subnormalHalves(1) + "1", "4.9E-324"],
+    [subnormalHalves(3), "9.9E-324"],
+    [subnormalHalves(3).slice(0, -1) + "4", "4.9E-324"],
+    ["1e-400", "0.0"],
+
+    //70 digits on either side of a midpoint, and the midpoint itself, which rounds to even
+    [ONE_MIDPOINT + "0000000000000001", "1.0000000000000002"],
+    [ONE_MIDPOINT, "1.0"],
+    [ONE_MIDPOINT.slice(0, -1) + "49999999999999999", "1.0"],
+
+    //floats
+    ["1.1f", "1.1"],
+    ["16777217f", "1.6777216E7"],
+    ["3.4028235e38f", "3.4028235E38"],
+    ["3.4028236e38f", "Infinity"],
+    ["1.4e-45f", "1.4E-45"],
+    ["0.7e-45f", "0.0"],
+
+    //hex floats
+    ["0x1.8p1", "3.0"],
+    ["0x1.fffffffffffffp1023", "1.7976931348623157E308"],
+    ["0x1.fffffffffffff8p1023", "Infinity"],
+    ["0x1p-1074", "4.9E-324"],
+    ["0x1p-1075", "0.0"],
+    ["0x1.0000000000001p-1075", "4.9E-324"],
+    ["0x1p-149f", "1.4E-45"],
+    ["0x1p-150f", "0.0"],
+    ["0x1.000002p-150f", "1.4E-45"],
+];
+
+const statements = cases.map(([literal]) => `        System.out.println(${literal});`);
+const source = `public class Main {
+    public static void main(String[] args) {
+${statements.join("\n")}
+    }
+}
+`;
+
+const directory = mkdtempSync(join(tmpdir(), "java-wasm-"));
+const sourcePath = join(directory, "Main.java");
+writeFileSync(sourcePath, source);
+
+const headless = fileURLToPath(new URL("../headless.js", import.meta.url));
+const run = spawnSync(process.execPath, [headless, sourcePath], {input: "", encoding: "utf8"});
+rmSync(directory, {recursive: true});
+
+const lines = run.stdout.split("\n");
+let failures = 0;
+cases.forEach(([literal, expected], i) => {
+    if (lines[i] !== expected) {
+        const shown = literal.length > 40 ? literal.slice(0, 20) + "..." + literal.slice(-17) : literal;
+        process.stdout.write(`${shown}: expected ${expected}, got ${lines[i]}\n`);
+        ++failures;
+    }
+});
+
+process.stdout.write(`${cases.length - failures} of ${cases.length} literals parsed correctly\n`);
+process.exitCode = failures > 0 ? 1 : 0;
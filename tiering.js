@@ -0,0 +1,124 @@
+//tiered compilation.  A program is first compiled without optimizations, so it runs right away,
+//then compiled with them by a second worker while it runs.  The worker running the program
+//switches to the optimized tier at a safe point, where no call of the program is on the stack:
+//between the calls of a benchmark, or at the next run of the same source.  Compiled in tiered
+//mode, every tier of a program lays out memory the same way, so the new instance can take over
+//the old one's memory and globals.  Nothing here needs a page
+
+import {readProfile} from "./runtime.js";
+
+//sites that ran at least this fraction as often as the hottest one are hot
+const HOT_FRACTION = 1 / 64;
+
+//the lines of the hot sites of a module compiled for profiling, for the optimized tier to
+//optimize the methods they're in
+export function findHotLines(moduleExports) {
+    const rows = readProfile(moduleExports) || [];
+    const maxCount = rows.reduce((max, row) => Math.max(max, row.count), 0);
+    const lines = new Set();
+
+    for (const row of rows) {
+        if (row.count > 0 && row.count >= maxCount * HOT_FRACTION) {
+            lines.add(row.line);
+        }
+    }
+    return [...lines];
+}
+
+//the words of a TierMailbox
+const GENERATION = 0;
+const SIZE = 1;
+
+//where the worker compiling the optimized tier leaves it for the worker running the program,
+//which checks for it at safe points without going back to its event loop.  Each module is
+//tagged with the generation of the request for it, so a module compiled for an older source
+//is never taken.  The buffer grows to fit each module, where shared buffers can grow.  A
+//module that still doesn't fit isn't left here, and only reaches the running worker by message,
+//for its next run
+const INITIAL_CAPACITY = 1 << 16;
+const MAX_CAPACITY = 1 << 26;
+
+export class TierMailbox {
+    static create() {
+        let buffer;
+        try {
+            buffer = new SharedArrayBuffer(8 + INITIAL_CAPACITY, {maxByteLength: 8 + MAX_CAPACITY});
+        } catch (error) {
+            buffer = new SharedArrayBuffer(8 + INITIAL_CAPACITY);
+        }
+        return new TierMailbox(buffer);
+    }
+
+    constructor(buffer) {
+        this.buffer = buffer;
+        this.words = new Int32Array(buffer, 0, 2);
+    }
+
+    //a view made now covers the buffer as it's grown so far
+    getBytes(length) {
+        return new Uint8Array(this.buffer, 8, length);
+    }
+
+    //on the compiling worker's side.  False if the module doesn't fit
+    put(bytes, generation) {
+        const size = 8 + bytes.length;
+        if (size > this.buffer.byteLength) {
+            if (!this.buffer.growable || size > this.buffer.maxByteLength) {
+                return false;
+            }
+            this.buffer.grow(size);
+        }
+
+        Atomics.store(this.words, GENERATION, 0);
+        this.getBytes(bytes.length).set(bytes);
+        Atomics.store(this.words, SIZE, bytes.length);
+        Atomics.store(this.words, GENERATION, generation);
+        return true;
+    }
+
+    //on the running worker's side.  The module of the given generation, once, or undefined
+    take(generation) {
+        if (Atomics.compareExchange(this.words, GENERATION, generation, 0) !== generation) {
+            return undefined;
+        }
+        return this.getBytes(Atomics.load(this.words, SIZE)).slice();
+    }
+}
+
+//the globals that hold a program's state between calls: its static fields, the top of its heap
+//and the counts of what it allocated and of its fuel
+const STATE_GLOBAL = /^(static\d+|heapTop|allocations|fuel)$/;
+
+function getStateGlobals(moduleExports) {
+    return Object.keys(moduleExports).filter(name => STATE_GLOBAL.test(name));
+}
+
+//what another tier must match to take over from an instance.  Taken before the instance runs
+export function getLayout(moduleExports) {
+    return {
+        heapBase: moduleExports.heapTop ? moduleExports.heapTop.value : 0,
+        globals: getStateGlobals(moduleExports).join(),
+    };
+}
+
+//hand the memory and globals of an instance, whose layout was taken when it was new, to a new
+//instance of another tier of its program.  Returns false, and leaves both alone, when their
+//layouts don't match
+export function carryOver(fromExports, fromLayout, toExports) {
+    const toLayout = getLayout(toExports);
+    if (toLayout.heapBase !== fromLayout.heapBase || toLayout.globals !== fromLayout.globals) {
+        return false;
+    }
+
+    const fromBytes = new Uint8Array(fromExports.memory.buffer);
+    const pageCount = (fromBytes.length - toExports.memory.buffer.byteLength) >> 16;
+    if (pageCount > 0) {
+        toExports.memory.grow(pageCount);
+    }
+    new Uint8Array(toExports.memory.buffer).set(fromBytes);
+
+    for (const name of getStateGlobals(fromExports)) {
+        toExports[name].value = fromExports[name].value;
+    }
+    return true;
+}
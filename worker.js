@@ -0,0 +1,343 @@
+//compiles and runs programs off the page's thread, so a busy program doesn't stall the editor.
+//The host sends it the compiler once, then sources to compile and maybe run.  Output goes through
+//an OutputRing the host drains when it can, and input comes through an InputChannel.  Where
+//memory can't be shared, output is posted in batches and input is only what the host sent
+//with the source.  Under node's worker_threads, messages go through parentPort.
+//In tiered mode, the worker compiles programs with the baseline tier and starts a worker of its
+//own that compiles their optimized tier.  The optimized tier can be guided by the profile of the
+//baseline's first call, and is switched to between the calls of a benchmark, or on the next run.
+//Unless options.cache is false, compiled programs are kept in a CompileCache
+import {OutputRing, InputChannel, createRuntime, instantiate, readCompileStats, readSizeReport, readCompileError} from "./runtime.js";
+import {runBenchmark, formatBenchmark} from "./benchmark.js";
+import {TierMailbox, findHotLines} from "./tiering.js";
+import {CompileCache} from "./compile-cache.js";
+
+const parentPort = typeof self === "undefined" ? (await import("node:worker_threads")).parentPort : undefined;
+
+function postToHost(message) {
+    if (parentPort) {
+        parentPort.postMessage(message);
+    } else {
+        self.postMessage(message);
+    }
+}
+
+const BATCH_MILLISECONDS = 16;
+const encoder = new TextEncoder();
+
+let outputRing;
+let inputChannel;
+let options = {};
+let programInput = [];
+let pendingOutput = [];
+let pendingOutputSize = 0;
+let lastFlush = 0;
+
+let optimizingWorker; //compiles the optimized tier, in tiered mode
+let tierMailbox;
+let tierGeneration = 0; //counts the requests for optimized tiers
+let tieredSource;
+let optimizedTier; //of tieredSource, once compiled
+let isOptimizedTierRequested = false;
+
+let compileCache;
+let compileOptions; //the options programs are cached under
+
+function write(bytes) {
+    if (outputRing) {
+        outputRing.write(bytes);
+        return;
+    }
+
+    pendingOutput.push(bytes.slice());
+    pendingOutputSize += bytes.length;
+    if (pendingOutputSize > 4096 || performance.now() - lastFlush > BATCH_MILLISECONDS) {
+        flushOutput();
+    }
+}
+
+function flushOutput() {
+    lastFlush = performance.now();
+    if (pendingOutput.length === 0) {
+        return;
+    }
+
+    const bytes = new Uint8Array(pendingOutputSize);
+    let offset = 0;
+    for (const chunk of pendingOutput) {
+        bytes.set(chunk, offset);
+        offset += chunk.length;
+    }
+
+    pendingOutput = [];
+    pendingOutputSize = 0;
+    postToHost({type: "output", bytes});
+}
+
+function readLine() {
+    if (programInput.length > 0) {
+        return programInput.shift();
+    }
+    return inputChannel ? inputChannel.readLine() : "";
+}
+
+const compilerImports = new createRuntime(write, readLine);
+const runtimeImports = new createRuntime(write, readLine);
+let compilerExports;
+
+//a fueled program checks whether it's paused each time its fuel runs out
+runtimeImports.env.yield = function() {
+    if (inputChannel) {
+        inputChannel.waitWhilePaused();
+    }
+    return options.fuel || 100000;
+};
+
+async function init(message) {
+    options = message.options || {};
+    outputRing = message.outputBuffer && new OutputRing(message.outputBuffer);
+    inputChannel = message.inputBuffer && new InputChannel(message.inputBuffer);
+
+    const isTiered = options.tiered !== undefined;
+    const isBaselineTier = isTiered && !message.isOptimizingTier;
+
+    const results = await WebAssembly.instantiate(message.compilerBytes, compilerImports);
+    compilerExports = results.instance.exports;
+    compilerImports.memoryUbytes = new Uint8Array(compilerExports.memory.buffer);
+    compilerExports.enableCompileTimer(true);
+    compilerExports.enableProfiling(!!options.profile || (isBaselineTier && options.tiered === "guided"));
+    compilerExports.enableNameSection(!!options.names);
+    compilerExports.enableLineTable(!!options.lines);
+    compilerExports.enableBenchmarking(options.benchmark !== undefined);
+    compilerExports.enableFuel(options.fuel !== undefined);
+    compilerExports.enableSizeReport(!!options.report);
+    compilerExports.enableTiering(isTiered);
+    compilerExports.enableOptimization(!isBaselineTier);
+
+    if (options.cache !== false) {
+        compileCache = await CompileCache.open(message.compilerBytes, options.cacheDirectory);
+        compileOptions = [
+            options.profile || (isBaselineTier && options.tiered === "guided"),
+            options.names,
+            options.lines,
+            options.benchmark !== undefined,
+            options.fuel !== undefined,
+            options.report,
+            isTiered,
+            !isBaselineTier,
+        ].map(option => option ? 1 : 0).join("");
+    }
+
+    if (message.mailboxBuffer) {
+        tierMailbox = new TierMailbox(message.mailboxBuffer);
+    }
+
+    if (isBaselineTier) {
+        await startOptimizingWorker(message.compilerBytes);
+    }
+}
+
+async function startOptimizingWorker(compilerBytes) {
+    const url = new URL("./worker.js", import.meta.url);
+    if (parentPort) {
+        const {Worker} = await import("node:worker_threads");
+        optimizingWorker = new Worker(url);
+        optimizingWorker.on("message", receiveOptimizedTier);
+    } else {
+        optimizingWorker = new Worker(url, {type: "module"});
+        optimizingWorker.onmessage = event => receiveOptimizedTier(event.data);
+    }
+
+    //without shared memory, a benchmark can't take the optimized tier while it runs
+    tierMailbox = outputRing ? TierMailbox.create() : undefined;
+    optimizingWorker.postMessage({
+        type: "init",
+        compilerBytes,
+        mailboxBuffer: tierMailbox && tierMailbox.buffer,
+        options,
+        isOptimizingTier: true,
+    });
+}
+
+function requestOptimizedTier(hotLines) {
+    isOptimizedTierRequested = true;
+    optimizingWorker.postMessage({type: "optimize", source: tieredSource, hotLines, generation: tierGeneration});
+}
+
+//messages from the optimizing worker.  Only optimized tiers of the current source are kept
+function receiveOptimizedTier(message) {
+    if (message.type === "optimized" && message.generation === tierGeneration) {
+        optimizedTier = message;
+    }
+}
+
+//on the optimizing worker
+async function optimize(message) {
+    compilerExports.clearHotLines();
+    for (const line of message.hotLines || []) {
+        compilerExports.addHotLine(line);
+    }
+
+    //a guided tier depends on the profile as well as the source, so it isn't cached.  A program
+    //that can't be compiled keeps running on its baseline
+    let program;
+    try {
+        program = await compile(message.source, !message.hotLines);
+    } catch (error) {
+        return;
+    }
+    if (tierMailbox) {
+        tierMailbox.put(program.bytes, message.generation);
+    }
+    postToHost({type: "optimized", bytes: program.bytes, stats: program.stats, report: program.report, generation: message.generation});
+}
+
+//a guided optimized tier is requested once the baseline's first call returns
+function requestGuidedTier(moduleExports) {
+    if (!isOptimizedTierRequested) {
+        requestOptimizedTier(findHotLines(moduleExports));
+    }
+}
+
+//the optimized tier, if it's been compiled since the benchmark started
+function takeOptimizedTier(moduleExports) {
+    requestGuidedTier(moduleExports);
+    return tierMailbox && tierMailbox.take(tierGeneration);
+}
+
+//compile a source to a program: its module's bytes, and the compiler's stats and size report.
+//A cached program is only hashed
+async function compile(source, isCacheable = true) {
+    const strAsUTF8 = encoder.encode(source);
+    //the compiler grows its memory to fit the source and what it compiles it to
+    const sourceAddress = compilerExports.getSourceBuffer(strAsUTF8.length);
+    if (sourceAddress === 0) {
+        throw new RangeError("out of memory to compile the program in");
+    }
+    compilerImports.memoryUbytes = new Uint8Array(compilerExports.memory.buffer);
+    compilerImports.memoryUbytes.set(strAsUTF8, sourceAddress);
+
+    let key;
+    if (compileCache && isCacheable) {
+        const address = compilerExports.hashSource(sourceAddress, strAsUTF8.length);
+        const view = new DataView(compilerExports.memory.buffer);
+        key = compileCache.getKey([view.getUint32(address, true), view.getUint32(address + 4, true)], compileOptions);
+
+        const program = await compileCache.get(key);
+        if (program) {
+            return program;
+        }
+    }
+
+    const moduleAddress = compilerExports.getWasmFromJava(sourceAddress, strAsUTF8.length);
+    compilerImports.memoryUbytes = new Uint8Array(compilerExports.memory.buffer);
+    const view = new DataView(compilerExports.memory.buffer);
+    const start = view.getUint32(moduleAddress, true);
+    const size = view.getUint32(moduleAddress + 4, true);
+    if (size === 0) {
+        throw readCompileError(compilerExports);
+    }
+    const program = {
+        bytes: compilerImports.memoryUbytes.slice(start, start + size),
+        stats: readCompileStats(compilerExports),
+        report: readSizeReport(compilerExports),
+    };
+
+    if (key) {
+        await compileCache.put(key, program);
+    }
+    return program;
+}
+
+async function run(program, isBaseline) {
+    try {
+        //a cached program's module is only compiled the first time it runs
+        const module = compileCache ? await compileCache.getModule(program) : program.bytes;
+
+        if (options.benchmark !== undefined) {
+            const result = await runBenchmark(module, runtimeImports, {
+                method: options.benchmark || undefined,
+                iterations: options.iterations,
+                warmup: options.warmup,
+                onInstantiate: runtimeImports.useModule,
+                nextTier: isBaseline ? takeOptimizedTier : undefined,
+            });
+            write(encoder.encode(formatBenchmark(result)));
+            return;
+        }
+
+        const runtimeExports = (await instantiate(module, runtimeImports)).exports;
+        runtimeImports.useModule(runtimeExports);
+
+        if (runtimeExports.main) {
+            runtimeExports.main();
+            if (options.profile) {
+                runtimeImports.printProfile(runtimeExports);
+            }
+            if (isBaseline) {
+                requestGuidedTier(runtimeExports);
+            }
+        }
+    } catch (error) {
+        write(encoder.encode("\n" + error.message + "\n"));
+    }
+}
+
+async function handleMessage(message) {
+    if (message.type === "init") {
+        await init(message);
+        postToHost({type: "ready"});
+    } else if (message.type === "compile") {
+        programInput = message.input || [];
+        if (optimizingWorker && message.source !== tieredSource) {
+            tieredSource = message.source;
+            optimizedTier = undefined;
+            isOptimizedTierRequested = false;
+            ++tierGeneration;
+        }
+
+        //the next run of a source whose optimized tier is compiled runs that instead
+        let program;
+        let tier;
+        if (optimizedTier) {
+            program = optimizedTier;
+            tier = "optimized";
+        } else {
+            try {
+                program = await compile(message.source);
+            } catch (error) {
+                write(encoder.encode(error.message + "\n"));
+                flushOutput();
+                postToHost({type: "exited"});
+                return;
+            }
+            tier = optimizingWorker ? "baseline" : undefined;
+            flushOutput();
+
+            if (optimizingWorker && options.tiered !== "guided" && !isOptimizedTierRequested) {
+                requestOptimizedTier();
+            }
+        }
+        postToHost({type: "compiled", bytes: program.bytes, stats: program.stats, report: program.report, tier});
+
+        if (message.run) {
+            await run(program, tier === "baseline");
+            flushOutput();
+            postToHost({type: "exited"});
+        }
+    } else if (message.type === "optimize") {
+        await optimize(message);
+    }
+}
+
+//messages are handled one at a time, in the order they came
+let queue = Promise.resolve();
+function receive(message) {
+    queue = queue.then(() => handleMessage(message));
+}
+
+if (parentPort) {
+    parentPort.on("message", receive);
+} else {
+    self.onmessage = event => receive(event.data);
+}